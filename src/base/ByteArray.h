@@ -44,6 +44,11 @@ class ByteArray : public ByteArray_Base
      */
     virtual ByteArray *dup() const {return new ByteArray(*this);}
 
+    /**
+     * Returns a pointer to the stored bytes (getDataArraySize() bytes)
+     */
+    const char *getDataArrayPointer() const {return data_var;}
+
     /**
      * Copy data from buffer
      * @param ptr: pointer to buffer
@@ -12,16 +12,26 @@
 // See the GNU Lesser General Public License for more details.
 //
 
+#include <algorithm>
+#include <string.h>
+
 #include "ByteArrayBuffer.h"
 
 ByteArrayBuffer::ByteArrayBuffer()
  :
+    bufferM(NULL),
+    capacityM(0),
+    headM(0),
     dataLengthM(0)
 {
 }
 
 ByteArrayBuffer::ByteArrayBuffer(const ByteArrayBuffer& other)
-    : cObject(other)
+    : cObject(other),
+    bufferM(NULL),
+    capacityM(0),
+    headM(0),
+    dataLengthM(0)
 {
     copy(other);
 }
@@ -34,39 +44,98 @@ ByteArrayBuffer& ByteArrayBuffer::operator=(const ByteArrayBuffer& other)
     return *this;
 }
 
+ByteArrayBuffer::~ByteArrayBuffer()
+{
+    delete [] bufferM;
+}
+
+void ByteArrayBuffer::copy(const ByteArrayBuffer& other)
+{
+    clear();
+    reserve(other.dataLengthM);
+    if (other.dataLengthM)
+        other.copyOut(0, bufferM, other.dataLengthM);
+    dataLengthM = other.dataLengthM;
+}
+
+void ByteArrayBuffer::reserve(uint64 capacityP)
+{
+    if (capacityP <= capacityM)
+        return;
+
+    uint64 newCapacity = std::max(capacityP, std::max((uint64)2 * capacityM, (uint64)1024));
+    if (newCapacity > 0xffffffffu)
+        throw cRuntimeError("ByteArrayBuffer: cannot store more than 4GiB");
+
+    // the data starts at the beginning of the new storage
+    char *newBuffer = new char[newCapacity];
+    if (dataLengthM)
+        copyOut(0, newBuffer, dataLengthM);
+    delete [] bufferM;
+    bufferM = newBuffer;
+    capacityM = newCapacity;
+    headM = 0;
+}
+
+void ByteArrayBuffer::copyIn(uint64 offsP, const void* bufferP, unsigned int bufferLengthP)
+{
+    ASSERT(offsP + bufferLengthP <= capacityM);
+    if (bufferLengthP == 0)
+        return;
+
+    // at most two pieces: up to the end of the storage, and from its beginning
+    unsigned int pos = (headM + offsP) % capacityM;
+    unsigned int firstLength = std::min(bufferLengthP, capacityM - pos);
+    memcpy(bufferM + pos, bufferP, firstLength);
+    memcpy(bufferM, (const char *)bufferP + firstLength, bufferLengthP - firstLength);
+}
+
+void ByteArrayBuffer::copyOut(uint64 offsP, void* bufferP, unsigned int bufferLengthP) const
+{
+    ASSERT(offsP + bufferLengthP <= dataLengthM);
+    if (bufferLengthP == 0)
+        return;
+
+    unsigned int pos = (headM + offsP) % capacityM;
+    unsigned int firstLength = std::min(bufferLengthP, capacityM - pos);
+    memcpy(bufferP, bufferM + pos, firstLength);
+    memcpy((char *)bufferP + firstLength, bufferM, bufferLengthP - firstLength);
+}
+
 void ByteArrayBuffer::push(const ByteArray& byteArrayP)
 {
-    dataListM.push_back(byteArrayP);
-    dataLengthM += byteArrayP.getDataArraySize();
+    push(byteArrayP.getDataArrayPointer(), byteArrayP.getDataArraySize());
 }
 
 void ByteArrayBuffer::push(const void* bufferP, unsigned int bufferLengthP)
 {
-    ByteArray byteArray;
-    dataListM.push_back(byteArray);
-    dataListM.back().setDataFromBuffer(bufferP, bufferLengthP);
+    reserve(dataLengthM + bufferLengthP);
+    copyIn(dataLengthM, bufferP, bufferLengthP);
     dataLengthM += bufferLengthP;
 }
 
-unsigned int ByteArrayBuffer::getBytesToBuffer(void* bufferP, unsigned int bufferLengthP, unsigned int srcOffsP) const
+void ByteArrayBuffer::setBytesFromBuffer(uint64 offsP, const void* bufferP, unsigned int bufferLengthP)
 {
-    unsigned int copiedBytes = 0;
-    DataList::const_iterator i;
-
-    for (i = this->dataListM.begin(); (copiedBytes < bufferLengthP) && (i != dataListM.end()); ++i)
+    reserve(offsP + bufferLengthP);
+    while (dataLengthM < offsP)
     {
-        unsigned int cbytes = i->copyDataToBuffer((char *)bufferP + copiedBytes,
-                bufferLengthP - copiedBytes, srcOffsP);
-        if (cbytes)
-        {
-            copiedBytes += cbytes;
-            srcOffsP = 0;
-        }
-        else
-        {
-            srcOffsP -= i->getDataArraySize();
-        }
+        // zero fill the gap, piece by piece
+        unsigned int pos = (headM + dataLengthM) % capacityM;
+        unsigned int gapLength = (unsigned int)std::min(offsP - dataLengthM, (uint64)(capacityM - pos));
+        memset(bufferM + pos, 0, gapLength);
+        dataLengthM += gapLength;
     }
+    copyIn(offsP, bufferP, bufferLengthP);
+    dataLengthM = std::max(dataLengthM, offsP + bufferLengthP);
+}
+
+unsigned int ByteArrayBuffer::getBytesToBuffer(void* bufferP, unsigned int bufferLengthP, unsigned int srcOffsP) const
+{
+    if (srcOffsP >= dataLengthM)
+        return 0;
+
+    unsigned int copiedBytes = (unsigned int)std::min((uint64)bufferLengthP, dataLengthM - srcOffsP);
+    copyOut(srcOffsP, bufferP, copiedBytes);
     return copiedBytes;
 }
 
@@ -79,36 +148,15 @@ unsigned int ByteArrayBuffer::drop(unsigned int lengthP)
 {
     ASSERT(lengthP <= dataLengthM);
 
-    unsigned int length = lengthP;
-
-    while (length > 0)
-    {
-        unsigned int sliceLength = dataListM.front().getDataArraySize();
-
-        if (sliceLength <= length)
-        {
-            dataListM.pop_front();
-            dataLengthM -= sliceLength;
-            length -= sliceLength;
-        }
-        else
-        {
-            dataListM.front().truncateData(length);
-            dataLengthM -= length;
-            length = 0;
-        }
-    }
-    ASSERT(0 == length);
+    dataLengthM -= lengthP;
+    headM = dataLengthM ? (headM + lengthP) % capacityM : 0;
     return lengthP;
 }
 
 void ByteArrayBuffer::clear()
 {
+    // keep the storage for reuse
     dataLengthM = 0;
-
-    while (dataListM.begin() != dataListM.end())
-    {
-        dataListM.pop_front();
-    }
+    headM = 0;
 }
 
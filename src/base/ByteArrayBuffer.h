@@ -18,17 +18,34 @@
 #include "ByteArray.h"
 
 /**
- * Buffer that carries BytesArrays.
+ * Byte FIFO with random read access, e.g. for storing the payload of TCP
+ * byte stream queues. The bytes are kept in a contiguous ring buffer that
+ * grows on demand, so pushing, reading at an offset and dropping bytes cost
+ * no more than copying the bytes themselves.
+ *
+ * Readers always get a copy of the bytes: ByteArray owns its storage, so
+ * TCP segments and extracted messages cannot refer to ranges of the ring.
  */
 class ByteArrayBuffer : public cObject
 {
   protected:
-    typedef std::list<ByteArray> DataList;
+    char *bufferM;          // ring storage
+    unsigned int capacityM; // size of bufferM
+    unsigned int headM;     // position of the first stored byte in bufferM
     uint64 dataLengthM;
-    DataList dataListM;
 
   private:
-    void copy(const ByteArrayBuffer& other) { dataLengthM = other.dataLengthM; dataListM = other.dataListM; }
+    void copy(const ByteArrayBuffer& other);
+
+  protected:
+    /** Grows the storage to hold at least the given number of bytes */
+    void reserve(uint64 capacityP);
+
+    /** Copies bytes into the ring; the storage must be large enough */
+    void copyIn(uint64 offsP, const void* bufferP, unsigned int bufferLengthP);
+
+    /** Copies bytes out of the ring; the data must be available */
+    void copyOut(uint64 offsP, void* bufferP, unsigned int bufferLengthP) const;
 
   public:
     /** Ctor. */
@@ -38,6 +55,8 @@ class ByteArrayBuffer : public cObject
     ByteArrayBuffer(const ByteArrayBuffer& other);
     ByteArrayBuffer& operator=(const ByteArrayBuffer& other);
 
+    virtual ~ByteArrayBuffer();
+
     virtual ByteArrayBuffer *dup() const {return new ByteArrayBuffer(*this);}
 
     /** Clear buffer */
@@ -49,6 +68,13 @@ class ByteArrayBuffer : public cObject
     /** Push data to end of buffer */
     virtual void push(const void* bufferP, unsigned int bufferLengthP);
 
+    /**
+     * Overwrite data at the given offset. The buffer is extended if the data
+     * reaches beyond its end; a gap between the end and the offset is filled
+     * with zeros.
+     */
+    virtual void setBytesFromBuffer(uint64 offsP, const void* bufferP, unsigned int bufferLengthP);
+
     /** Returns length of stored data */
     virtual uint64 getLength() const { return dataLengthM; }
 
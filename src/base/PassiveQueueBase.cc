@@ -19,6 +19,10 @@
 
 #include "PassiveQueueBase.h"
 
+#ifdef WITH_TCP_COMMON
+#include "TCPSegmentOffload.h"
+#endif
+
 simsignal_t PassiveQueueBase::rcvdPkSignal = registerSignal("rcvdPk");
 simsignal_t PassiveQueueBase::enqueuePkSignal = registerSignal("enqueuePk");
 simsignal_t PassiveQueueBase::dequeuePkSignal = registerSignal("dequeuePk");
@@ -40,6 +44,22 @@ void PassiveQueueBase::initialize()
 
 void PassiveQueueBase::handleMessage(cMessage *msg)
 {
+#ifdef WITH_TCP_COMMON
+    if (msg->isPacket())
+    {
+        int segmentCount = TCPSegmentOffload::getSegmentCount(PK(msg));
+        if (segmentCount > 1 && !canQueueSuperSegment(PK(msg), segmentCount))
+        {
+            EV << "Splitting TCP super-segment into " << segmentCount << " packets\n";
+            std::vector<cPacket *> pieces;
+            TCPSegmentOffload::split(PK(msg), pieces);
+            for (unsigned int i = 0; i < pieces.size(); i++)
+                PassiveQueueBase::handleMessage(pieces[i]);
+            return;
+        }
+    }
+#endif
+
     numQueueReceived++;
 
     emit(rcvdPkSignal, msg);
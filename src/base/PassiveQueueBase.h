@@ -62,6 +62,14 @@ class INET_API PassiveQueueBase : public cSimpleModule, public IPassiveQueue
 
     virtual void notifyListeners();
 
+    /**
+     * Returns true if the queue can take the packet carrying a TCP
+     * super-segment as a whole, without dropping or reordering any of the
+     * segments it stands for. Otherwise the packet is split, and the
+     * segments are enqueued one by one. Returns false here.
+     */
+    virtual bool canQueueSuperSegment(cPacket *packet, int segmentCount) {return false;}
+
     /**
      * Inserts packet into the queue or the priority queue, or drops it
      * (or another packet). Returns NULL if successful, or the pointer of the dropped packet.
@@ -18,8 +18,6 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdarg.h>
-#include <deque>
-#include <list>
 #include <algorithm>
 #include <sstream>
 #include "Topology.h"
@@ -92,6 +90,7 @@ void Topology::clear()
         delete nodes[i];
     }
     nodes.clear();
+    invalidatePathGraph();
 }
 
 //---
@@ -239,6 +238,7 @@ void Topology::extractFromNetwork(bool (*predicate)(cModule *,void *), void *dat
 
 int Topology::addNode(Node *node)
 {
+    invalidatePathGraph();
     if (node->moduleId == -1)
     {
         // elements without module ID are stored at the end
@@ -256,6 +256,8 @@ int Topology::addNode(Node *node)
 
 void Topology::deleteNode(Node *node)
 {
+    invalidatePathGraph();
+
     // remove outgoing links
     for (int i=0; i<(int)node->outLinks.size(); i++) {
         Link *link = node->outLinks[i];
@@ -282,6 +284,8 @@ void Topology::deleteNode(Node *node)
 
 void Topology::addLink(Link *link, Node *srcNode, Node *destNode)
 {
+    invalidatePathGraph();
+
     // remove from graph if it's already in
     if (link->srcNode)
         unlinkFromSourceNode(link);
@@ -301,6 +305,8 @@ void Topology::addLink(Link *link, Node *srcNode, Node *destNode)
 
 void Topology::addLink(Link *link, cGate *srcGate, cGate *destGate)
 {
+    invalidatePathGraph();
+
     // remove from graph if it's already in
     if (link->srcNode)
         unlinkFromSourceNode(link);
@@ -324,6 +330,7 @@ void Topology::addLink(Link *link, cGate *srcGate, cGate *destGate)
 
 void Topology::deleteLink(Link *link)
 {
+    invalidatePathGraph();
     unlinkFromSourceNode(link);
     unlinkFromDestNode(link);
     delete link;
@@ -362,105 +369,276 @@ Topology::Node *Topology::getNodeFor(cModule *mod)
     return it==nodes.end() || (*it)->moduleId != mod->getId() ? NULL : *it;
 }
 
-void Topology::calculateUnweightedSingleShortestPathsTo(Node *_target)
+void Topology::preparePathCalculation()
 {
-    // multiple paths not supported :-(
+    int numNodes = nodes.size();
+    for (int i=0; i<numNodes; i++)
+        nodes[i]->index = i;
 
+    pathGraph.firstInLink.resize(numNodes+1);
+    pathGraph.inLinks.clear();
+    for (int i=0; i<numNodes; i++)
+    {
+        pathGraph.firstInLink[i] = pathGraph.inLinks.size();
+        Node *node = nodes[i];
+        for (int j=0; j<(int)node->inLinks.size(); j++)
+        {
+            Link *link = node->inLinks[j];
+            if (!link->enabled || !link->srcNode->enabled)
+                continue;
+
+            PathLink pathLink;
+            pathLink.srcIndex = link->srcNode->index;
+            pathLink.weight = link->weight;
+            pathLink.link = link;
+            pathGraph.inLinks.push_back(pathLink);
+        }
+    }
+    pathGraph.firstInLink[numNodes] = pathGraph.inLinks.size();
+}
+
+void Topology::invalidatePathGraph()
+{
+    pathGraph.firstInLink.clear();
+    pathGraph.inLinks.clear();
+}
+
+bool Topology::isPathGraphUpToDate() const
+{
+    // the enabled states and link weights may have changed since preparePathCalculation()
+    int numNodes = nodes.size();
+    int k = 0;
+    for (int i=0; i<numNodes; i++)
+    {
+        Node *node = nodes[i];
+        if (node->index != i || pathGraph.firstInLink[i] != k)
+            return false;
+        for (int j=0; j<(int)node->inLinks.size(); j++)
+        {
+            Link *link = node->inLinks[j];
+            if (!link->enabled || !link->srcNode->enabled)
+                continue;
+            if (k == (int)pathGraph.inLinks.size())
+                return false;
+            const PathLink& pathLink = pathGraph.inLinks[k++];
+            if (pathLink.link != link || pathLink.srcIndex != link->srcNode->index || pathLink.weight != link->weight)
+                return false;
+        }
+    }
+    return k == (int)pathGraph.inLinks.size();
+}
+
+void Topology::initializePaths(Node *_target, ShortestPaths& paths) const
+{
     if (!_target)
         throw cRuntimeError(this,"..ShortestPathTo(): target node is NULL");
-    target = _target;
+    int numNodes = nodes.size();
+    if ((int)pathGraph.firstInLink.size() != numNodes+1)
+        throw cRuntimeError(this,"..ShortestPaths(): preparePathCalculation() must be called first");
+    ASSERT2(isPathGraphUpToDate(), "..ShortestPaths(): the graph changed since preparePathCalculation()");
+    if (_target->index < 0 || _target->index >= numNodes || nodes[_target->index] != _target)
+        throw cRuntimeError(this,"..ShortestPathTo(): target node is not in the topology");
+
+    paths.target = _target;
+    paths.dist.assign(numNodes, INFINITY);
+    paths.outPath.assign(numNodes, (Link *)NULL);
+    paths.dist[_target->index] = 0;
+    paths.queue.clear();
+    paths.queue.reserve(numNodes);
+}
 
+void Topology::storePathsInNodes(const ShortestPaths& paths)
+{
+    target = paths.target;
     for (int i=0; i<(int)nodes.size(); i++)
     {
-       nodes[i]->dist = INFINITY;
-       nodes[i]->outPath = NULL;
+        nodes[i]->dist = paths.dist[i];
+        nodes[i]->outPath = paths.outPath[i];
     }
-    target->dist = 0;
+}
 
-    std::deque<Node*> q;
+void Topology::calculateUnweightedSingleShortestPathsTo(Node *_target)
+{
+    ShortestPaths paths;
+    preparePathCalculation();
+    calculateUnweightedSingleShortestPaths(_target, paths);
+    storePathsInNodes(paths);
+}
 
-    q.push_back(target);
+void Topology::calculateUnweightedSingleShortestPathsToAll(ShortestPathsVisitor *visitor)
+{
+    ShortestPaths paths;
+    preparePathCalculation();
 
-    while (!q.empty())
+    // the visitor may look at the nodes, but not change the graph
+    std::vector<Node*> targets = nodes;
+    for (int i=0; i<(int)targets.size(); i++)
     {
-       Node *v = q.front();
-       q.pop_front();
+        if (visitor->isTarget(targets[i]))
+        {
+            calculateUnweightedSingleShortestPaths(targets[i], paths);
+            storePathsInNodes(paths);
+            visitor->shortestPathsCalculated(targets[i]);
+        }
+    }
+}
 
-       // for each w adjacent to v...
-       for (int i=0; i<(int)v->inLinks.size(); i++)
-       {
-           if (!v->inLinks[i]->enabled)
-               continue;
+void Topology::calculateUnweightedSingleShortestPaths(Node *_target, ShortestPaths& paths) const
+{
+    // multiple paths not supported :-(
+
+    initializePaths(_target, paths);
 
-           Node *w = v->inLinks[i]->srcNode;
-           if (!w->enabled)
-               continue;
+    // FIFO queue of node indices; every node is enqueued at most once
+    std::vector<int>& q = paths.queue;
+    q.push_back(_target->index);
 
-           if (w->dist == INFINITY)
+    for (int k=0; k<(int)q.size(); k++)
+    {
+       int v = q[k];
+
+       // for each w adjacent to v...
+       for (int i=pathGraph.firstInLink[v]; i<pathGraph.firstInLink[v+1]; i++)
+       {
+           int w = pathGraph.inLinks[i].srcIndex;
+           if (paths.dist[w] == INFINITY)
            {
-               w->dist = v->dist + 1;
-               w->outPath = v->inLinks[i];
+               paths.dist[w] = paths.dist[v] + 1;
+               paths.outPath[w] = pathGraph.inLinks[i].link;
                q.push_back(w);
            }
        }
     }
+    q.clear();
 }
 
 void Topology::calculateWeightedSingleShortestPathsTo(Node *_target)
 {
-    if (!_target)
-        throw cRuntimeError(this,"..ShortestPathTo(): target node is NULL");
-    target = _target;
+    ShortestPaths paths;
+    preparePathCalculation();
+    calculateWeightedSingleShortestPaths(_target, paths);
+    storePathsInNodes(paths);
+}
 
-    // clean path infos
-    for (int i=0; i<(int)nodes.size(); i++)
+void Topology::calculateWeightedSingleShortestPathsToAll(ShortestPathsVisitor *visitor)
+{
+    ShortestPaths paths;
+    preparePathCalculation();
+
+    // the visitor may look at the nodes, but not change the graph
+    std::vector<Node*> targets = nodes;
+    for (int i=0; i<(int)targets.size(); i++)
+    {
+        if (visitor->isTarget(targets[i]))
+        {
+            calculateWeightedSingleShortestPaths(targets[i], paths);
+            storePathsInNodes(paths);
+            visitor->shortestPathsCalculated(targets[i]);
+        }
+    }
+}
+
+inline bool Topology::isBeforeInQueue(const ShortestPaths& paths, int a, int b)
+{
+    // nodes with equal distance are processed in the order they were (re)inserted,
+    // just like with the ordered list that was used here before
+    double distA = paths.dist[a], distB = paths.dist[b];
+    return distA < distB || (distA == distB && paths.queueOrder[a] < paths.queueOrder[b]);
+}
+
+void Topology::siftUp(ShortestPaths& paths, int pos)
+{
+    int node = paths.queue[pos];
+    while (pos > 0)
     {
-       nodes[i]->dist = INFINITY;
-       nodes[i]->outPath = NULL;
+        int parentPos = (pos - 1) / 2;
+        int parent = paths.queue[parentPos];
+        if (!isBeforeInQueue(paths, node, parent))
+            break;
+        paths.queue[pos] = parent;
+        paths.queuePos[parent] = pos;
+        pos = parentPos;
     }
+    paths.queue[pos] = node;
+    paths.queuePos[node] = pos;
+}
 
-    target->dist = 0;
+void Topology::siftDown(ShortestPaths& paths, int pos)
+{
+    int size = paths.queue.size();
+    int node = paths.queue[pos];
+    while (true)
+    {
+        int childPos = 2 * pos + 1;
+        if (childPos >= size)
+            break;
+        if (childPos + 1 < size && isBeforeInQueue(paths, paths.queue[childPos + 1], paths.queue[childPos]))
+            childPos++;
+        int child = paths.queue[childPos];
+        if (!isBeforeInQueue(paths, child, node))
+            break;
+        paths.queue[pos] = child;
+        paths.queuePos[child] = pos;
+        pos = childPos;
+    }
+    paths.queue[pos] = node;
+    paths.queuePos[node] = pos;
+}
 
-    std::list<Node*> q;
+void Topology::calculateWeightedSingleShortestPaths(Node *_target, ShortestPaths& paths) const
+{
+    initializePaths(_target, paths);
 
-    q.push_back(target);
+    // indexed binary heap: a node whose distance decreases is moved up in place
+    int targetIndex = _target->index;
+    uint64 lastQueueOrder = 0;
+    paths.queuePos.assign(nodes.size(), -1);
+    paths.queueOrder.assign(nodes.size(), 0);
+    paths.queue.push_back(targetIndex);
+    paths.queuePos[targetIndex] = 0;
+    paths.queueOrder[targetIndex] = ++lastQueueOrder;
 
-    while (!q.empty())
+    while (!paths.queue.empty())
     {
-        Node *dest = q.front();
-        q.pop_front();
+        int destIndex = paths.queue[0];
+        paths.queuePos[destIndex] = -1;
+        int last = paths.queue.back();
+        paths.queue.pop_back();
+        if (last != destIndex)
+        {
+            paths.queue[0] = last;
+            siftDown(paths, 0);
+        }
 
+        Node *dest = nodes[destIndex];
         ASSERT(dest->getWeight() >= 0.0);
 
         // for each w adjacent to v...
-        for (int i=0; i < dest->getNumInLinks(); i++)
+        for (int i=pathGraph.firstInLink[destIndex]; i<pathGraph.firstInLink[destIndex+1]; i++)
         {
-            if (!(dest->getLinkIn(i)->isEnabled()))
-                continue;
-
-            Node *src = dest->getLinkIn(i)->getRemoteNode();
-            if (!src->isEnabled())
-                continue;
+            const PathLink& pathLink = pathGraph.inLinks[i];
+            int srcIndex = pathLink.srcIndex;
 
-            double linkWeight = dest->getLinkIn(i)->getWeight();
+            double linkWeight = pathLink.weight;
             ASSERT(linkWeight > 0.0);
 
-            double newdist = dest->dist + linkWeight;
-            if (dest != target)
+            double newdist = paths.dist[destIndex] + linkWeight;
+            if (destIndex != targetIndex)
                 newdist += dest->getWeight();  // dest is not the target, uses weight of dest node as price of routing (infinity means dest node doesn't route between interfaces)
-            if (newdist != INFINITY && src->dist > newdist)  // it's a valid shorter path from src to target node
+            if (newdist != INFINITY && paths.dist[srcIndex] > newdist)  // it's a valid shorter path from src to target node
             {
-                if (src->dist != INFINITY)
-                    q.remove(src);   // src is in the queue
-                src->dist = newdist;
-                src->outPath = dest->inLinks[i];
-
-                // insert src node to ordered list
-                std::list<Node*>::iterator it;
-                for (it = q.begin(); it != q.end(); ++it)
-                    if ((*it)->dist > newdist)
-                        break;
-                q.insert(it, src);
+                paths.dist[srcIndex] = newdist;
+                paths.outPath[srcIndex] = pathLink.link;
+                paths.queueOrder[srcIndex] = ++lastQueueOrder;
+
+                // insert src node to the heap, or move it up if it is already there
+                int pos = paths.queuePos[srcIndex];
+                if (pos == -1)
+                {
+                    pos = paths.queue.size();
+                    paths.queue.push_back(srcIndex);
+                }
+                siftUp(paths, pos);
             }
         }
     }
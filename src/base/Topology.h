@@ -61,6 +61,7 @@ class INET_API Topology : public cOwnedObject
     class Link;
     class LinkIn;
     class LinkOut;
+    class ShortestPaths;
 
     /**
      * Supporting class for Topology, represents a node in the graph.
@@ -68,6 +69,7 @@ class INET_API Topology : public cOwnedObject
     class INET_API Node
     {
         friend class Topology;
+        friend class ShortestPaths;
 
       protected:
         int moduleId;
@@ -79,12 +81,13 @@ class INET_API Topology : public cOwnedObject
         // variables used by the shortest-path algorithms
         double dist;
         Link *outPath;
+        int index;  // position in nodes[] at the time of the last path calculation
 
       public:
         /**
          * Constructor
          */
-        Node(int moduleId=-1) {this->moduleId=moduleId; weight=0; enabled=true; dist=INFINITY; outPath=NULL;}
+        Node(int moduleId=-1) {this->moduleId=moduleId; weight=0; enabled=true; dist=INFINITY; outPath=NULL; index=-1;}
         virtual ~Node() {}
 
         /** @name Node attributes: weight, enabled state, correspondence to modules. */
@@ -330,9 +333,92 @@ class INET_API Topology : public cOwnedObject
         virtual bool matches(cModule *module) = 0;
     };
 
+    /**
+     * Callback interface for the calculate...ShortestPathsToAll() methods of
+     * Topology. The graph must not be modified from within the callbacks.
+     */
+    class INET_API ShortestPathsVisitor
+    {
+      public:
+        virtual ~ShortestPathsVisitor() {}
+
+        /**
+         * Returns whether the shortest paths towards the given node are needed.
+         */
+        virtual bool isTarget(Node *node) {return true;}
+
+        /**
+         * Called when the shortest paths towards the target node have been
+         * calculated. The paths can be extracted via Node's methods.
+         */
+        virtual void shortestPathsCalculated(Node *target) = 0;
+    };
+
+    /**
+     * Shortest paths towards a target node, stored outside of the graph.
+     * See calculateUnweightedSingleShortestPaths() and
+     * calculateWeightedSingleShortestPaths().
+     */
+    class INET_API ShortestPaths
+    {
+        friend class Topology;
+
+      protected:
+        Node *target;
+        std::vector<double> dist;       // indexed by node index
+        std::vector<Link*> outPath;     // indexed by node index
+
+        // work area of the algorithms
+        std::vector<int> queue;         // FIFO, or binary heap ordered by (dist, queueOrder)
+        std::vector<int> queuePos;      // position of each node in the heap, or -1
+        std::vector<uint64> queueOrder; // sequence number of the node's last (re)insertion
+
+      public:
+        ShortestPaths() {target=NULL;}
+
+        /**
+         * Returns the target node of the paths.
+         */
+        Node *getTargetNode() const {return target;}
+
+        /**
+         * Returns the distance of the given node to the target node.
+         */
+        double getDistanceToTarget(Node *node) const {return dist[node->index];}
+
+        /**
+         * Returns the number of shortest paths from the given node towards
+         * the target node.
+         */
+        int getNumPaths(Node *node) const {return outPath[node->index]?1:0;}
+
+        /**
+         * Returns the next link in the ith shortest path from the given node
+         * towards the target node.
+         */
+        LinkOut *getPath(Node *node, int) const {return (LinkOut *)outPath[node->index];}
+    };
+
+  protected:
+    // compact copy of the enabled links with enabled source nodes, indexed
+    // by destination node
+    struct PathLink
+    {
+        int srcIndex;
+        double weight;
+        Link *link;
+    };
+
+    struct PathGraph
+    {
+        std::vector<int> firstInLink;   // inLinks of node i are [firstInLink[i], firstInLink[i+1])
+        std::vector<PathLink> inLinks;
+    };
+
   protected:
     std::vector<Node*> nodes;
     Node *target;
+    PathGraph pathGraph;  // valid after preparePathCalculation(), cleared when nodes or links are added or deleted
 
     // note: the purpose of the (unsigned int) cast is that nodes with moduleId==-1 are inserted at the end of the vector
     static bool lessByModuleId(Node *a, Node *b) { return (unsigned int)a->moduleId < (unsigned int)b->moduleId; }
@@ -340,6 +426,15 @@ class INET_API Topology : public cOwnedObject
 
     void unlinkFromSourceNode(Link *link);
     void unlinkFromDestNode(Link *link);
+    void invalidatePathGraph();
+    bool isPathGraphUpToDate() const;
+
+    // shortest path algorithms over pathGraph
+    void initializePaths(Node *target, ShortestPaths& paths) const;
+    void storePathsInNodes(const ShortestPaths& paths);
+    static bool isBeforeInQueue(const ShortestPaths& paths, int a, int b);
+    static void siftUp(ShortestPaths& paths, int pos);
+    static void siftDown(ShortestPaths& paths, int pos);
 
   public:
     /** @name Constructors, destructor, assignment */
@@ -560,6 +655,50 @@ class INET_API Topology : public cOwnedObject
      */
     void calculateWeightedSingleShortestPathsTo(Node *target);
 
+    /**
+     * Calculates the shortest paths like calculateUnweightedSingleShortestPathsTo()
+     * towards every node selected by the visitor, one after the other, and
+     * calls the visitor after each. This is cheaper than calling
+     * calculateUnweightedSingleShortestPathsTo() in a loop, because the
+     * enabled part of the graph is only collected once.
+     */
+    void calculateUnweightedSingleShortestPathsToAll(ShortestPathsVisitor *visitor);
+
+    /**
+     * Calculates the shortest paths like calculateWeightedSingleShortestPathsTo()
+     * towards every node selected by the visitor, one after the other, and
+     * calls the visitor after each. This is cheaper than calling
+     * calculateWeightedSingleShortestPathsTo() in a loop, because the
+     * enabled part of the graph and the link weights are only collected once.
+     */
+    void calculateWeightedSingleShortestPathsToAll(ShortestPathsVisitor *visitor);
+
+    /**
+     * Collects the enabled part of the graph and the link weights for
+     * calculateUnweightedSingleShortestPaths() and
+     * calculateWeightedSingleShortestPaths(). It must be called again
+     * after the graph or the enabled states or link weights change; adding
+     * or deleting nodes or links discards the collected graph, and the
+     * other changes are caught by an assertion in debug builds.
+     */
+    void preparePathCalculation();
+
+    /**
+     * Like calculateUnweightedSingleShortestPathsTo(), but stores the paths
+     * in the given object instead of the nodes. The topology is not modified,
+     * so this method may be called from several threads at the same time,
+     * with different ShortestPaths objects. Requires preparePathCalculation().
+     */
+    void calculateUnweightedSingleShortestPaths(Node *target, ShortestPaths& paths) const;
+
+    /**
+     * Like calculateWeightedSingleShortestPathsTo(), but stores the paths
+     * in the given object instead of the nodes. The topology is not modified,
+     * so this method may be called from several threads at the same time,
+     * with different ShortestPaths objects. Requires preparePathCalculation().
+     */
+    void calculateWeightedSingleShortestPaths(Node *target, ShortestPaths& paths) const;
+
     /**
      * Returns the node that was passed to the most recently called
      * shortest path finding function.
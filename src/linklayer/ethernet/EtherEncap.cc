@@ -23,6 +23,10 @@
 #include "IInterfaceTable.h"
 #include "Ieee802Ctrl_m.h"
 
+#ifdef WITH_TCP_COMMON
+#include "TCPSegmentOffload.h"
+#endif
+
 
 Define_Module(EtherEncap);
 
@@ -80,9 +84,18 @@ void EtherEncap::updateDisplayString()
     getDisplayString().setTagArg("t", 0, buf);
 }
 
+static bool isSuperSegment(cPacket *msg)
+{
+#ifdef WITH_TCP_COMMON
+    return TCPSegmentOffload::findSuperSegment(msg) != NULL;
+#else
+    return false;
+#endif
+}
+
 void EtherEncap::processPacketFromHigherLayer(cPacket *msg)
 {
-    if (msg->getByteLength() > MAX_ETHERNET_DATA_BYTES)
+    if (msg->getByteLength() > MAX_ETHERNET_DATA_BYTES && !isSuperSegment(msg))
         error("packet from higher layer (%d bytes) exceeds maximum Ethernet payload length (%d)", (int)msg->getByteLength(), MAX_ETHERNET_DATA_BYTES);
 
     totalFromHigherLayer++;
@@ -230,7 +230,7 @@ void EtherMAC::processFrameFromUpperLayer(EtherFrame *frame)
                 frame->getFullName(), frame->getDest().str().c_str());
     }
 
-    if (frame->getByteLength() > MAX_ETHERNET_FRAME_BYTES)
+    if (frame->getByteLength() > MAX_ETHERNET_FRAME_BYTES && !isSuperSegment(frame))
     {
         error("Packet from higher layer (%d bytes) exceeds maximum Ethernet frame size (%d)",
                 (int)(frame->getByteLength()), MAX_ETHERNET_FRAME_BYTES);
@@ -27,6 +27,10 @@
 #include "NodeOperations.h"
 #include "opp_utils.h"
 
+#ifdef WITH_TCP_COMMON
+#include "TCPSegmentOffload.h"
+#endif
+
 
 const double EtherMACBase::SPEED_OF_LIGHT_IN_CABLE = 200000000.0;
 
@@ -491,6 +495,15 @@ bool EtherMACBase::dropFrameNotForUs(EtherFrame *frame)
     return true;
 }
 
+bool EtherMACBase::isSuperSegment(EtherFrame *frame)
+{
+#ifdef WITH_TCP_COMMON
+    return TCPSegmentOffload::findSuperSegment(frame) != NULL;
+#else
+    return false;
+#endif
+}
+
 void EtherMACBase::readChannelParameters(bool errorWhenAsymmetric)
 {
     // When the connected channels change at runtime, we'll receive
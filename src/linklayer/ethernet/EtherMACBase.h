@@ -214,6 +214,9 @@ class INET_API EtherMACBase : public MACBase, public cListener
     /** Checks destination address and drops the frame when frame is not for us; returns true if frame is dropped */
     virtual bool dropFrameNotForUs(EtherFrame *frame);
 
+    /** Returns true if the frame carries a TCP super-segment, which may exceed the maximum frame size */
+    static bool isSuperSegment(EtherFrame *frame);
+
     /**
      * Calculates datarates, etc. Verifies the datarates on the incoming/outgoing channels,
      * and throws error when they differ and the parameter errorWhenAsymmetric is true.
@@ -141,7 +141,7 @@ void EtherMACFullDuplex::processFrameFromUpperLayer(EtherFrame *frame)
                 frame->getFullName(), frame->getDest().str().c_str());
     }
 
-    if (frame->getByteLength() > MAX_ETHERNET_FRAME_BYTES)
+    if (frame->getByteLength() > MAX_ETHERNET_FRAME_BYTES && !isSuperSegment(frame))
     {
         error("packet from higher layer (%d bytes) exceeds maximum Ethernet frame size (%d)",
                 (int)(frame->getByteLength()), MAX_ETHERNET_FRAME_BYTES);
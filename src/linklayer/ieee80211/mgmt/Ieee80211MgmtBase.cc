@@ -23,6 +23,10 @@
 #include "NodeOperations.h"
 #include "NodeStatus.h"
 
+#ifdef WITH_TCP_COMMON
+#include "TCPSegmentOffload.h"
+#endif
+
 simsignal_t Ieee80211MgmtBase::dataQueueLenSignal = registerSignal("dataQueueLen");
 
 static std::ostream& operator<<(std::ostream& out, cMessage *msg)
@@ -97,6 +101,19 @@ void Ieee80211MgmtBase::handleMessage(cMessage *msg)
         // packet from upper layers, to be sent out
         cPacket *pk = PK(msg);
         EV << "Packet arrived from upper layers: " << pk << "\n";
+
+#ifdef WITH_TCP_COMMON
+        // TCP super-segments are sent as individual frames
+        if (TCPSegmentOffload::findSuperSegment(pk))
+        {
+            std::vector<cPacket *> pieces;
+            TCPSegmentOffload::split(pk, pieces);
+            for (unsigned int i = 0; i < pieces.size(); i++)
+                handleUpperMessage(pieces[i]);
+            return;
+        }
+#endif
+
         if (pk->getByteLength() > 2312)
             error("message from higher layer (%s)%s is too long for 802.11b, %d bytes (fragmentation is not supported yet)",
                   pk->getClassName(), pk->getName(), (int)(pk->getByteLength()));
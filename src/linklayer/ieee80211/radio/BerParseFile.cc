@@ -94,23 +94,23 @@ double BerParseFile::getPer(double speed, double tsnr, int tlen)
     berlist = & berTable[getTablePosition(speed)];
     LongBer * pre;
     LongBer * pos;
-    unsigned int j;
-    for (j=0; j<berlist->size(); j++)
-    {
-        pos = *(berlist->begin()+j);
-        if (pos->longpkt >= tlen)
-        {
-            break;
-        }
-    }
+    // the lists are sorted, so binary search for the first length >= tlen
+    unsigned int j = std::lower_bound(berlist->begin(), berlist->end(), tlen, longBerLessThan) - berlist->begin();
     if (j==0)
+    {
+        pos = (*berlist)[0];
         pre = NULL;
+    }
+    else if (j==berlist->size())
+    {
+        // longer than all: extrapolate from the last two lengths
+        pos = (*berlist)[j-1];
+        pre = j >= 2 ? (*berlist)[j-2] : NULL;
+    }
     else
     {
-        if (j==berlist->size())
-            pre = *(berlist->begin()+j-2);
-        else
-            pre = *(berlist->begin()+j-1);
+        pos = (*berlist)[j];
+        pre = (*berlist)[j-1];
     }
     SnrBer snrdata1;
     SnrBer snrdata2;
@@ -128,24 +128,16 @@ double BerParseFile::getPer(double speed, double tsnr, int tlen)
     }
     else
     {
-        for (j=0; j<pos->snrlist.size(); j++)
-        {
-            snrdata1 = pos->snrlist[j];
-            if (tsnr<=snrdata1.snr)
-                break;
-        }
+        // tsnr is not above the last entry, so the search stops within the list
+        j = std::lower_bound(pos->snrlist.begin(), pos->snrlist.end(), tsnr, snrBerLessThan) - pos->snrlist.begin();
+        snrdata1 = pos->snrlist[j];
         if (j==0)
         {
             snrdata2.snr = -1;
             snrdata2.ber = -1;
         }
         else
-        {
-            if (j==pos->snrlist.size())
-                snrdata2 = pos->snrlist[j-2];
-            else
-                snrdata2 = pos->snrlist[j-1];
-        }
+            snrdata2 = pos->snrlist[j-1];
     }
 
     if (pre==NULL)
@@ -157,20 +149,10 @@ double BerParseFile::getPer(double speed, double tsnr, int tlen)
     }
     else
     {
-        for (j=0; j<pre->snrlist.size(); j++)
-        {
-            snrdata3 = pre->snrlist[j];
-            if (tsnr<=snrdata3.snr)
-                break;
-        }
+        j = std::lower_bound(pre->snrlist.begin(), pre->snrlist.end(), tsnr, snrBerLessThan) - pre->snrlist.begin();
+        snrdata3 = pre->snrlist[j];
         if (j!=0)
-        {
-            if (j==pre->snrlist.size())
-                snrdata4 = pre->snrlist[j-2];
-            else
-                snrdata4 = pre->snrlist[j-1];
-        }
-
+            snrdata4 = pre->snrlist[j-1];
     }
     if (snrdata2.snr==-1)
     {
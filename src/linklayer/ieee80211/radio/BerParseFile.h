@@ -60,6 +60,9 @@ class BerParseFile
     char phyOpMode;
     bool fileBer;
 
+    static bool longBerLessThan(const LongBer *a, int longpkt) { return a->longpkt < longpkt; }
+    static bool snrBerLessThan(const SnrBer& a, double snr) { return a.snr < snr; }
+
     int getTablePosition(double speed);
     void clearBerTable();
     double dB2fraction(double dB)
@@ -23,6 +23,7 @@
 #include "FWMath.h"
 #include "yans-error-rate-model.h"
 #include "nist-error-rate-model.h"
+#include "TabulatedErrorModel.h"
 #define NS3CALMODE
 
 
@@ -65,6 +66,8 @@ void Ieee80211RadioModel::initializeFrom(cModule *radioModule)
         errorModel = new NistErrorRateModel();
     else
         opp_error("Error %s model is not valid",radioModule->par("errorModel").stringValue());
+    if (radioModule->par("tabulateErrorModel").boolValue())
+        errorModel = new TabulatedErrorModel(radioModule->par("errorModel").stringValue(), errorModel);
 
 
     btSize = radioModule->par("btSize").longValue();
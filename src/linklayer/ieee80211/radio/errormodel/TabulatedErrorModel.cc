@@ -0,0 +1,168 @@
+//
+// Copyright (C) 2014 OpenSim Ltd.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <math.h>
+#include <algorithm>
+
+#include "TabulatedErrorModel.h"
+#include "FWMath.h"
+
+
+const double TabulatedErrorModel::minSnrDb = -10;
+const double TabulatedErrorModel::maxSnrDb = 40;
+const double TabulatedErrorModel::snrStepDb = 0.1;
+const double TabulatedErrorModel::maxError = 1e-4;
+const double TabulatedErrorModel::maxChunkBits = 1e6;
+const double TabulatedErrorModel::maxExponent = 690;  // about -log(1e-300)
+TabulatedErrorModel::TableMap TabulatedErrorModel::tables;
+int TabulatedErrorModel::numInstances = 0;
+
+bool TabulatedErrorModel::TableKey::operator<(const TableKey& other) const
+{
+    if (modulationClass != other.modulationClass)
+        return modulationClass < other.modulationClass;
+    if (constellationSize != other.constellationSize)
+        return constellationSize < other.constellationSize;
+    if (codeRate != other.codeRate)
+        return codeRate < other.codeRate;
+    if (dataRate != other.dataRate)
+        return dataRate < other.dataRate;
+    if (bandwidth != other.bandwidth)
+        return bandwidth < other.bandwidth;
+    return modelName < other.modelName;
+}
+
+TabulatedErrorModel::TabulatedErrorModel(const char *modelName, IErrorModel *model) :
+    modelName(modelName), model(model)
+{
+    numInstances++;
+}
+
+TabulatedErrorModel::~TabulatedErrorModel()
+{
+    delete model;
+    if (--numInstances == 0)
+        tables.clear();
+}
+
+bool TabulatedErrorModel::isSameMode(const ModulationType& a, const ModulationType& b)
+{
+    return a.getModulationClass() == b.getModulationClass() &&
+            a.getConstellationSize() == b.getConstellationSize() &&
+            a.getCodeRate() == b.getCodeRate() &&
+            a.getDataRate() == b.getDataRate() &&
+            a.getBandwidth() == b.getBandwidth();
+}
+
+const TabulatedErrorModel::Table& TabulatedErrorModel::getTable(const ModulationType& mode) const
+{
+    for (std::vector<ModeTable>::const_iterator it = modeTables.begin(); it != modeTables.end(); ++it)
+        if (isSameMode(it->mode, mode))
+            return *it->table;
+
+    ModeTable modeTable;
+    modeTable.mode = mode;
+    modeTable.table = &lookupTable(mode);
+    modeTables.push_back(modeTable);
+    return *modeTable.table;
+}
+
+const TabulatedErrorModel::Table& TabulatedErrorModel::lookupTable(const ModulationType& mode) const
+{
+    TableKey key;
+    key.modelName = modelName;
+    key.modulationClass = mode.getModulationClass();
+    key.constellationSize = mode.getConstellationSize();
+    key.codeRate = mode.getCodeRate();
+    key.dataRate = mode.getDataRate();
+    key.bandwidth = mode.getBandwidth();
+
+    TableMap::iterator it = tables.find(key);
+    if (it != tables.end())
+        return it->second;
+
+    Table& table = tables[key];
+    int size = (int)floor((maxSnrDb - minSnrDb) / snrStepDb + 0.5) + 1;
+    table.exponents.resize(size);
+    for (int i = 0; i < size; i++)
+        table.exponents[i] = getExponent(mode, minSnrDb + i * snrStepDb);
+
+    table.intervalTypes.resize(size - 1);
+    for (int i = 0; i < size - 1; i++)
+        table.intervalTypes[i] = getIntervalType(mode, table, i);
+    return table;
+}
+
+double TabulatedErrorModel::getExponent(const ModulationType& mode, double snrDb) const
+{
+    double successRate = model->GetChunkSuccessRate(mode, pow(10.0, snrDb / 10), 1);
+    // some curve fits yield negative success rates at low SNR, these are marked
+    // with a negative exponent, so that they are always evaluated directly
+    if (successRate < 0)
+        return -1;
+    return successRate > 0 ? std::min(-log(successRate), maxExponent) : maxExponent;
+}
+
+char TabulatedErrorModel::getIntervalType(const ModulationType& mode, const Table& table, int i) const
+{
+    double a = table.exponents[i];
+    double b = table.exponents[i + 1];
+    bool constant = a == b && a >= 0;
+    // zero exponents may come from a cutoff in the model (e.g. the CCK curve
+    // fits), and maximal ones from a clamped success rate; both can only be
+    // constant, not interpolated
+    bool interpolable = a > 0 && b > 0 && a < maxExponent && b < maxExponent;
+    for (int j = 1; j < 4 && (constant || interpolable); j++)
+    {
+        double fraction = j / 4.0;
+        double exact = getExponent(mode, minSnrDb + (i + fraction) * snrStepDb);
+        constant = constant && exact == a;
+        if (interpolable)
+        {
+            // the error of exp(-x * n) is at most n * |dx| * exp(-x * n) <= min(n, 1 / (e * x)) * |dx|
+            double error = fabs(a * pow(b / a, fraction) - exact);
+            interpolable = exact > 0 && error * std::min(maxChunkBits, 1 / (M_E * exact)) <= maxError;
+        }
+    }
+    return constant ? CONSTANT : interpolable ? INTERPOLATED : DIRECT;
+}
+
+double TabulatedErrorModel::GetChunkSuccessRate(ModulationType mode, double snr, uint32_t nbits) const
+{
+    if (snr <= 0)
+        return model->GetChunkSuccessRate(mode, snr, nbits);
+    double snrDb = 10 * log10(snr);
+    if (snrDb < minSnrDb || snrDb >= maxSnrDb)
+        return model->GetChunkSuccessRate(mode, snr, nbits);
+
+    const Table& table = getTable(mode);
+    double position = (snrDb - minSnrDb) / snrStepDb;
+    unsigned int i = (unsigned int)position;
+    if (i + 1 >= table.exponents.size())
+        i = table.exponents.size() - 2;
+    double a = table.exponents[i];
+    if (table.intervalTypes[i] == CONSTANT)
+        return a == 0 ? 1 : a >= maxExponent ? 0 : exp(-a * nbits);
+    if (table.intervalTypes[i] == DIRECT)
+        return model->GetChunkSuccessRate(mode, snr, nbits);
+    double fraction = position - i;
+    double b = table.exponents[i + 1];
+
+    // the bit error rate falls off exponentially with the SNR, so interpolate in the log domain
+    double exponent = a * pow(b / a, fraction);
+    return exp(-exponent * nbits);
+}
@@ -0,0 +1,119 @@
+//
+// Copyright (C) 2014 OpenSim Ltd.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __INET_TABULATEDERRORMODEL_H
+#define __INET_TABULATEDERRORMODEL_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "INETDefs.h"
+
+#include "WifiMode.h"
+#include "IErrorModel.h"
+
+/**
+ * Wraps an error model, and answers chunk success rate queries from tables
+ * precomputed on a dense SNR grid instead of evaluating the model's
+ * erfc/binomial formulas for every received frame.
+ *
+ * All supported models compute the success rate of a chunk as the per-bit
+ * success rate raised to the power of the number of bits, so a single table
+ * per modulation serves every chunk length exactly: it stores
+ * -log(per-bit success rate), interpolated geometrically between grid points.
+ * Outside the grid, and in the grid intervals where the interpolation is not
+ * accurate enough (e.g. next to a cutoff or clamping in the model), the
+ * wrapped model is evaluated directly. Elsewhere the chunk success rate stays
+ * within maxError of the model for chunks up to maxChunkBits long; this is
+ * checked at interior points of every interval when the table is built.
+ *
+ * Tables are built on first use of a modulation, and are shared by all
+ * instances that wrap a model with the same name. They are deleted together
+ * with the last instance, so every run (e.g. the next run of a parameter
+ * study in the same process) starts with fresh tables.
+ */
+class INET_API TabulatedErrorModel : public IErrorModel
+{
+  protected:
+    struct TableKey
+    {
+        std::string modelName;
+        int modulationClass;
+        int constellationSize;
+        int codeRate;
+        uint32_t dataRate;
+        uint32_t bandwidth;
+
+        bool operator<(const TableKey& other) const;
+    };
+
+    // how the success rate is computed between two neighboring grid points
+    enum IntervalType
+    {
+        CONSTANT,       // the per-bit success rate is the same (e.g. exactly 0 or 1) at and between the points
+        INTERPOLATED,   // geometric interpolation of the exponents is accurate enough
+        DIRECT          // the wrapped model is evaluated
+    };
+
+    struct Table
+    {
+        std::vector<double> exponents;      // -log(per-bit success rate) at minSnrDb + i * snrStepDb
+        std::vector<char> intervalTypes;    // IntervalType of the interval from point i to i+1
+    };
+    typedef std::map<TableKey, Table> TableMap;
+
+    // per-instance cache of the tables looked up so far, to avoid building
+    // a TableKey for every query; a model sees only a handful of modes
+    struct ModeTable
+    {
+        ModulationType mode;
+        const Table *table;
+    };
+
+    static const double minSnrDb;
+    static const double maxSnrDb;
+    static const double snrStepDb;
+    static const double maxError;
+    static const double maxChunkBits;
+    static const double maxExponent;
+    static TableMap tables;
+    static int numInstances;
+
+    std::string modelName;
+    IErrorModel *model;
+    mutable std::vector<ModeTable> modeTables;
+
+  protected:
+    static bool isSameMode(const ModulationType& a, const ModulationType& b);
+    const Table& getTable(const ModulationType& mode) const;
+    const Table& lookupTable(const ModulationType& mode) const;
+    double getExponent(const ModulationType& mode, double snrDb) const;
+    char getIntervalType(const ModulationType& mode, const Table& table, int i) const;
+
+  public:
+    /**
+     * Takes ownership of the model. Models wrapped under the same name
+     * must be equivalent, because they share the tables.
+     */
+    TabulatedErrorModel(const char *modelName, IErrorModel *model);
+    virtual ~TabulatedErrorModel();
+
+    virtual double GetChunkSuccessRate(ModulationType mode, double snr, uint32_t nbits) const;
+};
+
+#endif
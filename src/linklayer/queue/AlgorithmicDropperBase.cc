@@ -18,6 +18,10 @@
 
 #include "AlgorithmicDropperBase.h"
 
+#ifdef WITH_TCP_COMMON
+#include "TCPSegmentOffload.h"
+#endif
+
 void AlgorithmicDropperBase::initialize()
 {
     numGates = gateSize("out");
@@ -38,6 +42,23 @@ void AlgorithmicDropperBase::initialize()
 void AlgorithmicDropperBase::handleMessage(cMessage *msg)
 {
     cPacket *packet = check_and_cast<cPacket*>(msg);
+
+#ifdef WITH_TCP_COMMON
+    // drop decisions are made for the individual segments of TCP super-segments
+    if (TCPSegmentOffload::findSuperSegment(packet))
+    {
+        int arrivalGateId = packet->getArrivalGateId();
+        std::vector<cPacket *> pieces;
+        TCPSegmentOffload::split(packet, pieces);
+        for (unsigned int i = 0; i < pieces.size(); i++)
+        {
+            pieces[i]->setArrival(this, arrivalGateId, simTime());
+            AlgorithmicDropperBase::handleMessage(pieces[i]);
+        }
+        return;
+    }
+#endif
+
     if (shouldDrop(packet))
         dropPacket(packet);
     else
@@ -20,6 +20,19 @@
 
 #include "DropTailQueue.h"
 
+#ifdef WITH_TCP_COMMON
+#include "TCPSegmentOffload.h"
+#endif
+
+static int getSegmentCount(cMessage *msg)
+{
+#ifdef WITH_TCP_COMMON
+    if (msg->isPacket())
+        return TCPSegmentOffload::getSegmentCount(PK(msg));
+#endif
+    return 1;
+}
+
 
 Define_Module(DropTailQueue);
 
@@ -30,9 +43,10 @@ void DropTailQueue::initialize()
     PassiveQueueBase::initialize();
 
     queue.setName(par("queueName"));
+    queueLength = 0;
 
     //statistics
-    emit(queueLengthSignal, queue.length());
+    emit(queueLengthSignal, queueLength);
 
     outGate = gate("out");
 
@@ -40,9 +54,17 @@ void DropTailQueue::initialize()
     frameCapacity = par("frameCapacity");
 }
 
+bool DropTailQueue::canQueueSuperSegment(cPacket *packet, int segmentCount)
+{
+    // a limited queue must decide about dropping segment by segment, and
+    // free the place of each segment as soon as it is sent
+    return frameCapacity == 0;
+}
+
 cMessage *DropTailQueue::enqueue(cMessage *msg)
 {
-    if (frameCapacity && queue.length() >= frameCapacity)
+    int segmentCount = getSegmentCount(msg);
+    if (frameCapacity && queueLength + segmentCount > frameCapacity)
     {
         EV << "Queue full, dropping packet.\n";
         return msg;
@@ -50,7 +72,8 @@ cMessage *DropTailQueue::enqueue(cMessage *msg)
     else
     {
         queue.insert(msg);
-        emit(queueLengthSignal, queue.length());
+        queueLength += segmentCount;
+        emit(queueLengthSignal, queueLength);
         return NULL;
     }
 }
@@ -61,9 +84,10 @@ cMessage *DropTailQueue::dequeue()
         return NULL;
 
     cMessage *msg = (cMessage *)queue.pop();
+    queueLength -= getSegmentCount(msg);
 
     // statistics
-    emit(queueLengthSignal, queue.length());
+    emit(queueLengthSignal, queueLength);
 
     return msg;
 }
@@ -34,6 +34,7 @@ class INET_API DropTailQueue : public PassiveQueueBase
 
     // state
     cQueue queue;
+    int queueLength;  // in segments: TCP super-segments count as the segments they stand for
     cGate *outGate;
 
     // statistics
@@ -42,6 +43,12 @@ class INET_API DropTailQueue : public PassiveQueueBase
   protected:
     virtual void initialize();
 
+    /**
+     * Redefined from PassiveQueueBase: super-segments are queued whole if
+     * the queue is unlimited, i.e. it never drops.
+     */
+    virtual bool canQueueSuperSegment(cPacket *packet, int segmentCount);
+
     /**
      * Redefined from PassiveQueueBase.
      */
@@ -181,6 +181,9 @@ void Radio::initialize(int stage)
     }
     else if (stage == 2)
     {
+        // base class registers the radio in stage 2
+        cc->setRadioReceptionModel(myRadioRef, receptionModel);
+
         NodeStatus *nodeStatus = dynamic_cast<NodeStatus *>(findContainingNode(this)->getSubmodule("status"));
         bool isOperational = (!nodeStatus) || nodeStatus->getState() == NodeStatus::UP;
         if (isOperational)
@@ -223,7 +226,7 @@ Radio::~Radio()
         cancelAndDelete(updateString);
     // delete messages being received
     for (RecvBuff::iterator it = recvBuff.begin(); it!=recvBuff.end(); ++it)
-        delete it->first;
+        delete it->airframe;
 }
 
 bool Radio::handleOperationStage(LifecycleOperation *operation, int stage, IDoneCallback *doneCallback)
@@ -618,12 +621,21 @@ void Radio::handleLowerMsgStart(AirFrame* airframe)
     if (distance<MIN_DISTANCE)
         distance = MIN_DISTANCE;
 
-    double rcvdPower = receptionModel->calculateReceivedPower(airframe->getPSend(), frequency, distance);
+    // ChannelControl computes the received powers of all receivers in one
+    // batch; use that value unless we have moved since the frame was sent
+    double rcvdPower;
+    if (airframe->getPowRecDistance() == distance)
+        rcvdPower = airframe->getPowRec();
+    else
+        rcvdPower = receptionModel->calculateReceivedPower(airframe->getPSend(), frequency, distance);
     if (obstacles && distance > MIN_DISTANCE)
         rcvdPower = obstacles->calculateReceivedPower(rcvdPower, carrierFrequency, framePos, 0, getRadioPosition(), 0);
     airframe->setPowRec(rcvdPower);
     // store the receive power in the recvBuff
-    recvBuff[airframe] = rcvdPower;
+    Reception reception;
+    reception.airframe = airframe;
+    reception.rcvdPower = rcvdPower;
+    recvBuff.push_back(reception);
     updateSensitivity(airframe->getBitrate());
 
     // if receive power is bigger than sensitivity and if not sending
@@ -636,10 +648,9 @@ void Radio::handleLowerMsgStart(AirFrame* airframe)
         EV << "receiving frame " << airframe->getName() << endl;
 
         // Put frame and related SnrList in receive buffer
-        SnrList snrList;
         snrInfo.ptr = airframe;
         snrInfo.rcvdPower = rcvdPower;
-        snrInfo.sList = snrList;
+        snrInfo.sList.clear();
 
         // add initial snr value
         addNewSnr();
@@ -693,30 +704,21 @@ void Radio::handleLowerMsgEnd(AirFrame * airframe)
     if (snrInfo.ptr == airframe)
     {
         EV << "reception of frame over, preparing to send packet to upper layer\n";
-        // get Packet and list out of the receive buffer:
-        SnrList list;
-        list = snrInfo.sList;
 
         // delete the pointer to indicate that no message is currently
-        // being received and clear the list
-
-        double snirMin = snrInfo.sList.begin()->snr;
-        for (SnrList::const_iterator iter = snrInfo.sList.begin(); iter != snrInfo.sList.end(); iter++)
-            if (iter->snr < snirMin)
-                snirMin = iter->snr;
+        // being received (the list is cleared when the next one starts)
         snrInfo.ptr = NULL;
-        snrInfo.sList.clear();
-        airframe->setSnr(10*log10(snirMin)); //ahmed
+        airframe->setSnr(10*log10(snrInfo.minSnr)); //ahmed
         airframe->setLossRate(lossRate);
         // delete the frame from the recvBuff
-        recvBuff.erase(airframe);
+        recvBuff.erase(recvBuff.begin() + findReception(airframe));
 
         //XXX send up the frame:
-        //if (radioModel->isReceivedCorrectly(airframe, list))
+        //if (radioModel->isReceivedCorrectly(airframe, snrInfo.sList))
         //    sendUp(airframe);
         //else
         //    delete airframe;
-        PhyIndication frameState = radioModel->isReceivedCorrectly(airframe, list);
+        PhyIndication frameState = radioModel->isReceivedCorrectly(airframe, snrInfo.sList);
         if (frameState != FRAMEOK)
         {
             airframe->getEncapsulatedPacket()->setKind(frameState);
@@ -741,10 +743,11 @@ void Radio::handleLowerMsgEnd(AirFrame * airframe)
     {
         EV << "reception of noise message over, removing recvdPower from noiseLevel....\n";
         // get the rcvdPower and subtract it from the noiseLevel
-        noiseLevel -= recvBuff[airframe];
+        int index = findReception(airframe);
+        noiseLevel -= recvBuff[index].rcvdPower;
 
         // delete message from the recvBuff
-        recvBuff.erase(airframe);
+        recvBuff.erase(recvBuff.begin() + index);
 
         // update snr info for message currently being received if any
         if (snrInfo.ptr != NULL)
@@ -774,9 +777,19 @@ void Radio::addNewSnr()
     SnrListEntry listEntry;     // create a new entry
     listEntry.time = simTime();
     listEntry.snr = snrInfo.rcvdPower / (BASE_NOISE_LEVEL);
+    if (snrInfo.sList.empty() || listEntry.snr < snrInfo.minSnr)
+        snrInfo.minSnr = listEntry.snr;
     snrInfo.sList.push_back(listEntry);
 }
 
+int Radio::findReception(AirFrame *airframe)
+{
+    for (int i = 0; i < (int)recvBuff.size(); i++)
+        if (recvBuff[i].airframe == airframe)
+            return i;
+    throw cRuntimeError("Frame %s not found in the receive buffer", airframe->getName());
+}
+
 void Radio::changeChannel(int channel)
 {
     if (channel == rs.getChannelNumber())
@@ -787,7 +800,7 @@ void Radio::changeChannel(int channel)
    // Clear the recvBuff
    for (RecvBuff::iterator it = recvBuff.begin(); it!=recvBuff.end(); ++it)
    {
-        AirFrame *airframe = it->first;
+        AirFrame *airframe = it->airframe;
         cMessage *endRxTimer = (cMessage *)airframe->getContextPointer();
         delete airframe;
         delete cancelEvent(endRxTimer);
@@ -1072,7 +1085,7 @@ void Radio::disconnectReceiver()
    // Clear the recvBuff
    for (RecvBuff::iterator it = recvBuff.begin(); it!=recvBuff.end(); ++it)
    {
-        AirFrame *airframe = it->first;
+        AirFrame *airframe = it->airframe;
         cMessage *endRxTimer = (cMessage *)airframe->getContextPointer();
         delete airframe;
         delete cancelEvent(endRxTimer);
@@ -108,6 +108,9 @@ class INET_API Radio : public ChannelAccess, public ILifecycle
     /** Updates the SNR information of the relevant AirFrame */
     virtual void addNewSnr();
 
+    /** Returns the position of the given frame in recvBuff */
+    virtual int findReception(AirFrame *airframe);
+
     /** Create a new AirFrame */
     virtual AirFrame *createAirFrame() {return new AirFrame();}
 
@@ -184,7 +187,8 @@ class INET_API Radio : public ChannelAccess, public ILifecycle
     {
         AirFrame *ptr;    ///< pointer to the message this information belongs to
         double rcvdPower; ///< received power of the message
-        SnrList sList;    ///< stores SNR over time
+        SnrList sList;    ///< stores SNR over time; its storage is reused for subsequent messages
+        double minSnr;    ///< the minimum of the SNR values in sList
     };
 
     /**
@@ -198,17 +202,17 @@ class INET_API Radio : public ChannelAccess, public ILifecycle
      * Typedef used to store received messages together with
      * receive power.
      */
-    struct Compare {
-        bool operator() (AirFrame* const &lhs, AirFrame* const &rhs) const {
-            ASSERT(lhs && rhs);
-            return lhs->getId() < rhs->getId();
-        }
+    struct Reception
+    {
+        AirFrame *airframe;
+        double rcvdPower;
     };
-    typedef std::map<AirFrame*, double, Compare> RecvBuff;
+    typedef std::vector<Reception> RecvBuff;
 
     /**
-     * State: A buffer to store a pointer to a message and the related
-     * receive power.
+     * State: A buffer to store the messages currently on the air at this
+     * radio and the related receive power, in the order of their arrival.
+     * It only holds a few frames at a time, so it is a flat vector.
      */
     RecvBuff recvBuff;
 
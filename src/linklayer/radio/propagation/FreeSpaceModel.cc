@@ -29,6 +29,7 @@
 #include <FWMath.h>
 #include <string>
 #include <iostream>
+#include <typeinfo>
 using namespace std;
 
 Register_Class(FreeSpaceModel);
@@ -49,6 +50,20 @@ void FreeSpaceModel::initializeFrom(cModule *radioModule)
     initializeFreeSpace(radioModule);
 }
 
+bool FreeSpaceModel::isEquivalentFreeSpace(const IReceptionModel *other) const
+{
+    if (typeid(*other) != typeid(*this))
+        return false;
+    const FreeSpaceModel *model = static_cast<const FreeSpaceModel *>(other);
+    return Gr == model->Gr && Gt == model->Gt && L == model->L && pathLossAlpha == model->pathLossAlpha;
+}
+
+bool FreeSpaceModel::isEquivalent(const IReceptionModel *other) const
+{
+    // the fading models derived from this class are not deterministic
+    return typeid(*this) == typeid(FreeSpaceModel) && isEquivalentFreeSpace(other);
+}
+
 
 double FreeSpaceModel::calculateReceivedPower(double pSend, double carrierFrequency, double distance)
 {
@@ -59,6 +74,15 @@ double FreeSpaceModel::calculateReceivedPower(double pSend, double carrierFreque
     return prec;
 }
 
+void FreeSpaceModel::calculateReceivedPowers(double pSend, double carrierFrequency, int numDistances, const double *distances, double *powers)
+{
+    double waveLength = SPEED_OF_LIGHT / carrierFrequency;
+    freeSpace(Gt, Gr, L, pSend, waveLength, numDistances, distances, pathLossAlpha, powers);
+    for (int i = 0; i < numDistances; i++)
+        if (powers[i] > pSend)
+            powers[i] = pSend;
+}
+
 /** @brief calculates the power with the deterministic free space propagation model */
 double FreeSpaceModel::freeSpace(double Gt, double Gr, double L, double Pt, double lambda, double distance, double alpha)
 {
@@ -102,3 +126,16 @@ double FreeSpaceModel::calculateDistance(double pSend, double pRec, double carri
   double aux  = (pSend * lambda * lambda * Gt * Gr / (16.0 *M_PI * M_PI * pRec * L));
   return pow(aux, 1.0 / pathLossAlpha);
 }
+
+void FreeSpaceModel::freeSpace(double Gt, double Gr, double L, double Pt, double lambda, int numDistances, const double *distances, double alpha, double *powers)
+{
+    // same operations in the same order as in the single distance version,
+    // with the distance independent parts computed only once
+    double numerator = Pt * lambda * lambda * Gt * Gr;
+    double denominatorFactor = 16.0 * M_PI * M_PI;
+    for (int i = 0; i < numDistances; i++)
+    {
+        double distance = distances[i];
+        powers[i] = distance == 0.0 ? Pt : numerator / (denominatorFactor * pow(distance, alpha) * L);
+    }
+}
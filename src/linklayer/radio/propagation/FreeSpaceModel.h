@@ -57,14 +57,20 @@ public:
      * To be redefined to calculate the received power of a transmission.
      */
     virtual double calculateReceivedPower(double pSend, double carrierFrequency, double distance);
+    virtual void calculateReceivedPowers(double pSend, double carrierFrequency, int numDistances, const double *distances, double *powers);
     virtual double calculateDistance(double pSend, double pRec, double carrierFrequency);
+    virtual bool isEquivalent(const IReceptionModel *other) const;
     ~FreeSpaceModel() { };
 
     protected:
         double Gr, Gt, L;
         double pathLossAlpha;
         virtual void initializeFreeSpace(cModule *);
+        /** @brief true if other is of the same class as this one and has the same free space parameters */
+        bool isEquivalentFreeSpace(const IReceptionModel *other) const;
         virtual double freeSpace(double Gt, double Gr, double L, double Pt, double lambda, double distance, double pathLossAlpha);
+        /** @brief calculates freeSpace() for several distances at once */
+        void freeSpace(double Gt, double Gr, double L, double Pt, double lambda, int numDistances, const double *distances, double pathLossAlpha, double *powers);
 };
 
 
@@ -40,6 +40,27 @@ class INET_API IReceptionModel : public cObject
      */
     virtual double calculateReceivedPower(double pSend, double carrierFrequency, double distance) = 0;
 
+    /**
+     * Calculates the received power of a transmission at several distances
+     * at once, and stores the results in powers. Deterministic models may
+     * redefine it to hoist the per-transmission computations out of the loop;
+     * the default implementation calls calculateReceivedPower() for each
+     * distance, in order.
+     */
+    virtual void calculateReceivedPowers(double pSend, double carrierFrequency, int numDistances, const double *distances, double *powers)
+    {
+        for (int i = 0; i < numDistances; i++)
+            powers[i] = calculateReceivedPower(pSend, carrierFrequency, distances[i]);
+    }
+
+    /**
+     * Returns true if the other model computes exactly the same received
+     * powers as this one, so that the powers for several radios can be
+     * computed by one calculateReceivedPowers() call. Models that draw
+     * random numbers must return false, even for themselves.
+     */
+    virtual bool isEquivalent(const IReceptionModel *other) const { return false; }
+
     /**
      * Virtual destructor.
      */
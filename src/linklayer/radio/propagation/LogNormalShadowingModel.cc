@@ -59,3 +59,18 @@ double LogNormalShadowingModel::calculateReceivedPower(double pSend, double carr
     return prec;
 }
 
+void LogNormalShadowingModel::calculateReceivedPowers(double pSend, double carrierFrequency, int numDistances, const double *distances, double *powers)
+{
+    // the shadowing samples are drawn in the same order as with calculateReceivedPower()
+    double waveLength = SPEED_OF_LIGHT / carrierFrequency;
+    double d0 = 1.0;
+    double PL_d0 = freeSpace(Gt, Gr, L, pSend, waveLength, d0, pathLossAlpha);
+    double PL_d0_db = 10.0 * log10(pSend / PL_d0);
+    double pSend_db = 10.0 * log10(pSend);
+    for (int i = 0; i < numDistances; i++)
+    {
+        double PL_db = PL_d0_db + 10 * pathLossAlpha * log10(distances[i]/d0) + normal(0.0, sigma);
+        double prec = pow(10, (pSend_db - PL_db)/10.0);
+        powers[i] = prec > pSend ? pSend : prec;
+    }
+}
@@ -45,3 +45,17 @@ double NakagamiModel::calculateReceivedPower(double pSend, double carrierFrequen
         prec = pSend;
      return prec;
 }
+
+void NakagamiModel::calculateReceivedPowers(double pSend, double carrierFrequency, int numDistances, const double *distances, double *powers)
+{
+    // the fading samples are drawn in the same order as with calculateReceivedPower()
+    const int rng = 0;
+    double waveLength = SPEED_OF_LIGHT / carrierFrequency;
+    freeSpace(Gt, Gr, L, pSend, waveLength, numDistances, distances, pathLossAlpha, powers);
+    for (int i = 0; i < numDistances; i++)
+    {
+        double avg_power = powers[i]/1000;
+        double prec = gamma_d(m, avg_power / m, rng) * 1000.0;
+        powers[i] = prec > pSend ? pSend : prec;
+    }
+}
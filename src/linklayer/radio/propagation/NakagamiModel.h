@@ -36,6 +36,7 @@ class INET_API NakagamiModel : public FreeSpaceModel {
      * To be redefined to calculate the received power of a transmission.
      */
     virtual double calculateReceivedPower(double pSend, double carrierFrequency, double distance);
+    virtual void calculateReceivedPowers(double pSend, double carrierFrequency, int numDistances, const double *distances, double *powers);
 
     protected:
     double m;
@@ -51,3 +51,16 @@ double RayleighModel::calculateReceivedPower(double pSend, double carrierFrequen
 
 }
 
+void RayleighModel::calculateReceivedPowers(double pSend, double carrierFrequency, int numDistances, const double *distances, double *powers)
+{
+    // the fading samples are drawn in the same order as with calculateReceivedPower()
+    double waveLength = SPEED_OF_LIGHT / carrierFrequency;
+    freeSpace(Gt, Gr, L, pSend, waveLength, numDistances, distances, pathLossAlpha, powers);
+    for (int i = 0; i < numDistances; i++)
+    {
+        double x = normal(0, 1);
+        double y = normal(0, 1);
+        double prec = powers[i] * 0.5 * (x*x + y*y);
+        powers[i] = prec > pSend ? pSend : prec;
+    }
+}
@@ -49,5 +49,19 @@ double RiceModel::calculateReceivedPower(double pSend, double carrierFrequency,
 
 }
 
-
-
+void RiceModel::calculateReceivedPowers(double pSend, double carrierFrequency, int numDistances, const double *distances, double *powers)
+{
+    // the fading samples are drawn in the same order as with calculateReceivedPower()
+    double waveLength = SPEED_OF_LIGHT / carrierFrequency;
+    double c = 1.0/(2.0*(K+1));
+    double s = sqrt(2*K);
+    freeSpace(Gt, Gr, L, pSend, waveLength, numDistances, distances, pathLossAlpha, powers);
+    for (int i = 0; i < numDistances; i++)
+    {
+        double x = normal(0, 1);
+        double y = normal(0, 1);
+        double rr = c*( (x + s)*(x + s) + y*y);
+        double prec = powers[i] * rr;
+        powers[i] = prec > pSend ? pSend : prec;
+    }
+}
@@ -50,6 +50,8 @@ public:
      * To be redefined to calculate the received power of a transmission.
      */
     virtual double calculateReceivedPower(double pSend, double carrierFrequency, double distance);
+    virtual void calculateReceivedPowers(double pSend, double carrierFrequency, int numDistances, const double *distances, double *powers);
+    virtual bool isEquivalent(const IReceptionModel *other) const;
 private:
     /** @brief  Terrain type */
     string terrain;
@@ -66,6 +68,9 @@ private:
     /** @brief  Transmitter Antenna Gain */
     double Gt;
 
+    /** @brief  Terrain dependent model parameters */
+    double a, b, c, d, s;
+
 };
 
 
@@ -37,6 +37,14 @@ TwoRayGroundModel::~TwoRayGroundModel()
 {
 }
 
+bool TwoRayGroundModel::isEquivalent(const IReceptionModel *other) const
+{
+    if (!isEquivalentFreeSpace(other))
+        return false;
+    const TwoRayGroundModel *model = static_cast<const TwoRayGroundModel *>(other);
+    return ht == model->ht && hr == model->hr;
+}
+
 double TwoRayGroundModel::calculateReceivedPower(double pSend, double carrierFrequency, double distance)
 {
     double waveLength = SPEED_OF_LIGHT / carrierFrequency;
@@ -84,3 +92,22 @@ double TwoRayGroundModel::calculateReceivedPower(double pSend, double carrierFre
         return prec;
     }
 }
+
+void TwoRayGroundModel::calculateReceivedPowers(double pSend, double carrierFrequency, int numDistances, const double *distances, double *powers)
+{
+    // free space below the cross over distance, two-ray ground reflection above it;
+    // see the single distance version for the equations
+    double waveLength = SPEED_OF_LIGHT / carrierFrequency;
+    double dc = (4 * M_PI * ht * hr ) / waveLength;
+    double numerator = pSend * Gt * Gr * (ht * ht * hr * hr);
+    freeSpace(Gt, Gr, L, pSend, waveLength, numDistances, distances, pathLossAlpha, powers);
+    for (int i = 0; i < numDistances; i++)
+    {
+        double distance = distances[i];
+        if (distance != 0 && distance >= dc)
+        {
+            double prec = numerator / (distance * distance * distance * distance * L);
+            powers[i] = prec > pSend ? pSend : prec;
+        }
+    }
+}
@@ -34,8 +34,10 @@ class INET_API TwoRayGroundModel : public FreeSpaceModel {
      * To be redefined to calculate the received power of a transmission.
      */
     virtual double calculateReceivedPower(double pSend, double carrierFrequency, double distance);
+    virtual void calculateReceivedPowers(double pSend, double carrierFrequency, int numDistances, const double *distances, double *powers);
+    virtual bool isEquivalent(const IReceptionModel *other) const;
 
-    private:
+    protected:
     double ht, hr;
 };
 
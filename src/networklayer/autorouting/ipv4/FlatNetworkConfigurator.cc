@@ -23,8 +23,6 @@
 #include "InterfaceEntry.h"
 #include "IPv4InterfaceData.h"
 
-typedef cTopology WeightedTopology;
-
 
 Define_Module(FlatNetworkConfigurator);
 
@@ -35,10 +33,10 @@ void FlatNetworkConfigurator::initialize(int stage)
 
     if (stage == 2)
     {
-        cTopology topo("topo");
+        Topology topo("topo");
         NodeInfoVector nodeInfo; // will be of size topo.nodes[]
 
-        // extract topology into the cTopology object, then fill in
+        // extract topology into the Topology object, then fill in
         // isIPNode, rt and ift members of nodeInfo[]
         extractTopology(topo, nodeInfo);
 
@@ -57,11 +55,11 @@ void FlatNetworkConfigurator::initialize(int stage)
     }
 }
 
-void FlatNetworkConfigurator::extractTopology(cTopology& topo, NodeInfoVector& nodeInfo)
+void FlatNetworkConfigurator::extractTopology(Topology& topo, NodeInfoVector& nodeInfo)
 {
     // extract topology
     topo.extractByProperty("node");
-    EV << "cTopology found " << topo.getNumNodes() << " nodes\n";
+    EV << "Topology found " << topo.getNumNodes() << " nodes\n";
 
     // fill in isIPNode, ift and rt members in nodeInfo[]
     nodeInfo.resize(topo.getNumNodes());
@@ -79,7 +77,7 @@ void FlatNetworkConfigurator::extractTopology(cTopology& topo, NodeInfoVector& n
     }
 }
 
-void FlatNetworkConfigurator::assignAddresses(cTopology& topo, NodeInfoVector& nodeInfo)
+void FlatNetworkConfigurator::assignAddresses(Topology& topo, NodeInfoVector& nodeInfo)
 {
     // assign IPv4 addresses
     uint32 networkAddress = IPv4Address(par("networkAddress").stringValue()).getInt();
@@ -112,12 +110,12 @@ void FlatNetworkConfigurator::assignAddresses(cTopology& topo, NodeInfoVector& n
     }
 }
 
-void FlatNetworkConfigurator::addDefaultRoutes(cTopology& topo, NodeInfoVector& nodeInfo)
+void FlatNetworkConfigurator::addDefaultRoutes(Topology& topo, NodeInfoVector& nodeInfo)
 {
     // add default route to nodes with exactly one (non-loopback) interface
     for (int i=0; i<topo.getNumNodes(); i++)
     {
-        cTopology::Node *node = topo.getNode(i);
+        Topology::Node *node = topo.getNode(i);
 
         // skip bus types
         if (!nodeInfo[i].isIPNode)
@@ -151,59 +149,73 @@ void FlatNetworkConfigurator::addDefaultRoutes(cTopology& topo, NodeInfoVector&
     }
 }
 
-void FlatNetworkConfigurator::fillRoutingTables(cTopology& topo, NodeInfoVector& nodeInfo)
+FlatNetworkConfigurator::RoutesVisitor::RoutesVisitor(FlatNetworkConfigurator *configurator, Topology& topo, NodeInfoVector& nodeInfo) :
+    configurator(configurator), topo(topo), nodeInfo(nodeInfo)
 {
-    // fill in routing tables with static routes
     for (int i=0; i<topo.getNumNodes(); i++)
-    {
-        cTopology::Node *destNode = topo.getNode(i);
+        nodeIndices[topo.getNode(i)] = i;
+}
 
-        // skip bus types
-        if (!nodeInfo[i].isIPNode)
+bool FlatNetworkConfigurator::RoutesVisitor::isTarget(Topology::Node *node)
+{
+    // skip bus types
+    return nodeInfo[nodeIndices[node]].isIPNode;
+}
+
+void FlatNetworkConfigurator::RoutesVisitor::shortestPathsCalculated(Topology::Node *target)
+{
+    configurator->addRoutesTowards(topo, nodeInfo, nodeIndices[target]);
+}
+
+void FlatNetworkConfigurator::fillRoutingTables(Topology& topo, NodeInfoVector& nodeInfo)
+{
+    // fill in routing tables with static routes, calculating the shortest
+    // paths from everywhere towards each IP node in turn
+    RoutesVisitor visitor(this, topo, nodeInfo);
+    topo.calculateWeightedSingleShortestPathsToAll(&visitor);
+}
+
+void FlatNetworkConfigurator::addRoutesTowards(Topology& topo, NodeInfoVector& nodeInfo, int i)
+{
+    Topology::Node *destNode = topo.getNode(i);
+    IPv4Address destAddr = nodeInfo[i].address;
+    std::string destModName = destNode->getModule()->getFullName();
+
+    // add route (with host=destNode) to every routing table in the network
+    // (excepting nodes with only one interface -- there we'll set up a default route)
+    for (int j=0; j<topo.getNumNodes(); j++)
+    {
+        if (i==j) continue;
+        if (!nodeInfo[j].isIPNode)
             continue;
 
-        IPv4Address destAddr = nodeInfo[i].address;
-        std::string destModName = destNode->getModule()->getFullName();
+        Topology::Node *atNode = topo.getNode(j);
+        if (atNode->getNumPaths()==0)
+            continue; // not connected
+        if (nodeInfo[j].usesDefaultRoute)
+            continue; // already added default route here
 
-        // calculate shortest paths from everywhere towards destNode
-        topo.calculateWeightedSingleShortestPathsTo(destNode);
+        IPv4Address atAddr = nodeInfo[j].address;
 
-        // add route (with host=destNode) to every routing table in the network
-        // (excepting nodes with only one interface -- there we'll set up a default route)
-        for (int j=0; j<topo.getNumNodes(); j++)
-        {
-            if (i==j) continue;
-            if (!nodeInfo[j].isIPNode)
-                continue;
-
-            cTopology::Node *atNode = topo.getNode(j);
-            if (atNode->getNumPaths()==0)
-                continue; // not connected
-            if (nodeInfo[j].usesDefaultRoute)
-                continue; // already added default route here
-
-            IPv4Address atAddr = nodeInfo[j].address;
-
-            IInterfaceTable *ift = nodeInfo[j].ift;
-
-            int outputGateId = atNode->getPath(0)->getLocalGate()->getId();
-            InterfaceEntry *ie = ift->getInterfaceByNodeOutputGateId(outputGateId);
-            if (!ie)
-                error("%s has no interface for output gate id %d", ift->getFullPath().c_str(), outputGateId);
-
-            EV << "  from " << atNode->getModule()->getFullName() << "=" << IPv4Address(atAddr);
-            EV << " towards " << destModName << "=" << IPv4Address(destAddr) << " interface " << ie->getName() << endl;
-
-            // add route
-            IRoutingTable *rt = nodeInfo[j].rt;
-            IPv4Route *e = new IPv4Route();
-            e->setDestination(destAddr);
-            e->setNetmask(IPv4Address(255, 255, 255, 255)); // full match needed
-            e->setInterface(ie);
-            e->setSourceType(IPv4Route::MANUAL);
-            //e->getMetric() = 1;
-            rt->addRoute(e);
-        }
+        IInterfaceTable *ift = nodeInfo[j].ift;
+
+        int outputGateId = atNode->getPath(0)->getLocalGate()->getId();
+        InterfaceEntry *ie = ift->getInterfaceByNodeOutputGateId(outputGateId);
+        if (!ie)
+            error("%s has no interface for output gate id %d", ift->getFullPath().c_str(), outputGateId);
+
+        EV << "  from " << atNode->getModule()->getFullName() << "=" << IPv4Address(atAddr);
+        EV << " towards " << destModName << "=" << IPv4Address(destAddr) << " interface " << ie->getName() << endl;
+
+        // add route
+        IRoutingTable *rt = nodeInfo[j].rt;
+        IPv4Route *e = new IPv4Route();
+        e->setDestination(destAddr);
+        e->setNetmask(IPv4Address(255, 255, 255, 255)); // full match needed
+        e->setInterface(ie);
+        e->setSourceType(IPv4Route::MANUAL);
+        //e->getMetric() = 1;
+        rt->addRoute(e);
     }
 }
 
@@ -212,7 +224,7 @@ void FlatNetworkConfigurator::handleMessage(cMessage *msg)
     error("this module doesn't handle messages, it runs only in initialize()");
 }
 
-void FlatNetworkConfigurator::setDisplayString(cTopology& topo, NodeInfoVector& nodeInfo)
+void FlatNetworkConfigurator::setDisplayString(Topology& topo, NodeInfoVector& nodeInfo)
 {
     int numIPNodes = 0;
     for (int i=0; i<topo.getNumNodes(); i++)
@@ -18,9 +18,12 @@
 #ifndef __INET_FLATNETWORKCONFIGURATOR_H
 #define __INET_FLATNETWORKCONFIGURATOR_H
 
+#include <map>
+
 #include "INETDefs.h"
 
 #include "IPv4Address.h"
+#include "Topology.h"
 
 class IInterfaceTable;
 class IRoutingTable;
@@ -47,17 +50,32 @@ class INET_API FlatNetworkConfigurator : public cSimpleModule
     };
     typedef std::vector<NodeInfo> NodeInfoVector;
 
+    // adds the routes towards each IP node as soon as its shortest paths are calculated
+    class RoutesVisitor : public Topology::ShortestPathsVisitor
+    {
+      protected:
+        FlatNetworkConfigurator *configurator;
+        Topology& topo;
+        NodeInfoVector& nodeInfo;
+        std::map<Topology::Node *, int> nodeIndices;
+      public:
+        RoutesVisitor(FlatNetworkConfigurator *configurator, Topology& topo, NodeInfoVector& nodeInfo);
+        virtual bool isTarget(Topology::Node *node);
+        virtual void shortestPathsCalculated(Topology::Node *target);
+    };
+
   protected:
     virtual int numInitStages() const  { return 3; }
     virtual void initialize(int stage);
     virtual void handleMessage(cMessage *msg);
 
-    virtual void extractTopology(cTopology& topo, NodeInfoVector& nodeInfo);
-    virtual void assignAddresses(cTopology& topo, NodeInfoVector& nodeInfo);
-    virtual void addDefaultRoutes(cTopology& topo, NodeInfoVector& nodeInfo);
-    virtual void fillRoutingTables(cTopology& topo, NodeInfoVector& nodeInfo);
+    virtual void extractTopology(Topology& topo, NodeInfoVector& nodeInfo);
+    virtual void assignAddresses(Topology& topo, NodeInfoVector& nodeInfo);
+    virtual void addDefaultRoutes(Topology& topo, NodeInfoVector& nodeInfo);
+    virtual void fillRoutingTables(Topology& topo, NodeInfoVector& nodeInfo);
+    virtual void addRoutesTowards(Topology& topo, NodeInfoVector& nodeInfo, int destIndex);
 
-    virtual void setDisplayString(cTopology& topo, NodeInfoVector& nodeInfo);
+    virtual void setDisplayString(Topology& topo, NodeInfoVector& nodeInfo);
 };
 
 #endif
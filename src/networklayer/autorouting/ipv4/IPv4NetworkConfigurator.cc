@@ -19,12 +19,14 @@
 //
 
 #include <set>
+#include <platdep/platmisc.h>
 #include "stlutils.h"
 #include "IRoutingTable.h"
 #include "IInterfaceTable.h"
 #include "IPv4NetworkConfigurator.h"
 #include "InterfaceEntry.h"
 #include "ModuleAccess.h"
+#include "opp_utils.h"
 #include "XMLUtils.h"
 
 Define_Module(IPv4NetworkConfigurator);
@@ -87,6 +89,15 @@ void IPv4NetworkConfigurator::initialize(int stage)
         addSubnetRoutesParameter = par("addSubnetRoutes");
         addDefaultRoutesParameter = par("addDefaultRoutes");
         optimizeRoutesParameter = par("optimizeRoutes");
+        numThreadsParameter = par("numThreads");
+        if (numThreadsParameter < 1)
+            throw cRuntimeError("Invalid numThreads parameter %d, must be at least 1", numThreadsParameter);
+#ifndef _OPENMP
+        if (numThreadsParameter > 1) {
+            EV_WARN << "numThreads > 1 requires building with OpenMP (make WITH_OPENMP=yes), static routes will be computed in a single thread\n";
+            numThreadsParameter = 1;
+        }
+#endif
         configuration = par("config");
     }
     else if (stage == 2)
@@ -103,18 +114,33 @@ void IPv4NetworkConfigurator::computeConfiguration()
     T(extractTopology(topology));
     // read the configuration from XML; it will serve as input for address assignment
     T(readInterfaceConfiguration(topology));
+    // reload addresses and static routes from the snapshot if it is up to date
+    const char *snapshotFile = par("snapshotFile");
+    uint64 snapshotHash = 0;
+    bool snapshotLoaded = false;
+    if (!isEmpty(snapshotFile)) {
+        snapshotHash = computeSnapshotHash(topology);
+        long startTime = clock();
+        snapshotLoaded = loadSnapshot(topology, snapshotFile, snapshotHash);
+        if (snapshotLoaded)
+            printElapsedTime("loadSnapshot(topology, snapshotFile, snapshotHash)", startTime);
+    }
     // assign addresses to IPv4 nodes
-    if (assignAddressesParameter)
+    if (assignAddressesParameter && !snapshotLoaded)
         T(assignAddresses(topology));
     // read and configure multicast groups from the XML configuration
     T(readMulticastGroupConfiguration(topology));
-    // read and configure manual routes from the XML configuration
-    readManualRouteConfiguration(topology);
+    // read and configure manual routes from the XML configuration (the snapshot contains them)
+    if (!snapshotLoaded)
+        readManualRouteConfiguration(topology);
     // read and configure manual multicast routes from the XML configuration
     readManualMulticastRouteConfiguration(topology);
     // calculate shortest paths, and add corresponding static routes
-    if (addStaticRoutesParameter)
+    if (addStaticRoutesParameter && !snapshotLoaded)
         T(addStaticRoutes(topology));
+    // save addresses and static routes for subsequent runs
+    if (!isEmpty(snapshotFile) && !snapshotLoaded)
+        T(saveSnapshot(topology, snapshotFile, snapshotHash));
     printElapsedTime("initialize", initializeStartTime);
 }
 
@@ -1357,6 +1383,220 @@ void IPv4NetworkConfigurator::dumpConfig(IPv4Topology& topology)
     fclose(f);
 }
 
+#define SNAPSHOT_MAGIC    0x494E4331  // "INC1"; also detects files written on a machine with different byte order
+
+static uint64 hashBytes(uint64 hash, const void *data, size_t size)
+{
+    // 64 bit FNV-1a
+    const unsigned char *bytes = (const unsigned char *)data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+static uint64 hashInt(uint64 hash, int64 value)
+{
+    return hashBytes(hash, &value, sizeof(value));
+}
+
+static uint64 hashString(uint64 hash, const std::string& value)
+{
+    // include the terminating zero to separate consecutive strings
+    return hashBytes(hash, value.c_str(), value.length() + 1);
+}
+
+static uint64 hashXMLElement(uint64 hash, cXMLElement *element)
+{
+    hash = hashString(hash, element->getTagName());
+    const cXMLAttributeMap& attributes = element->getAttributes();
+    for (cXMLAttributeMap::const_iterator it = attributes.begin(); it != attributes.end(); ++it) {
+        hash = hashString(hash, it->first);
+        hash = hashString(hash, it->second);
+    }
+    const char *value = element->getNodeValue();
+    hash = hashString(hash, value ? value : "");
+    for (cXMLElement *child = element->getFirstChild(); child; child = child->getNextSibling())
+        hash = hashXMLElement(hash, child);
+    return hashString(hash, "/");
+}
+
+uint64 IPv4NetworkConfigurator::computeSnapshotHash(IPv4Topology& topology)
+{
+    uint64 hash = 0xCBF29CE484222325ULL;
+
+    // parameters
+    hash = hashInt(hash, assignAddressesParameter);
+    hash = hashInt(hash, assignDisjunctSubnetAddressesParameter);
+    hash = hashInt(hash, addStaticRoutesParameter);
+    hash = hashInt(hash, addSubnetRoutesParameter);
+    hash = hashInt(hash, addDefaultRoutesParameter);
+    hash = hashInt(hash, optimizeRoutesParameter);
+    hash = hashXMLElement(hash, configuration);
+
+    // nodes, their interfaces and the links between them
+    for (int i = 0; i < topology.getNumNodes(); i++) {
+        Node *node = (Node *)topology.getNode(i);
+        hash = hashString(hash, node->module->getFullPath());
+        IInterfaceTable *interfaceTable = node->interfaceTable;
+        if (interfaceTable) {
+            for (int j = 0; j < interfaceTable->getNumInterfaces(); j++) {
+                InterfaceEntry *interfaceEntry = interfaceTable->getInterface(j);
+                hash = hashInt(hash, interfaceEntry->getInterfaceId());
+                hash = hashString(hash, interfaceEntry->getFullName());
+            }
+        }
+        hash = hashInt(hash, node->getNumOutLinks());
+        for (int j = 0; j < node->getNumOutLinks(); j++) {
+            Topology::LinkOut *linkOut = node->getLinkOut(j);
+            hash = hashInt(hash, linkOut->getLocalGateId());
+            hash = hashInt(hash, linkOut->getRemoteNode()->getModuleId());
+            hash = hashInt(hash, linkOut->getRemoteGateId());
+        }
+    }
+    for (int i = 0; i < (int)topology.linkInfos.size(); i++) {
+        LinkInfo *linkInfo = topology.linkInfos[i];
+        hash = hashInt(hash, linkInfo->interfaceInfos.size());
+        for (int j = 0; j < (int)linkInfo->interfaceInfos.size(); j++)
+            hash = hashString(hash, linkInfo->interfaceInfos[j]->getFullPath());
+    }
+    return hash;
+}
+
+bool IPv4NetworkConfigurator::loadSnapshot(IPv4Topology& topology, const char *fileName, uint64 hash)
+{
+    FILE *f = fopen(fileName, "rb");
+    if (!f)
+        return false;
+    std::vector<uint32> words;
+    uint32 word;
+    size_t count;
+    while ((count = fread(&word, 1, sizeof(word), f)) == sizeof(word))
+        words.push_back(word);
+    fclose(f);
+
+    if (count != 0 || words.size() < 3 || words[0] != SNAPSHOT_MAGIC) {
+        EV_WARN << "Configuration snapshot " << fileName << " is corrupt, recomputing configuration" << endl;
+        return false;
+    }
+    if (words[1] != (uint32)hash || words[2] != (uint32)(hash >> 32)) {
+        EV_INFO << "Configuration snapshot " << fileName << " is out of date, recomputing configuration" << endl;
+        return false;
+    }
+
+    // check the whole file against the topology before changing anything,
+    // so that a corrupt file can be handled like a missing one
+    int pos = 3;
+    for (int i = 0; i < topology.getNumNodes() && pos != -1; i++) {
+        Node *node = (Node *)topology.getNode(i);
+        if (pos + 1 > (int)words.size() || words[pos++] != node->interfaceInfos.size()) {
+            pos = -1;
+            break;
+        }
+        pos += 4 * node->interfaceInfos.size();
+        if (pos + 1 > (int)words.size()) {
+            pos = -1;
+            break;
+        }
+        int numRoutes = words[pos++];
+        for (int j = 0; j < numRoutes; j++) {
+            if (pos + 6 > (int)words.size()) {
+                pos = -1;
+                break;
+            }
+            int interfaceId = (int)words[pos + 3];
+            if (interfaceId != -1 && (!node->interfaceTable || !node->interfaceTable->getInterfaceById(interfaceId))) {
+                pos = -1;
+                break;
+            }
+            pos += 6;
+        }
+    }
+    if (pos != (int)words.size()) {
+        EV_WARN << "Configuration snapshot " << fileName << " is corrupt, recomputing configuration" << endl;
+        return false;
+    }
+
+    pos = 3;
+    for (int i = 0; i < topology.getNumNodes(); i++) {
+        Node *node = (Node *)topology.getNode(i);
+        pos++;
+        for (int j = 0; j < (int)node->interfaceInfos.size(); j++) {
+            InterfaceInfo *interfaceInfo = node->interfaceInfos[j];
+            interfaceInfo->address = words[pos++];
+            interfaceInfo->addressSpecifiedBits = words[pos++];
+            interfaceInfo->netmask = words[pos++];
+            interfaceInfo->netmaskSpecifiedBits = words[pos++];
+        }
+        int numRoutes = words[pos++];
+        for (int j = 0; j < numRoutes; j++) {
+            IPv4Route *route = new IPv4Route();
+            node->staticRoutes.push_back(route);
+            route->setDestination(IPv4Address(words[pos++]));
+            route->setNetmask(IPv4Address(words[pos++]));
+            route->setGateway(IPv4Address(words[pos++]));
+            int interfaceId = (int)words[pos++];
+            if (interfaceId != -1)
+                route->setInterface(node->interfaceTable->getInterfaceById(interfaceId));
+            route->setMetric((int)words[pos++]);
+            route->setSourceType((IPv4Route::SourceType)words[pos++]);
+        }
+    }
+    EV_INFO << "Loaded addresses and static routes from configuration snapshot " << fileName << endl;
+    return true;
+}
+
+void IPv4NetworkConfigurator::saveSnapshot(IPv4Topology& topology, const char *fileName, uint64 hash)
+{
+    std::vector<uint32> words;
+    words.push_back(SNAPSHOT_MAGIC);
+    words.push_back((uint32)hash);
+    words.push_back((uint32)(hash >> 32));
+    for (int i = 0; i < topology.getNumNodes(); i++) {
+        Node *node = (Node *)topology.getNode(i);
+        words.push_back(node->interfaceInfos.size());
+        for (int j = 0; j < (int)node->interfaceInfos.size(); j++) {
+            InterfaceInfo *interfaceInfo = node->interfaceInfos[j];
+            words.push_back(interfaceInfo->address);
+            words.push_back(interfaceInfo->addressSpecifiedBits);
+            words.push_back(interfaceInfo->netmask);
+            words.push_back(interfaceInfo->netmaskSpecifiedBits);
+        }
+        words.push_back(node->staticRoutes.size());
+        for (int j = 0; j < (int)node->staticRoutes.size(); j++) {
+            IPv4Route *route = node->staticRoutes[j];
+            words.push_back(route->getDestination().getInt());
+            words.push_back(route->getNetmask().getInt());
+            words.push_back(route->getGateway().getInt());
+            words.push_back(route->getInterface() ? route->getInterface()->getInterfaceId() : -1);
+            words.push_back(route->getMetric());
+            words.push_back(route->getSourceType());
+        }
+    }
+
+    // write a temporary file next to the snapshot and rename it over the snapshot,
+    // so that concurrent runs never see a partially written file
+    std::string tempFileName = std::string(fileName) + "." + OPP_Global::ltostr(getpid()) + ".tmp";
+    FILE *f = fopen(tempFileName.c_str(), "wb");
+    if (!f)
+        throw cRuntimeError("Cannot write configuration snapshot file '%s'", tempFileName.c_str());
+    bool ok = fwrite(&words[0], sizeof(uint32), words.size(), f) == words.size();
+    ok = fclose(f) == 0 && ok;
+    if (!ok) {
+        remove(tempFileName.c_str());
+        throw cRuntimeError("Error writing configuration snapshot file '%s'", tempFileName.c_str());
+    }
+    if (rename(tempFileName.c_str(), fileName) != 0) {
+        // rename() doesn't replace an existing file on Windows
+        remove(fileName);
+        if (rename(tempFileName.c_str(), fileName) != 0) {
+            remove(tempFileName.c_str());
+            throw cRuntimeError("Cannot rename '%s' to configuration snapshot file '%s'", tempFileName.c_str(), fileName);
+        }
+    }
+}
+
 void IPv4NetworkConfigurator::readMulticastGroupConfiguration(IPv4Topology& topology)
 {
     cXMLElementList multicastGroupElements = configuration->getChildrenByTagName("multicast-group");
@@ -1739,120 +1979,167 @@ void IPv4NetworkConfigurator::addStaticRoutes(IPv4Topology& topology)
 {
     // TODO: it should be configurable (via xml?) which nodes need static routes filled in automatically
     // add static routes for all routing tables
+    std::vector<Node *> sourceNodes;
     for (int i = 0; i < topology.getNumNodes(); i++) {
         Node *sourceNode = (Node *)topology.getNode(i);
-        if (!sourceNode->interfaceTable)
-            continue;
-
-        // calculate shortest paths from everywhere to sourceNode
-        // we are going to use the paths in reverse direction (assuming all links are bidirectional)
-        topology.calculateUnweightedSingleShortestPathsTo(sourceNode);
+        if (sourceNode->interfaceTable)
+            sourceNodes.push_back(sourceNode);
+    }
+    topology.preparePathCalculation();
 
-        // check if adding the default routes would be ok (this is an optimization)
-        if (addDefaultRoutesParameter && sourceNode->interfaceInfos.size() == 1 && sourceNode->interfaceInfos[0]->linkInfo->gatewayInterfaceInfo)
+    if (numThreadsParameter <= 1)
+    {
+        Topology::ShortestPaths paths;
+        for (int i = 0; i < (int)sourceNodes.size(); i++) {
+            // calculate shortest paths from everywhere to sourceNode
+            topology.calculateUnweightedSingleShortestPaths(sourceNodes[i], paths);
+            addStaticRoutes(topology, sourceNodes[i], paths, true);
+        }
+    }
+    else
+    {
+        // the work for a source node only reads the topology and only writes the
+        // staticRoutes of that node, so the nodes can be processed concurrently; the
+        // result doesn't depend on the order. no logging from the worker threads
+        // because the output streams of the simulation are not thread-safe
+        std::vector<std::string> errors(sourceNodes.size());
+#ifdef _OPENMP
+        #pragma omp parallel num_threads(numThreadsParameter)
+#endif
         {
-          if (sourceNode->interfaceInfos[0]->addDefaultRoute)
-          {
-            InterfaceInfo *sourceInterfaceInfo = sourceNode->interfaceInfos[0];
-            InterfaceEntry *sourceInterfaceEntry = sourceInterfaceInfo->interfaceEntry;
-            InterfaceInfo *gatewayInterfaceInfo = sourceInterfaceInfo->linkInfo->gatewayInterfaceInfo;
+            Topology::ShortestPaths paths;
+#ifdef _OPENMP
+            #pragma omp for schedule(dynamic)
+#endif
+            for (int i = 0; i < (int)sourceNodes.size(); i++) {
+                try {
+                    topology.calculateUnweightedSingleShortestPaths(sourceNodes[i], paths);
+                    addStaticRoutes(topology, sourceNodes[i], paths, false);
+                }
+                catch (std::exception& e) {
+                    errors[i] = e.what();
+                }
+            }
+        }
+        for (int i = 0; i < (int)sourceNodes.size(); i++) {
+            if (!errors[i].empty())
+                throw cRuntimeError("Cannot add static routes to %s: %s", sourceNodes[i]->getModule()->getFullPath().c_str(), errors[i].c_str());
+            EV_DEBUG << "Added " << sourceNodes[i]->staticRoutes.size() << " static routes to " << sourceNodes[i]->getModule()->getFullPath() << endl;
+        }
+    }
+}
 
-            // add a network route for the local network using ARP
-            IPv4Route *route = new IPv4Route();
-            route->setDestination(sourceInterfaceInfo->getAddress().doAnd(sourceInterfaceInfo->getNetmask()));
-            route->setGateway(IPv4Address::UNSPECIFIED_ADDRESS);
-            route->setNetmask(sourceInterfaceInfo->getNetmask());
-            route->setInterface(sourceInterfaceEntry);
-            route->setSourceType(IPv4Route::MANUAL);
-            sourceNode->staticRoutes.push_back(route);
-
-            // add a default route towards the only one gateway
-            route = new IPv4Route();
-            IPv4Address gateway = gatewayInterfaceInfo->getAddress();
-            route->setDestination(IPv4Address::UNSPECIFIED_ADDRESS);
-            route->setNetmask(IPv4Address::UNSPECIFIED_ADDRESS);
-            route->setGateway(gateway);
-            route->setInterface(sourceInterfaceEntry);
-            route->setSourceType(IPv4Route::MANUAL);
-            sourceNode->staticRoutes.push_back(route);
-
-            // skip building and optimizing the whole routing table
+void IPv4NetworkConfigurator::addStaticRoutes(IPv4Topology& topology, Node *sourceNode, const Topology::ShortestPaths& paths, bool logRoutes)
+{
+    // paths contains the shortest paths from everywhere to sourceNode
+    // we are going to use the paths in reverse direction (assuming all links are bidirectional)
+
+    // check if adding the default routes would be ok (this is an optimization)
+    if (addDefaultRoutesParameter && sourceNode->interfaceInfos.size() == 1 && sourceNode->interfaceInfos[0]->linkInfo->gatewayInterfaceInfo)
+    {
+      if (sourceNode->interfaceInfos[0]->addDefaultRoute)
+      {
+        InterfaceInfo *sourceInterfaceInfo = sourceNode->interfaceInfos[0];
+        InterfaceEntry *sourceInterfaceEntry = sourceInterfaceInfo->interfaceEntry;
+        InterfaceInfo *gatewayInterfaceInfo = sourceInterfaceInfo->linkInfo->gatewayInterfaceInfo;
+
+        // add a network route for the local network using ARP
+        IPv4Route *route = new IPv4Route();
+        route->setDestination(sourceInterfaceInfo->getAddress().doAnd(sourceInterfaceInfo->getNetmask()));
+        route->setGateway(IPv4Address::UNSPECIFIED_ADDRESS);
+        route->setNetmask(sourceInterfaceInfo->getNetmask());
+        route->setInterface(sourceInterfaceEntry);
+        route->setSourceType(IPv4Route::MANUAL);
+        sourceNode->staticRoutes.push_back(route);
+
+        // add a default route towards the only one gateway
+        route = new IPv4Route();
+        IPv4Address gateway = gatewayInterfaceInfo->getAddress();
+        route->setDestination(IPv4Address::UNSPECIFIED_ADDRESS);
+        route->setNetmask(IPv4Address::UNSPECIFIED_ADDRESS);
+        route->setGateway(gateway);
+        route->setInterface(sourceInterfaceEntry);
+        route->setSourceType(IPv4Route::MANUAL);
+        sourceNode->staticRoutes.push_back(route);
+
+        // skip building and optimizing the whole routing table
+        if (logRoutes)
             EV_DEBUG << "Adding default routes to " << sourceNode->getModule()->getFullPath() << ", node has only one (non-loopback) interface\n";
-          }
-        }
-        else
+      }
+    }
+    else
+    {
+        // add a route to all destinations in the network
+        for (int j = 0; j < topology.getNumNodes(); j++)
         {
-            // add a route to all destinations in the network
-            for (int j = 0; j < topology.getNumNodes(); j++)
+            // extract destination
+            Node *destinationNode = (Node *)topology.getNode(j);
+            if (sourceNode == destinationNode)
+                continue;
+            if (paths.getNumPaths(destinationNode) == 0)
+                continue;
+            if (!destinationNode->interfaceTable)
+                continue;
+
+            // determine next hop interface
+            // find next hop interface (the last IP interface on the path that is not in the source node)
+            Node *node = destinationNode;
+            Link *link = NULL;
+            InterfaceInfo *nextHopInterfaceInfo = NULL;
+            while (node != sourceNode)
             {
-                // extract destination
-                Node *destinationNode = (Node *)topology.getNode(j);
-                if (sourceNode == destinationNode)
-                    continue;
-                if (destinationNode->getNumPaths() == 0)
-                    continue;
-                if (!destinationNode->interfaceTable)
-                    continue;
-
-                // determine next hop interface
-                // find next hop interface (the last IP interface on the path that is not in the source node)
-                Node *node = destinationNode;
-                Link *link = NULL;
-                InterfaceInfo *nextHopInterfaceInfo = NULL;
-                while (node != sourceNode)
-                {
-                    link = (Link *)node->getPath(0);
-                    if (node->interfaceTable && node != sourceNode && link->sourceInterfaceInfo)
-                        nextHopInterfaceInfo = link->sourceInterfaceInfo;
-                    node = (Node *)node->getPath(0)->getRemoteNode();
-                }
+                link = (Link *)paths.getPath(node, 0);
+                if (node->interfaceTable && node != sourceNode && link->sourceInterfaceInfo)
+                    nextHopInterfaceInfo = link->sourceInterfaceInfo;
+                node = (Node *)paths.getPath(node, 0)->getRemoteNode();
+            }
 
-                // determine source interface
-                if (link->destinationInterfaceInfo && link->destinationInterfaceInfo->addStaticRoute)
-                {
-                    InterfaceEntry *sourceInterfaceEntry = link->destinationInterfaceInfo->interfaceEntry;
+            // determine source interface
+            if (link->destinationInterfaceInfo && link->destinationInterfaceInfo->addStaticRoute)
+            {
+                InterfaceEntry *sourceInterfaceEntry = link->destinationInterfaceInfo->interfaceEntry;
 
-                    // add the same routes for all destination interfaces (IP packets are accepted from any interface at the destination)
-                    for (int j = 0; j < (int)destinationNode->interfaceInfos.size(); j++)
+                // add the same routes for all destination interfaces (IP packets are accepted from any interface at the destination)
+                for (int j = 0; j < (int)destinationNode->interfaceInfos.size(); j++)
+                {
+                    InterfaceInfo *destinationInterfaceInfo = destinationNode->interfaceInfos[j];
+                    InterfaceEntry *destinationInterfaceEntry = destinationInterfaceInfo->interfaceEntry;
+                    IPv4Address destinationAddress = destinationInterfaceInfo->getAddress();
+                    IPv4Address destinationNetmask = destinationInterfaceInfo->getNetmask();
+                    if (!destinationInterfaceEntry->isLoopback() && !destinationAddress.isUnspecified())
                     {
-                        InterfaceInfo *destinationInterfaceInfo = destinationNode->interfaceInfos[j];
-                        InterfaceEntry *destinationInterfaceEntry = destinationInterfaceInfo->interfaceEntry;
-                        IPv4Address destinationAddress = destinationInterfaceInfo->getAddress();
-                        IPv4Address destinationNetmask = destinationInterfaceInfo->getNetmask();
-                        if (!destinationInterfaceEntry->isLoopback() && !destinationAddress.isUnspecified())
+                        IPv4Route *route = new IPv4Route();
+                        IPv4Address gatewayAddress = nextHopInterfaceInfo->getAddress();
+                        if (addSubnetRoutesParameter && destinationNode->interfaceInfos.size() == 1 && destinationNode->interfaceInfos[0]->linkInfo->gatewayInterfaceInfo
+                                && destinationNode->interfaceInfos[0]->addSubnetRoute)
                         {
-                            IPv4Route *route = new IPv4Route();
-                            IPv4Address gatewayAddress = nextHopInterfaceInfo->getAddress();
-                            if (addSubnetRoutesParameter && destinationNode->interfaceInfos.size() == 1 && destinationNode->interfaceInfos[0]->linkInfo->gatewayInterfaceInfo
-                                    && destinationNode->interfaceInfos[0]->addSubnetRoute)
-                            {
-                                route->setDestination(destinationAddress.doAnd(destinationNetmask));
-                                route->setNetmask(destinationNetmask);
-                            }
-                            else
-                            {
-                                route->setDestination(destinationAddress);
-                                route->setNetmask(IPv4Address::ALLONES_ADDRESS);
-                            }
-                            route->setInterface(sourceInterfaceEntry);
-                            if (gatewayAddress != destinationAddress)
-                                route->setGateway(gatewayAddress);
-                            route->setSourceType(IPv4Route::MANUAL);
-                            if (containsRoute(sourceNode->staticRoutes, route))
-                                delete route;
-                            else {
-                                sourceNode->staticRoutes.push_back(route);
+                            route->setDestination(destinationAddress.doAnd(destinationNetmask));
+                            route->setNetmask(destinationNetmask);
+                        }
+                        else
+                        {
+                            route->setDestination(destinationAddress);
+                            route->setNetmask(IPv4Address::ALLONES_ADDRESS);
+                        }
+                        route->setInterface(sourceInterfaceEntry);
+                        if (gatewayAddress != destinationAddress)
+                            route->setGateway(gatewayAddress);
+                        route->setSourceType(IPv4Route::MANUAL);
+                        if (containsRoute(sourceNode->staticRoutes, route))
+                            delete route;
+                        else {
+                            sourceNode->staticRoutes.push_back(route);
+                            if (logRoutes)
                                 EV_DEBUG << "Adding route " << sourceInterfaceEntry->getFullPath() << " -> " << destinationInterfaceEntry->getFullPath() << " as " << route->info() << endl;
-                            }
                         }
                     }
                 }
             }
-
-            // optimize routing table to save memory and increase lookup performance
-            if (optimizeRoutesParameter)
-                optimizeRoutes(sourceNode->staticRoutes);
         }
+
+        // optimize routing table to save memory and increase lookup performance
+        if (optimizeRoutesParameter)
+            optimizeRoutes(sourceNode->staticRoutes);
     }
 }
 
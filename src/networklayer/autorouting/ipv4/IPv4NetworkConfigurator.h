@@ -200,6 +200,7 @@ class INET_API IPv4NetworkConfigurator : public cSimpleModule, public IPvXAddres
         bool addSubnetRoutesParameter;
         bool addDefaultRoutesParameter;
         bool optimizeRoutesParameter;
+        int numThreadsParameter;
         cXMLElement *configuration;
 
         // internal state
@@ -277,6 +278,14 @@ class INET_API IPv4NetworkConfigurator : public cSimpleModule, public IPvXAddres
          */
         virtual void addStaticRoutes(IPv4Topology& topology);
 
+        /**
+         * Adds static routes to the routing table of the given node, using the
+         * shortest paths towards it that have already been calculated. Only
+         * modifies the given node, and logs only if logRoutes is true, so that
+         * it can be called concurrently for different nodes.
+         */
+        virtual void addStaticRoutes(IPv4Topology& topology, Node *sourceNode, const Topology::ShortestPaths& paths, bool logRoutes);
+
         /**
          * Destructively optimizes the given IPv4 routes by merging some of them.
          * The resulting routes might be different in that they will route packets
@@ -300,6 +309,27 @@ class INET_API IPv4NetworkConfigurator : public cSimpleModule, public IPvXAddres
         virtual void dumpRoutes(IPv4Topology& topology);
         virtual void dumpConfig(IPv4Topology& topology);
 
+        /**
+         * Returns a hash of everything the address assignment and the static
+         * routes depend on: the extracted topology, the XML configuration and
+         * the relevant module parameters.
+         */
+        virtual uint64 computeSnapshotHash(IPv4Topology& topology);
+
+        /**
+         * Restores the interface addresses and the static routes of all nodes
+         * from the given snapshot file. Returns false without changing anything
+         * if the file doesn't exist, it is corrupt or it was saved for a different
+         * hash.
+         */
+        virtual bool loadSnapshot(IPv4Topology& topology, const char *fileName, uint64 hash);
+
+        /**
+         * Saves the interface addresses and the static routes of all nodes into
+         * the given snapshot file. The file is replaced atomically.
+         */
+        virtual void saveSnapshot(IPv4Topology& topology, const char *fileName, uint64 hash);
+
         // helper functions
         virtual void extractWiredNeighbors(IPv4Topology& topology, Topology::LinkOut *linkOut, LinkInfo* linkInfo, std::set<InterfaceEntry *>& interfacesSeen, std::vector<Node *>& nodesVisited);
         virtual void extractWirelessNeighbors(IPv4Topology& topology, const char *wirelessId, LinkInfo* linkInfo, std::set<InterfaceEntry *>& interfacesSeen, std::vector<Node *>& nodesVisited);
@@ -36,6 +36,10 @@
 #include "NodeStatus.h"
 #include "NotificationBoard.h"
 
+#ifdef WITH_TCP_COMMON
+#include "TCPSegmentOffload.h"
+#endif
+
 Define_Module(IPv4);
 
 //TODO TRANSLATE
@@ -727,6 +731,15 @@ void IPv4::fragmentAndSend(IPv4Datagram *datagram, const InterfaceEntry *ie, IPv
         return;
     }
 
+#ifdef WITH_TCP_COMMON
+    // TCP super-segments are not fragmented: they stand for several datagrams that fit
+    if (TCPSegmentOffload::findSuperSegment(datagram))
+    {
+        sendDatagramToOutput(datagram, ie, nextHopAddr);
+        return;
+    }
+#endif
+
     // if "don't fragment" bit is set, throw datagram away and send ICMP error message
     if (datagram->getDontFragment())
     {
@@ -0,0 +1,175 @@
+//
+// Copyright (C) 2014 OpenSim Ltd.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <algorithm>
+
+#include "IPv4RouteTrie.h"
+
+#include "IPv4Route.h"
+
+
+IPv4RouteTrie::IPv4RouteTrie(RouteLessThan lessThan) : lessThan(lessThan)
+{
+    root = new Node(0, 0);
+}
+
+IPv4RouteTrie::~IPv4RouteTrie()
+{
+    deleteSubtree(root);
+}
+
+void IPv4RouteTrie::deleteSubtree(Node *node)
+{
+    if (node)
+    {
+        deleteSubtree(node->children[0]);
+        deleteSubtree(node->children[1]);
+        delete node;
+    }
+}
+
+void IPv4RouteTrie::clear()
+{
+    deleteSubtree(root);
+    root = new Node(0, 0);
+    routeToNode.clear();
+}
+
+int IPv4RouteTrie::getCommonPrefixLength(uint32 a, uint32 b, int maxLength)
+{
+    uint32 diff = a ^ b;
+    int length = 0;
+    while (length < maxLength && !(diff & 0x80000000u))
+    {
+        diff <<= 1;
+        length++;
+    }
+    return length;
+}
+
+IPv4RouteTrie::Node *IPv4RouteTrie::findOrCreateNode(uint32 prefix, int prefixLength)
+{
+    // invariant: node->prefix is a prefix of 'prefix', and node->prefixLength <= prefixLength
+    Node *node = root;
+    while (node->prefixLength < prefixLength)
+    {
+        int bit = getBit(prefix, node->prefixLength);
+        Node *child = node->children[bit];
+        if (!child)
+        {
+            // new leaf
+            Node *leaf = new Node(prefix, prefixLength);
+            leaf->parent = node;
+            node->children[bit] = leaf;
+            return leaf;
+        }
+
+        int commonLength = getCommonPrefixLength(child->prefix, prefix, std::min(child->prefixLength, prefixLength));
+        if (commonLength == child->prefixLength)
+        {
+            // the child is on the path: descend
+            node = child;
+            continue;
+        }
+
+        // the path diverges from the child's prefix (or ends) inside the compressed edge: split the edge
+        Node *newNode = new Node(prefix & getMask(commonLength), commonLength);
+        newNode->parent = node;
+        node->children[bit] = newNode;
+        newNode->children[getBit(child->prefix, commonLength)] = child;
+        child->parent = newNode;
+        if (commonLength == prefixLength)
+            return newNode;
+        Node *leaf = new Node(prefix, prefixLength);
+        leaf->parent = newNode;
+        newNode->children[getBit(prefix, commonLength)] = leaf;
+        return leaf;
+    }
+    return node;
+}
+
+void IPv4RouteTrie::removeNodeIfRedundant(Node *node)
+{
+    // nodes without routes are needed only where the trie branches
+    while (node != root && node->routes.empty())
+    {
+        if (node->children[0] && node->children[1])
+            return;
+        Node *parent = node->parent;
+        Node *child = node->children[0] ? node->children[0] : node->children[1];
+        parent->children[parent->children[0] == node ? 0 : 1] = child;
+        delete node;
+        if (child)
+        {
+            child->parent = parent;
+            return;
+        }
+        node = parent;
+    }
+}
+
+void IPv4RouteTrie::addRoute(IPv4Route *route)
+{
+    ASSERT(routeToNode.find(route) == routeToNode.end());
+    int prefixLength = route->getNetmask().getNetmaskLength();
+    Node *node = findOrCreateNode(route->getDestination().getInt() & getMask(prefixLength), prefixLength);
+
+    // same ordering as RoutingTable::routes
+    RouteVector::iterator pos = std::upper_bound(node->routes.begin(), node->routes.end(), route, lessThan);
+    node->routes.insert(pos, route);
+    routeToNode[route] = node;
+}
+
+bool IPv4RouteTrie::removeRoute(IPv4Route *route)
+{
+    RouteToNodeMap::iterator it = routeToNode.find(route);
+    if (it == routeToNode.end())
+        return false;
+    Node *node = it->second;
+    routeToNode.erase(it);
+    node->routes.erase(std::find(node->routes.begin(), node->routes.end(), route));
+    removeNodeIfRedundant(node);
+    return true;
+}
+
+IPv4Route *IPv4RouteTrie::findBestMatchingRoute(const IPv4Address& dest) const
+{
+    uint32 address = dest.getInt();
+
+    // collect the nodes with routes along the path, from the shortest prefix to the longest
+    const Node *matches[33];
+    int numMatches = 0;
+    const Node *node = root;
+    while (node && (address & getMask(node->prefixLength)) == node->prefix)
+    {
+        if (!node->routes.empty())
+            matches[numMatches++] = node;
+        if (node->prefixLength == 32)
+            break;
+        node = node->children[getBit(address, node->prefixLength)];
+    }
+
+    // longest prefix first; skip invalid routes
+    for (int i = numMatches - 1; i >= 0; i--)
+    {
+        const RouteVector& routes = matches[i]->routes;
+        for (RouteVector::const_iterator it = routes.begin(); it != routes.end(); ++it)
+            if ((*it)->isValid())
+                return *it;
+    }
+    return NULL;
+}
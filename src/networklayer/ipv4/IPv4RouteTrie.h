@@ -0,0 +1,107 @@
+//
+// Copyright (C) 2014 OpenSim Ltd.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __INET_IPV4ROUTETRIE_H
+#define __INET_IPV4ROUTETRIE_H
+
+#include <vector>
+#include <map>
+
+#include "INETDefs.h"
+
+#include "IPv4Address.h"
+
+class IPv4Route;
+
+/**
+ * Path-compressed binary (Patricia) trie over the destination prefixes of
+ * unicast IPv4 routes, used by RoutingTable for longest prefix matching.
+ *
+ * Every node stands for a destination/netmask pair, and stores the routes
+ * with exactly that destination and netmask, ordered by the comparison
+ * function given in the constructor (best route first). Nodes without routes
+ * are only kept where the trie branches.
+ *
+ * The trie does not own the routes. Routes are located by pointer on removal,
+ * so a route may be removed after its destination or netmask has changed.
+ *
+ * See IPv6RouteTrie for the IPv6 counterpart, and why they are separate.
+ */
+class INET_API IPv4RouteTrie
+{
+  public:
+    typedef bool (*RouteLessThan)(const IPv4Route *a, const IPv4Route *b);
+    typedef std::vector<IPv4Route *> RouteVector;
+
+  protected:
+    struct Node
+    {
+        uint32 prefix;      // destination address, bits beyond prefixLength are zero
+        int prefixLength;   // netmask length
+        RouteVector routes; // routes with this destination/netmask, best first
+        Node *parent;
+        Node *children[2];  // indexed by the bit following the prefix
+
+        Node(uint32 prefix, int prefixLength) : prefix(prefix), prefixLength(prefixLength), parent(NULL) { children[0] = children[1] = NULL; }
+    };
+
+    typedef std::map<const IPv4Route *, Node *> RouteToNodeMap;
+
+    RouteLessThan lessThan;
+    Node *root;  // the 0.0.0.0/0 node, always present
+    RouteToNodeMap routeToNode;
+
+  protected:
+    static uint32 getMask(int length) { return length == 0 ? 0 : 0xffffffffu << (32 - length); }
+    static int getBit(uint32 address, int index) { return (address >> (31 - index)) & 1; }
+    static int getCommonPrefixLength(uint32 a, uint32 b, int maxLength);
+
+    Node *findOrCreateNode(uint32 prefix, int prefixLength);
+    void removeNodeIfRedundant(Node *node);
+    void deleteSubtree(Node *node);
+
+  public:
+    IPv4RouteTrie(RouteLessThan lessThan);
+    ~IPv4RouteTrie();
+
+    /**
+     * Adds the route under its current destination and netmask.
+     */
+    void addRoute(IPv4Route *route);
+
+    /**
+     * Removes the route, and returns true if it was found.
+     */
+    bool removeRoute(IPv4Route *route);
+
+    /**
+     * Removes all routes.
+     */
+    void clear();
+
+    /**
+     * Returns the number of routes stored.
+     */
+    int getNumRoutes() const { return routeToNode.size(); }
+
+    /**
+     * Returns the best valid route with the longest matching prefix, or NULL.
+     */
+    IPv4Route *findBestMatchingRoute(const IPv4Address& dest) const;
+};
+
+#endif
@@ -52,10 +52,11 @@ std::ostream& operator<<(std::ostream& os, const IPv4MulticastRoute& e)
     return os;
 };
 
-RoutingTable::RoutingTable()
+RoutingTable::RoutingTable() : routeTrie(routeLessThan)
 {
     ift = NULL;
     nb = NULL;
+    routingCacheSize = 0;
 }
 
 RoutingTable::~RoutingTable()
@@ -77,6 +78,9 @@ void RoutingTable::initialize(int stage)
 
         IPForward = par("IPForward").boolValue();
         multicastForward = par("forwardMulticast");
+        routingCacheSize = par("routingCacheSize");
+        if (routingCacheSize < 0)
+            throw cRuntimeError("Invalid routingCacheSize %d", routingCacheSize);
 
         nb->subscribe(this, NF_INTERFACE_CREATED);
         nb->subscribe(this, NF_INTERFACE_DELETED);
@@ -233,6 +237,7 @@ void RoutingTable::deleteInterfaceRoutes(InterfaceEntry *entry)
         if (route->getInterface() == entry)
         {
             it = routes.erase(it);
+            routeTrie.removeRoute(route);
             ASSERT(route->getRoutingTable() == this); // still filled in, for the listeners' benefit
             nb->fireChangeNotification(NF_IPv4_ROUTE_DELETED, route);
             delete route;
@@ -278,6 +283,7 @@ void RoutingTable::deleteInterfaceRoutes(InterfaceEntry *entry)
 void RoutingTable::invalidateCache()
 {
     routingCache.clear();
+    routingCacheLRU.clear();
     localAddresses.clear();
     localBroadcastAddresses.clear();
 }
@@ -467,6 +473,7 @@ void RoutingTable::purge()
         else
         {
             it = routes.erase(it);
+            routeTrie.removeRoute(route);
             ASSERT(route->getRoutingTable() == this); // still filled in, for the listeners' benefit
             nb->fireChangeNotification(NF_IPv4_ROUTE_DELETED, route);
             delete route;
@@ -504,27 +511,32 @@ IPv4Route *RoutingTable::findBestMatchingRoute(const IPv4Address& dest) const
     RoutingCache::iterator it = routingCache.find(dest);
     if (it != routingCache.end())
     {
-        if (it->second==NULL || it->second->isValid())
-            return it->second;
+        RoutingCacheEntry& cacheEntry = it->second;
+        if (cacheEntry.route==NULL || cacheEntry.route->isValid())
+        {
+            routingCacheLRU.splice(routingCacheLRU.begin(), routingCacheLRU, cacheEntry.lruPosition);
+            return cacheEntry.route;
+        }
     }
 
     // find best match (one with longest prefix)
     // default route has zero prefix length, so (if exists) it'll be selected as last resort
-    IPv4Route *bestRoute = NULL;
-    for (RouteVector::const_iterator i=routes.begin(); i!=routes.end(); ++i)
+    IPv4Route *bestRoute = routeTrie.findBestMatchingRoute(dest);
+
+    if (it != routingCache.end())
+        it->second.route = bestRoute;
+    else if (routingCacheSize > 0)
     {
-        IPv4Route *e = *i;
-        if (e->isValid())
+        if ((int)routingCache.size() >= routingCacheSize)
         {
-            if (IPv4Address::maskedAddrAreEqual(dest, e->getDestination(), e->getNetmask())) // match
-            {
-                bestRoute = const_cast<IPv4Route *>(e);
-                break;
-            }
+            routingCache.erase(routingCacheLRU.back());
+            routingCacheLRU.pop_back();
         }
+        routingCacheLRU.push_front(dest);
+        RoutingCacheEntry& cacheEntry = routingCache[dest];
+        cacheEntry.route = bestRoute;
+        cacheEntry.lruPosition = routingCacheLRU.begin();
     }
-
-    routingCache[dest] = bestRoute;
     return bestRoute;
 }
 
@@ -644,6 +656,7 @@ void RoutingTable::internalAddRoute(IPv4Route *entry)
     // stop at the first match when doing the longest netmask matching
     RouteVector::iterator pos = upper_bound(routes.begin(), routes.end(), entry, routeLessThan);
     routes.insert(pos, entry);
+    routeTrie.addRoute(entry);
 
     entry->setRoutingTable(this);
 }
@@ -666,6 +679,7 @@ IPv4Route *RoutingTable::internalRemoveRoute(IPv4Route *entry)
     if (i!=routes.end())
     {
         routes.erase(i);
+        routeTrie.removeRoute(entry);
         return entry;
     }
     return NULL;
@@ -858,6 +872,7 @@ void RoutingTable::updateNetmaskRoutes()
             std::vector<IPv4Route *>::iterator it = routes.begin()+(k--);  // '--' is necessary because indices shift down
             IPv4Route *route = *it;
             routes.erase(it);
+            routeTrie.removeRoute(route);
             ASSERT(route->getRoutingTable() == this); // still filled in, for the listeners' benefit
             nb->fireChangeNotification(NF_IPv4_ROUTE_DELETED, route);
             delete route;
@@ -884,6 +899,7 @@ void RoutingTable::updateNetmaskRoutes()
             route->setRoutingTable(this);
             RouteVector::iterator pos = upper_bound(routes.begin(), routes.end(), route, routeLessThan);
             routes.insert(pos, route);
+            routeTrie.addRoute(route);
             nb->fireChangeNotification(NF_IPv4_ROUTE_ADDED, route);
         }
     }
@@ -29,11 +29,13 @@
 #define __ROUTINGTABLE_H
 
 #include <vector>
+#include <list>
 
 #include "INETDefs.h"
 
 #include "INotifiable.h"
 #include "IPv4Address.h"
+#include "IPv4RouteTrie.h"
 #include "IRoutingTable.h"
 #include "ILifecycle.h"
 
@@ -86,9 +88,18 @@ class INET_API RoutingTable: public cSimpleModule, public IRoutingTable, protect
     typedef IPv4MulticastRoute::OutInterface OutInterface;
     typedef IPv4MulticastRoute::OutInterfaceVector OutInterfaceVector;
 
-    // routing cache: maps destination address to the route
-    typedef std::map<IPv4Address, IPv4Route *> RoutingCache;
+    // routing cache: maps destination address to the route; when it is full,
+    // the least recently used destination is evicted
+    typedef std::list<IPv4Address> RoutingCacheLRUList;
+    struct RoutingCacheEntry
+    {
+        IPv4Route *route;
+        RoutingCacheLRUList::iterator lruPosition;
+    };
+    typedef std::map<IPv4Address, RoutingCacheEntry> RoutingCache;
+    int routingCacheSize; // maximum number of cached destinations; 0 disables the cache
     mutable RoutingCache routingCache;
+    mutable RoutingCacheLRUList routingCacheLRU; // most recently used first
 
     // local addresses cache (to speed up isLocalAddress())
     typedef std::set<IPv4Address> AddressSet;
@@ -103,6 +114,7 @@ class INET_API RoutingTable: public cSimpleModule, public IRoutingTable, protect
 
     typedef std::vector<IPv4Route *> RouteVector;
     RouteVector routes;          // Unicast route array, sorted by netmask desc, dest asc, metric asc
+    IPv4RouteTrie routeTrie;     // the same routes, indexed by destination prefix for findBestMatchingRoute()
 
     typedef std::vector<IPv4MulticastRoute*> MulticastRouteVector;
     MulticastRouteVector multicastRoutes; // Multicast route array, sorted by netmask desc, origin asc, metric asc
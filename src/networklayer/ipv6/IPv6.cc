@@ -44,6 +44,10 @@
 #include "ModuleAccess.h"
 #include "NodeStatus.h"
 
+#ifdef WITH_TCP_COMMON
+#include "TCPSegmentOffload.h"
+#endif
+
 #define FRAGMENT_TIMEOUT 60   // 60 sec, from IPv6 RFC
 
 
@@ -743,6 +747,15 @@ void IPv6::fragmentAndSend(IPv6Datagram *datagram, const InterfaceEntry *ie, con
         return;
     }
 
+#ifdef WITH_TCP_COMMON
+    // TCP super-segments are not fragmented: they stand for several datagrams that fit
+    if (TCPSegmentOffload::findSuperSegment(datagram))
+    {
+        sendDatagramToOutput(datagram, ie, nextHopAddr);
+        return;
+    }
+#endif
+
     // routed datagrams are not fragmented
     if (!fromHL)
     {
@@ -0,0 +1,178 @@
+//
+// Copyright (C) 2014 OpenSim Ltd.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <algorithm>
+
+#include "IPv6RouteTrie.h"
+
+#include "RoutingTable6.h"
+
+
+IPv6RouteTrie::IPv6RouteTrie(RouteLessThan lessThan) : lessThan(lessThan)
+{
+    root = new Node(IPv6Address(), 0);
+}
+
+IPv6RouteTrie::~IPv6RouteTrie()
+{
+    deleteSubtree(root);
+}
+
+void IPv6RouteTrie::deleteSubtree(Node *node)
+{
+    if (node)
+    {
+        deleteSubtree(node->children[0]);
+        deleteSubtree(node->children[1]);
+        delete node;
+    }
+}
+
+void IPv6RouteTrie::clear()
+{
+    deleteSubtree(root);
+    root = new Node(IPv6Address(), 0);
+    routeToNode.clear();
+}
+
+int IPv6RouteTrie::getCommonPrefixLength(const IPv6Address& a, const IPv6Address& b, int maxLength)
+{
+    const uint32 *wa = a.words();
+    const uint32 *wb = b.words();
+    int length = 0;
+    for (int i = 0; i < 4 && length < maxLength; i++)
+    {
+        uint32 diff = wa[i] ^ wb[i];
+        if (diff == 0)
+            length += 32;
+        else
+        {
+            while (!(diff & 0x80000000u))
+            {
+                diff <<= 1;
+                length++;
+            }
+            break;
+        }
+    }
+    return std::min(length, maxLength);
+}
+
+IPv6RouteTrie::Node *IPv6RouteTrie::findOrCreateNode(const IPv6Address& prefix, int prefixLength)
+{
+    // invariant: node->prefix is a prefix of 'prefix', and node->prefixLength <= prefixLength
+    Node *node = root;
+    while (node->prefixLength < prefixLength)
+    {
+        int bit = getBit(prefix, node->prefixLength);
+        Node *child = node->children[bit];
+        if (!child)
+        {
+            // new leaf
+            Node *leaf = new Node(prefix, prefixLength);
+            leaf->parent = node;
+            node->children[bit] = leaf;
+            return leaf;
+        }
+
+        int commonLength = getCommonPrefixLength(child->prefix, prefix, std::min(child->prefixLength, prefixLength));
+        if (commonLength == child->prefixLength)
+        {
+            // the child is on the path: descend
+            node = child;
+            continue;
+        }
+
+        // the path diverges from the child's prefix (or ends) inside the compressed edge: split the edge
+        Node *newNode = new Node(prefix.getPrefix(commonLength), commonLength);
+        newNode->parent = node;
+        node->children[bit] = newNode;
+        newNode->children[getBit(child->prefix, commonLength)] = child;
+        child->parent = newNode;
+        if (commonLength == prefixLength)
+            return newNode;
+        Node *leaf = new Node(prefix, prefixLength);
+        leaf->parent = newNode;
+        newNode->children[getBit(prefix, commonLength)] = leaf;
+        return leaf;
+    }
+    return node;
+}
+
+void IPv6RouteTrie::removeNodeIfRedundant(Node *node)
+{
+    // nodes without routes are needed only where the trie branches
+    while (node != root && node->routes.empty())
+    {
+        if (node->children[0] && node->children[1])
+            return;
+        Node *parent = node->parent;
+        Node *child = node->children[0] ? node->children[0] : node->children[1];
+        parent->children[parent->children[0] == node ? 0 : 1] = child;
+        delete node;
+        if (child)
+        {
+            child->parent = parent;
+            return;
+        }
+        node = parent;
+    }
+}
+
+void IPv6RouteTrie::addRoute(IPv6Route *route)
+{
+    ASSERT(routeToNode.find(route) == routeToNode.end());
+    int prefixLength = route->getPrefixLength();
+    Node *node = findOrCreateNode(route->getDestPrefix().getPrefix(prefixLength), prefixLength);
+
+    // same ordering as RoutingTable6::routeList
+    RouteVector::iterator pos = std::upper_bound(node->routes.begin(), node->routes.end(), route, lessThan);
+    node->routes.insert(pos, route);
+    routeToNode[route] = node;
+}
+
+bool IPv6RouteTrie::removeRoute(IPv6Route *route)
+{
+    RouteToNodeMap::iterator it = routeToNode.find(route);
+    if (it == routeToNode.end())
+        return false;
+    Node *node = it->second;
+    routeToNode.erase(it);
+    node->routes.erase(std::find(node->routes.begin(), node->routes.end(), route));
+    removeNodeIfRedundant(node);
+    return true;
+}
+
+void IPv6RouteTrie::findMatchingRoutes(const IPv6Address& dest, RouteVector& result) const
+{
+    // collect the nodes with routes along the path, from the shortest prefix to the longest
+    const Node *matches[129];
+    int numMatches = 0;
+    const Node *node = root;
+    while (node && dest.matches(node->prefix, node->prefixLength))
+    {
+        if (!node->routes.empty())
+            matches[numMatches++] = node;
+        if (node->prefixLength == 128)
+            break;
+        node = node->children[getBit(dest, node->prefixLength)];
+    }
+
+    result.clear();
+    for (int i = numMatches - 1; i >= 0; i--)
+        result.insert(result.end(), matches[i]->routes.begin(), matches[i]->routes.end());
+}
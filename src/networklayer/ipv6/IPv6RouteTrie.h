@@ -0,0 +1,113 @@
+//
+// Copyright (C) 2014 OpenSim Ltd.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __INET_IPV6ROUTETRIE_H
+#define __INET_IPV6ROUTETRIE_H
+
+#include <vector>
+#include <map>
+
+#include "INETDefs.h"
+
+#include "IPv6Address.h"
+
+class IPv6Route;
+
+/**
+ * Path-compressed binary (Patricia) trie over the 128-bit destination
+ * prefixes of IPv6 routes, used by RoutingTable6 for longest prefix matching.
+ * This is the IPv6 counterpart of IPv4RouteTrie.
+ *
+ * Every node stands for a prefix/length pair, and stores the routes with
+ * exactly that prefix, ordered by the comparison function given in the
+ * constructor (best route first). Bits of the route's destination beyond
+ * the prefix length are ignored, like in IPv6Address::matches().
+ *
+ * The trie does not own the routes.
+ *
+ * The algorithm is the same as in IPv4RouteTrie, but the two are kept
+ * separate rather than made a template: IPv4RouteTrie works on plain uint32
+ * prefixes and returns only the best route, while this class compares
+ * 128-bit addresses word by word and returns all matching routes, because
+ * RoutingTable6 has to skip expired routes during the lookup. IPv4Route and
+ * IPv6Route don't share a base class either. Fixes to one of them most
+ * likely apply to the other.
+ */
+class INET_API IPv6RouteTrie
+{
+  public:
+    typedef bool (*RouteLessThan)(const IPv6Route *a, const IPv6Route *b);
+    typedef std::vector<IPv6Route *> RouteVector;
+
+  protected:
+    struct Node
+    {
+        IPv6Address prefix; // bits beyond prefixLength are zero
+        int prefixLength;
+        RouteVector routes; // routes with this prefix, best first
+        Node *parent;
+        Node *children[2];  // indexed by the bit following the prefix
+
+        Node(const IPv6Address& prefix, int prefixLength) : prefix(prefix), prefixLength(prefixLength), parent(NULL) { children[0] = children[1] = NULL; }
+    };
+
+    typedef std::map<const IPv6Route *, Node *> RouteToNodeMap;
+
+    RouteLessThan lessThan;
+    Node *root;  // the ::/0 node, always present
+    RouteToNodeMap routeToNode;
+
+  protected:
+    static int getBit(const IPv6Address& address, int index) { return (address.words()[index >> 5] >> (31 - (index & 31))) & 1; }
+    static int getCommonPrefixLength(const IPv6Address& a, const IPv6Address& b, int maxLength);
+
+    Node *findOrCreateNode(const IPv6Address& prefix, int prefixLength);
+    void removeNodeIfRedundant(Node *node);
+    void deleteSubtree(Node *node);
+
+  public:
+    IPv6RouteTrie(RouteLessThan lessThan);
+    ~IPv6RouteTrie();
+
+    /**
+     * Adds the route under its destination prefix.
+     */
+    void addRoute(IPv6Route *route);
+
+    /**
+     * Removes the route, and returns true if it was found.
+     */
+    bool removeRoute(IPv6Route *route);
+
+    /**
+     * Removes all routes.
+     */
+    void clear();
+
+    /**
+     * Returns the number of routes stored.
+     */
+    int getNumRoutes() const { return routeToNode.size(); }
+
+    /**
+     * Fills in the routes whose prefix matches the given address: longest
+     * prefix first, and in comparison function order within a prefix.
+     */
+    void findMatchingRoutes(const IPv6Address& dest, RouteVector& result) const;
+};
+
+#endif
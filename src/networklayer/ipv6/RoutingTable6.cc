@@ -80,8 +80,9 @@ std::ostream& operator<<(std::ostream& os, const RoutingTable6::DestCacheEntry&
     return os;
 };
 
-RoutingTable6::RoutingTable6()
+RoutingTable6::RoutingTable6() : routeTrie(routeLessThan)
 {
+    destCacheSize = 0;
 }
 
 RoutingTable6::~RoutingTable6()
@@ -114,6 +115,10 @@ void RoutingTable6::initialize(int stage)
         WATCH_MAP(destCache); // FIXME commented out for now
         isrouter = par("isRouter");
         multicastForward = par("forwardMulticast");
+        destCacheSize = par("destCacheSize");
+        if (destCacheSize < 0)
+            throw cRuntimeError("Invalid destCacheSize %d", destCacheSize);
+        destCacheLifetime = par("destCacheLifetime");
         WATCH(isrouter);
 
 #ifdef WITH_xMIPv6
@@ -262,6 +267,14 @@ void RoutingTable6::routeChanged(IPv6Route *entry, int fieldCode)
 {
     ASSERT(entry != NULL);
 
+    // the order of routes depends on these fields
+    if ((fieldCode==IPv6Route::F_METRIC || fieldCode==IPv6Route::F_ADMINDIST) &&
+            std::find(routeList.begin(), routeList.end(), entry) != routeList.end())
+    {
+        internalRemoveRoute(entry);
+        internalAddRoute(entry);
+    }
+
     /*XXX: this deletes some cache entries we want to keep, but the node MUST update
      the Destination Cache in such a way that all entries will use the latest
      route information.*/
@@ -524,11 +537,12 @@ const IPv6Address& RoutingTable6::lookupDestCache(const IPv6Address& dest, int&
     DestCacheEntry &entry = it->second;
     if (entry.expiryTime > 0 && simTime() > entry.expiryTime)
     {
-        destCache.erase(it);
+        removeDestCacheEntry(it);
         outInterfaceId = -1;
         return IPv6Address::UNSPECIFIED_ADDRESS;
     }
 
+    destCacheLRU.splice(destCacheLRU.begin(), destCacheLRU, entry.lruPosition);
     outInterfaceId = entry.interfaceId;
     return entry.nextHopAddr;
 }
@@ -537,30 +551,24 @@ const IPv6Route *RoutingTable6::doLongestPrefixMatch(const IPv6Address& dest)
 {
     Enter_Method("doLongestPrefixMatch(%s)", dest.str().c_str());
 
-    // we'll just stop at the first match, because the table is sorted
-    // by prefix lengths and metric (see addRoute())
+    // we'll just stop at the first match, because the matching routes are
+    // ordered by prefix lengths and metric (see addRoute())
+    routeTrie.findMatchingRoutes(dest, matchingRoutes);
 
     // bugfix - CB
-    RouteList::iterator it = routeList.begin();
-    while (it!=routeList.end())
+    for (RouteList::iterator it = matchingRoutes.begin(); it != matchingRoutes.end(); ++it)
     {
-        if (dest.matches((*it)->getDestPrefix(), (*it)->getPrefixLength()))
+        if (simTime() > (*it)->getExpiryTime() && (*it)->getExpiryTime() != 0)//since 0 represents infinity.
         {
-            if (simTime() > (*it)->getExpiryTime() && (*it)->getExpiryTime() != 0)//since 0 represents infinity.
+            if ( (*it)->getSrc()==IPv6Route::FROM_RA )
             {
-                if ( (*it)->getSrc()==IPv6Route::FROM_RA )
-                {
-                    EV << "Expired prefix detected!!" << endl;
-                    it = routeList.erase(it);
-                    //RouteList::iterator oldIt = it++;
-                    //removeOnLinkPrefix((*oldIt)->getDestPrefix(), (*oldIt)->getPrefixLength());
-                }
+                EV << "Expired prefix detected!!" << endl;
+                internalRemoveRoute(*it);
+                //removeOnLinkPrefix((*it)->getDestPrefix(), (*it)->getPrefixLength());
             }
-            else
-                return *it;
         }
         else
-            ++it;
+            return *it;
     }
     // FIXME todo: if we selected an expired route, throw it out and select again!
     return NULL;
@@ -576,7 +584,22 @@ bool RoutingTable6::isPrefixPresent(const IPv6Address& prefix) const
 
 void RoutingTable6::updateDestCache(const IPv6Address& dest, const IPv6Address& nextHopAddr, int interfaceId, simtime_t expiryTime)
 {
-    DestCacheEntry &entry = destCache[dest];
+    DestCache::iterator it = destCache.find(dest);
+    if (it != destCache.end())
+        destCacheLRU.splice(destCacheLRU.begin(), destCacheLRU, it->second.lruPosition);
+    else
+    {
+        if (destCacheSize > 0 && (int)destCache.size() >= destCacheSize)
+            removeDestCacheEntry(destCache.find(destCacheLRU.back()));
+        destCacheLRU.push_front(dest);
+        it = destCache.insert(std::make_pair(dest, DestCacheEntry())).first;
+        it->second.lruPosition = destCacheLRU.begin();
+    }
+
+    if (destCacheLifetime > 0 && (expiryTime == 0 || expiryTime > simTime() + destCacheLifetime))
+        expiryTime = simTime() + destCacheLifetime;
+
+    DestCacheEntry &entry = it->second;
     entry.nextHopAddr = nextHopAddr;
     entry.interfaceId = interfaceId;
     entry.expiryTime = expiryTime;
@@ -584,9 +607,16 @@ void RoutingTable6::updateDestCache(const IPv6Address& dest, const IPv6Address&
     updateDisplayString();
 }
 
+void RoutingTable6::removeDestCacheEntry(DestCache::iterator it)
+{
+    destCacheLRU.erase(it->second.lruPosition);
+    destCache.erase(it);
+}
+
 void RoutingTable6::purgeDestCache()
 {
     destCache.clear();
+    destCacheLRU.clear();
     updateDisplayString();
 }
 
@@ -597,7 +627,7 @@ void RoutingTable6::purgeDestCacheEntriesToNeighbour(const IPv6Address& nextHopA
         if (it->second.interfaceId==interfaceId && it->second.nextHopAddr==nextHopAddr)
         {
             // move the iterator past this element before removing it
-            destCache.erase(it++);
+            removeDestCacheEntry(it++);
         }
         else
         {
@@ -615,7 +645,7 @@ void RoutingTable6::purgeDestCacheForInterfaceID(int interfaceId)
         if (it->second.interfaceId==interfaceId)
         {
             // move the iterator past this element before removing it
-            destCache.erase(it++);
+            removeDestCacheEntry(it++);
         }
         else
         {
@@ -711,6 +741,7 @@ void RoutingTable6::removeOnLinkPrefix(const IPv6Address& destPrefix, int prefix
     {
         if ((*it)->getSrc()==IPv6Route::FROM_RA && (*it)->getDestPrefix()==destPrefix && (*it)->getPrefixLength()==prefixLength)
         {
+            routeTrie.removeRoute(*it);
             routeList.erase(it);
             return; // there can be only one such route, addOrUpdateOnLinkPrefix() guarantees that
         }
@@ -776,14 +807,27 @@ bool RoutingTable6::routeLessThan(const IPv6Route *a, const IPv6Route *b)
     return a->getMetric() < b->getMetric();
 }
 
-void RoutingTable6::addRoute(IPv6Route *route)
+void RoutingTable6::internalAddRoute(IPv6Route *route)
 {
-    route->setRoutingTable(this);
-    routeList.push_back(route);
-
     // we keep entries sorted by prefix length in routeList, so that we can
     // stop at the first match when doing the longest prefix matching
-    std::sort(routeList.begin(), routeList.end(), routeLessThan);
+    RouteList::iterator pos = std::upper_bound(routeList.begin(), routeList.end(), route, routeLessThan);
+    routeList.insert(pos, route);
+    routeTrie.addRoute(route);
+}
+
+void RoutingTable6::internalRemoveRoute(IPv6Route *route)
+{
+    RouteList::iterator it = std::find(routeList.begin(), routeList.end(), route);
+    ASSERT(it!=routeList.end());
+    routeList.erase(it);
+    routeTrie.removeRoute(route);
+}
+
+void RoutingTable6::addRoute(IPv6Route *route)
+{
+    route->setRoutingTable(this);
+    internalAddRoute(route);
 
     /*XXX: this deletes some cache entries we want to keep, but the node MUST update
      the Destination Cache in such a way that the latest route information are used.*/
@@ -795,12 +839,11 @@ void RoutingTable6::addRoute(IPv6Route *route)
 
 void RoutingTable6::removeRoute(IPv6Route *route)
 {
-    RouteList::iterator it = std::find(routeList.begin(), routeList.end(), route);
-    ASSERT(it!=routeList.end());
+    ASSERT(std::find(routeList.begin(), routeList.end(), route)!=routeList.end());
 
     nb->fireChangeNotification(NF_IPv6_ROUTE_DELETED, route); // rather: going to be deleted
 
-    routeList.erase(it);
+    internalRemoveRoute(route);
     delete route;
 
     /*XXX: this deletes some cache entries we want to keep, but the node MUST update
@@ -861,7 +904,10 @@ void RoutingTable6::removeDefaultRoutes(int interfaceID)
     {
         // default routes have prefix length 0
         if ( (((*it)->getInterfaceId()) == interfaceID) && ((*it)->getPrefixLength() == 0)  )
+        {
+            routeTrie.removeRoute(*it);
             it = routeList.erase(it);
+        }
         else
             ++it;
     }
@@ -878,6 +924,7 @@ void RoutingTable6::removeAllRoutes()
         delete routeList[i];
 
     routeList.clear();
+    routeTrie.clear();
 
     updateDisplayString();
 }
@@ -889,7 +936,10 @@ void RoutingTable6::removePrefixes(int interfaceID)
     {
         // "real" prefixes have a length of larger then 0
         if ( (((*it)->getInterfaceId()) == interfaceID) && ((*it)->getPrefixLength() > 0)  )
+        {
+            routeTrie.removeRoute(*it);
             it = routeList.erase(it);
+        }
         else
             ++it;
     }
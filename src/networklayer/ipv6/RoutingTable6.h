@@ -19,10 +19,12 @@
 #define __INET_ROUTINGTABLE6_H
 
 #include <vector>
+#include <list>
 
 #include "INETDefs.h"
 
 #include "IPv6Address.h"
+#include "IPv6RouteTrie.h"
 #include "NotificationBoard.h"
 #include "ILifecycle.h"
 
@@ -161,28 +163,42 @@ class INET_API RoutingTable6 : public cSimpleModule, protected INotifiable, publ
 
     // Destination Cache maps dest address to next hop and interfaceId.
     // NOTE: nextHop might be a link-local address from which interfaceId cannot be deduced
+    typedef std::list<IPv6Address> DestCacheLRUList;
     struct DestCacheEntry
     {
         int interfaceId;
         IPv6Address nextHopAddr;
         simtime_t expiryTime;
+        DestCacheLRUList::iterator lruPosition;
         // more destination specific data may be added here, e.g. path MTU
     };
     friend std::ostream& operator<<(std::ostream& os, const DestCacheEntry& e);
     typedef std::map<IPv6Address,DestCacheEntry> DestCache;
     DestCache destCache;
+    DestCacheLRUList destCacheLRU; // most recently used first
+    int destCacheSize;             // maximum number of entries, the least recently used one is evicted; 0 means unlimited
+    simtime_t destCacheLifetime;   // maximum lifetime of an entry; 0 means only the expiry time given in updateDestCache() applies
 
     // RouteList contains local prefixes, and (for routers)
     // static, OSPF, RIP etc routes as well
     typedef std::vector<IPv6Route*> RouteList;
     RouteList routeList;
 
+    // the same routes, indexed by destination prefix for doLongestPrefixMatch()
+    IPv6RouteTrie routeTrie;
+    RouteList matchingRoutes; // temporary storage for doLongestPrefixMatch()
+
   protected:
     // creates a new empty route, factory method overriden in subclasses that use custom routes
     virtual IPv6Route *createNewRoute(IPv6Address destPrefix, int prefixLength, IPv6Route::RouteSrc src);
 
     // internal: routes of different type can only be added via well-defined functions
     virtual void addRoute(IPv6Route *route);
+    // internal: inserts the route into routeList and routeTrie, and removes it from them
+    void internalAddRoute(IPv6Route *route);
+    void internalRemoveRoute(IPv6Route *route);
+    // internal: removes the destination cache entry
+    void removeDestCacheEntry(DestCache::iterator it);
     // helper for addRoute()
     static bool routeLessThan(const IPv6Route *a, const IPv6Route *b);
     // internal
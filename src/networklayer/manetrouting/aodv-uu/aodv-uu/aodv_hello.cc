@@ -149,7 +149,9 @@ void NS_CLASS hello_send(void *arg)
             /* Assemble a RREP extension which contain our neighbor set... */
             if (unidir_hack)
             {
+#ifndef AODV_USE_STL_RT
                 int i;
+#endif
 #ifndef OMNETPP
                 if (ext)
                     ext = AODV_EXT_NEXT(ext);
@@ -161,29 +163,28 @@ void NS_CLASS hello_send(void *arg)
 #endif
 
 #ifdef AODV_USE_STL_RT
-                for (i = 0; i < RT_TABLESIZE; i++)
+                for (AodvRtTableMap::iterator it = aodvRtTableMap.begin(); it != aodvRtTableMap.end(); it++)
                 {
-                    for (AodvRtTableMap::iterator it = aodvRtTableMap.begin(); it != aodvRtTableMap.end(); it++)
+                    rt_table_t *rt = it->second;
+                    /* If an entry has an active hello timer, we assume
+                       that we are receiving hello messages from that
+                       node... */
+                    if (rt->hello_timer.used)
                     {
-                        rt_table_t *rt = it->second;
-                        /* If an entry has an active hello timer, we assume
-                           that we are receiving hello messages from that
-                           node... */
-                        if (rt->hello_timer.used)
-                        {
 #ifdef DEBUG_HELLO
-                            DEBUG(LOG_INFO, 0,
-                                  "Adding %s to hello neighbor set ext",
-                                  ip_to_str(rt->dest_addr));
+                        DEBUG(LOG_INFO, 0,
+                              "Adding %s to hello neighbor set ext",
+                              ip_to_str(rt->dest_addr));
 #endif
-                            memcpy(buffer_ptr, &rt->dest_addr,
-                                   sizeof(struct in_addr));
-                            buffer_ptr+=sizeof(struct in_addr);
-                        }
+                        if (buffer_ptr + sizeof(struct in_addr) > buffer + sizeof(buffer))
+                            break;
+                        memcpy(buffer_ptr, &rt->dest_addr,
+                               sizeof(struct in_addr));
+                        buffer_ptr+=sizeof(struct in_addr);
                     }
                 }
 #else
-                for (i = 0; i < RT_TABLESIZE; i++)
+                for (i = 0; i < (int) rt_tbl.size; i++)
                 {
                     list_t *pos;
                     list_foreach(pos, &rt_tbl.tbl[i])
@@ -280,7 +280,7 @@ void NS_CLASS neighbor_link_break(rt_table_t * rt)
        destination (dest) as next hop. These entries (destinations)
        cannot be reached either since dest is down. They should
        therefore also be included in the RERR. */
-    for (i = 0; i < RT_TABLESIZE; i++)
+    for (i = 0; i < (int) rt_tbl.size; i++)
     {
         list_t *pos;
         list_foreach(pos, &rt_tbl.tbl[i])
@@ -407,7 +407,7 @@ void NS_CLASS print_rt_table(void *arg)
     write(log_rt_fd, rt_buf, len);
     len = 0;
 
-    for (i = 0; i < RT_TABLESIZE; i++)
+    for (i = 0; i < (int) rt_tbl.size; i++)
     {
         list_t *pos;
         list_foreach(pos, &rt_tbl.tbl[i])
@@ -46,7 +46,8 @@ extern int llfeedback;
 #endif              /* NS_PORT */
 
 #ifndef AODV_USE_STL_RT
-static unsigned int hashing(struct in_addr *addr, hash_value * hash);
+static unsigned int hashing(struct in_addr *addr, hash_value * hash,
+                            unsigned int mask);
 #endif
 
 #ifdef AODV_USE_STL_RT
@@ -57,8 +58,8 @@ void NS_CLASS rt_table_init()
     while (!aodvRtTableMap.empty())
     {
         rt_table_delete (aodvRtTableMap.begin()->second);
-        aodvRtTableMap.erase(aodvRtTableMap.begin());
     }
+    aodvRtTableIndex.clear();
     rt_tbl.num_entries = 0;
     rt_tbl.num_active = 0;
 }
@@ -71,6 +72,26 @@ void NS_CLASS rt_table_destroy()
     }
 }
 
+/* Add an entry to the routing table map and its hash index. */
+void NS_CLASS rt_table_map_insert(rt_table_t * rt)
+{
+    aodvRtTableMap.insert(std::make_pair(rt->dest_addr.s_addr, rt));
+    aodvRtTableIndex.insert(rt->dest_addr.s_addr, rt);
+    rt_tbl.num_entries = (int) aodvRtTableMap.size();
+}
+
+/* Remove an entry from the routing table map and its hash index. */
+void NS_CLASS rt_table_map_remove(rt_table_t * rt)
+{
+    ManetAddress dest = rt->dest_addr.s_addr;
+    rt_table_t **entry = aodvRtTableIndex.find(dest);
+    if (!entry || *entry != rt)
+        opp_error("AODV routing table error");
+    aodvRtTableIndex.erase(dest);
+    aodvRtTableMap.erase(dest);
+    rt_tbl.num_entries = (int) aodvRtTableMap.size();
+}
+
 rt_table_t *NS_CLASS rt_table_insert(struct in_addr dest_addr,
                                      struct in_addr next,
                                      u_int8_t hops, u_int32_t seqno,
@@ -85,8 +106,7 @@ rt_table_t *NS_CLASS rt_table_insert(struct in_addr dest_addr,
 
     dest = dest_addr.s_addr;
     /* Check if we already have an entry for dest_addr */
-    AodvRtTableMap::iterator it = aodvRtTableMap.find(dest);
-    if (it != aodvRtTableMap.end())
+    if (aodvRtTableIndex.find(dest))
     {
         DEBUG(LOG_INFO, 0, "%s already exist in routing table!",
               ip_to_str(dest_addr));
@@ -118,13 +138,7 @@ rt_table_t *NS_CLASS rt_table_insert(struct in_addr dest_addr,
     }
 
 
-    if ((rt = (rt_table_t *) malloc(sizeof(rt_table_t))) == NULL)
-    {
-        fprintf(stderr, "Malloc failed!\n");
-        exit(-1);
-    }
-
-    memset(rt, 0, sizeof(rt_table_t));
+    rt = new rt_table_t();
     rt->dest_addr = dest_addr;
     rt->next_hop = next;
     rt->dest_seqno = seqno;
@@ -152,8 +166,7 @@ rt_table_t *NS_CLASS rt_table_insert(struct in_addr dest_addr,
     /* Insert first in bucket... */
     DEBUG(LOG_INFO, 0, "Inserting %s (bucket %d) next hop %s",
           ip_to_str(dest_addr), index, ip_to_str(next));
-    aodvRtTableMap.insert(std::make_pair(dest,rt));
-    rt_tbl.num_entries = (int) aodvRtTableMap.size();
+    rt_table_map_insert(rt);
     if (state == INVALID)
     {
 
@@ -222,22 +235,22 @@ rt_table_t *NS_CLASS rt_table_insert(struct in_addr dest_addr,
 rt_table_t *NS_CLASS rt_table_find(struct in_addr dest_addr)
 {
 
-    if (aodvRtTableMap.empty())
+    if (aodvRtTableIndex.empty())
         return NULL;
 
     /* Check if we already have an entry for dest_addr */
-    AodvRtTableMap::iterator it = aodvRtTableMap.find(dest_addr.s_addr);
+    rt_table_t **entry = aodvRtTableIndex.find(dest_addr.s_addr);
 
-    if (it != aodvRtTableMap.end())
-        return it->second;
+    if (entry)
+        return *entry;
     else
     {
         ManetAddress apAdd;
         if (getAp(dest_addr.s_addr, apAdd))
         {
-            it = aodvRtTableMap.find(apAdd);
-            if (it != aodvRtTableMap.end())
-                return it->second;
+            entry = aodvRtTableIndex.find(apAdd);
+            if (entry)
+                return *entry;
         }
         return NULL;
     }
@@ -412,14 +425,7 @@ void NS_CLASS rt_table_delete(rt_table_t * rt)
         return;
     }
 
-    ManetAddress dest = rt->dest_addr.s_addr;
-    AodvRtTableMap::iterator it = aodvRtTableMap.find(dest);
-    if (it != aodvRtTableMap.end())
-    {
-        if (it->second != rt)
-            opp_error("AODV routing table error");
-    }
-    aodvRtTableMap.erase(it);
+    rt_table_map_remove(rt);
 
     if (rt->state == VALID || rt->state == IMMORTAL)
     {
@@ -435,8 +441,7 @@ void NS_CLASS rt_table_delete(rt_table_t * rt)
     timer_remove(&rt->rt_timer);
     timer_remove(&rt->hello_timer);
     timer_remove(&rt->ack_timer);
-    rt_tbl.num_entries = (int) aodvRtTableMap.size();
-    free(rt);
+    delete rt;
     return;
 }
 
@@ -449,15 +454,31 @@ void NS_CLASS precursor_add(rt_table_t * rt, struct in_addr addr)
     /* Sanity check */
     if (!rt)
         return;
-    for (unsigned int i = 0; i < rt->precursors.size(); i++)
+
+    /* Check if the node is already in the precursors list. Long lists
+       have a hash index; the index is empty until then. */
+    if (!rt->precursor_index.empty())
     {
-        if (rt->precursors[i].neighbor.s_addr == addr.s_addr)
+        if (!rt->precursor_index.insert(addr.s_addr, true))
             return;
     }
+    else
+    {
+        for (unsigned int i = 0; i < rt->precursors.size(); i++)
+        {
+            if (rt->precursors[i].neighbor.s_addr == addr.s_addr)
+                return;
+        }
+    }
     precursor_t pr;
     pr.neighbor.s_addr = addr.s_addr;
     rt->precursors.push_back(pr);
     rt->nprec = (int)rt->precursors.size();
+    if (rt->precursor_index.empty() && rt->precursors.size() > PRECURSOR_INDEX_MIN)
+    {
+        for (unsigned int i = 0; i < rt->precursors.size(); i++)
+            rt->precursor_index.insert(rt->precursors[i].neighbor.s_addr, true);
+    }
     return;
 }
 
@@ -470,6 +491,8 @@ void NS_CLASS precursor_remove(rt_table_t * rt, struct in_addr addr)
     /* Sanity check */
     if (!rt)
         return;
+    if (!rt->precursor_index.empty() && !rt->precursor_index.erase(addr.s_addr))
+        return;
     for (unsigned int i = 0; i < rt->precursors.size(); i++)
     {
         if (rt->precursors[i].neighbor.s_addr == addr.s_addr)
@@ -492,17 +515,10 @@ rt_table_t *NS_CLASS modifyAODVTables(struct in_addr dest_addr,
     struct in_addr nm;
     nm.s_addr = ManetAddress::ZERO;
 
-    ManetAddress dest = dest_addr.s_addr;
-
     DEBUG(LOG_INFO, 0, "modifyAODVTables");
     /* Check if we already have an entry for dest_addr */
 
-    if ((rt = (rt_table_t *) malloc(sizeof(rt_table_t))) == NULL)
-    {
-        fprintf(stderr, "Malloc failed!\n");
-        exit(-1);
-    }
-    memset(rt, 0, sizeof(rt_table_t));
+    rt = new rt_table_t();
     rt->dest_addr = dest_addr;
     rt->next_hop = next;
     rt->dest_seqno = seqno;
@@ -521,8 +537,7 @@ rt_table_t *NS_CLASS modifyAODVTables(struct in_addr dest_addr,
 
     DEBUG(LOG_INFO, 0, "Inserting %s next hop %s",ip_to_str(dest_addr), ip_to_str(next));
 
-    aodvRtTableMap.insert(std::make_pair(dest,rt));
-    rt_tbl.num_entries = (int) aodvRtTableMap.size();
+    rt_table_map_insert(rt);
     if (state == INVALID)
     {
 
@@ -586,6 +601,7 @@ void precursor_list_destroy(rt_table_t * rt)
     if (!rt)
         return;
     rt->precursors.clear();
+    rt->precursor_index.clear();
     rt->nprec=0;
 }
 
@@ -597,8 +613,15 @@ void NS_CLASS rt_table_init()
     rt_tbl.num_entries = 0;
     rt_tbl.num_active = 0;
 
+    rt_tbl.size = RT_TABLESIZE;
+    if ((rt_tbl.tbl = (list_t *) malloc(rt_tbl.size * sizeof(list_t))) == NULL)
+    {
+        fprintf(stderr, "Malloc failed!\n");
+        exit(-1);
+    }
+
     /* We do a for loop here... NS does not like us to use memset() */
-    for (i = 0; i < RT_TABLESIZE; i++)
+    for (i = 0; i < (int) rt_tbl.size; i++)
     {
         INIT_LIST_HEAD(&rt_tbl.tbl[i]);
     }
@@ -609,7 +632,7 @@ void NS_CLASS rt_table_destroy()
     int i;
     list_t *tmp = NULL, *pos = NULL;
 
-    for (i = 0; i < RT_TABLESIZE; i++)
+    for (i = 0; i < (int) rt_tbl.size; i++)
     {
         list_foreach_safe(pos, tmp, &rt_tbl.tbl[i])
         {
@@ -618,15 +641,53 @@ void NS_CLASS rt_table_destroy()
             rt_table_delete(rt);
         }
     }
+    free(rt_tbl.tbl);
+    rt_tbl.tbl = NULL;
+    rt_tbl.size = 0;
+}
+
+/* Rehash all entries into a new array of buckets of the given size. */
+void NS_CLASS rt_table_resize(unsigned int size)
+{
+    list_t *tbl;
+    unsigned int i;
+
+    if ((tbl = (list_t *) malloc(size * sizeof(list_t))) == NULL)
+    {
+        fprintf(stderr, "Malloc failed!\n");
+        exit(-1);
+    }
+
+    for (i = 0; i < size; i++)
+    {
+        INIT_LIST_HEAD(&tbl[i]);
+    }
+
+    /* Entries keep their relative order within the buckets */
+    for (i = 0; i < rt_tbl.size; i++)
+    {
+        list_t *tmp = NULL, *pos = NULL;
+        list_foreach_safe(pos, tmp, &rt_tbl.tbl[i])
+        {
+            rt_table_t *rt = (rt_table_t *) pos;
+
+            list_detach(&rt->l);
+            list_add_tail(&tbl[rt->hash & (size - 1)], &rt->l);
+        }
+    }
+    free(rt_tbl.tbl);
+    rt_tbl.tbl = tbl;
+    rt_tbl.size = size;
 }
 
 /* Calculate a hash value and table index given a key... */
-unsigned int hashing(struct in_addr *addr, hash_value * hash)
+unsigned int hashing(struct in_addr *addr, hash_value * hash,
+                     unsigned int mask)
 {
     /*   *hash = (*addr & 0x7fffffff); */
     *hash = (hash_value) addr->s_addr;
 
-    return (*hash & RT_TABLEMASK);
+    return (*hash & mask);
 }
 
 rt_table_t *NS_CLASS rt_table_insert(struct in_addr dest_addr,
@@ -648,7 +709,7 @@ rt_table_t *NS_CLASS rt_table_insert(struct in_addr dest_addr,
 
     /* Calculate hash key */
     dest.s_addr=dest_addr.s_addr;
-    index = hashing(&dest, &hash);
+    index = hashing(&dest, &hash, rt_tbl.size - 1);
 
     /* Check if we already have an entry for dest_addr */
     list_foreach(pos, &rt_tbl.tbl[index])
@@ -694,7 +755,13 @@ rt_table_t *NS_CLASS rt_table_insert(struct in_addr dest_addr,
     rt->nprec = 0;
     INIT_LIST_HEAD(&rt->precursors);
 
-    /* Insert first in bucket... */
+    /* Insert first in bucket, after growing the table if the buckets
+       got too long... */
+    if (rt_tbl.num_entries >= RT_TABLE_MAXLOAD * rt_tbl.size)
+    {
+        rt_table_resize(2 * rt_tbl.size);
+        index = hash & (rt_tbl.size - 1);
+    }
 
     rt_tbl.num_entries++;
 
@@ -791,7 +858,7 @@ rt_table_t *NS_CLASS rt_table_find(struct in_addr dest_addr)
         return NULL;
 
     /* Calculate index */
-    index = hashing(&dest, &hash);
+    index = hashing(&dest, &hash, rt_tbl.size - 1);
 
     /* Handle collisions: */
     list_foreach(pos, &rt_tbl.tbl[index])
@@ -813,7 +880,7 @@ rt_table_t *NS_CLASS rt_table_find_gateway()
     rt_table_t *gw = NULL;
     int i;
 
-    for (i = 0; i < RT_TABLESIZE; i++)
+    for (i = 0; i < (int) rt_tbl.size; i++)
     {
         list_t *pos;
         list_foreach(pos, &rt_tbl.tbl[i])
@@ -839,7 +906,7 @@ int NS_CLASS rt_table_update_inet_rt(rt_table_t * gw, u_int32_t life)
     if (!gw)
         return -1;
 
-    for (i = 0; i < RT_TABLESIZE; i++)
+    for (i = 0; i < (int) rt_tbl.size; i++)
     {
         list_t *pos;
         list_foreach(pos, &rt_tbl.tbl[i])
@@ -930,7 +997,7 @@ int NS_CLASS rt_table_invalidate(rt_table_t * rt)
 
         rt_table_t *gw = rt_table_find_gateway();
 
-        for (i = 0; i < RT_TABLESIZE; i++)
+        for (i = 0; i < (int) rt_tbl.size; i++)
         {
             list_t *pos;
             list_foreach(pos, &rt_tbl.tbl[i])
@@ -1133,7 +1200,7 @@ rt_table_t *NS_CLASS modifyAODVTables(struct in_addr dest_addr,
 
     /* Calculate hash key */
     dest.s_addr=dest_addr.s_addr;
-    index = hashing(&dest, &hash);
+    index = hashing(&dest, &hash, rt_tbl.size - 1);
 
     DEBUG(LOG_INFO, 0, "modifyAODVTables");
     /* Check if we already have an entry for dest_addr */
@@ -1170,7 +1237,13 @@ rt_table_t *NS_CLASS modifyAODVTables(struct in_addr dest_addr,
     rt->hello_cnt = 0;
     rt->nprec = 0;
     INIT_LIST_HEAD(&rt->precursors);
-    /* Insert first in bucket... */
+    /* Insert first in bucket, after growing the table if the buckets
+       got too long... */
+    if (rt_tbl.num_entries >= RT_TABLE_MAXLOAD * rt_tbl.size)
+    {
+        rt_table_resize(2 * rt_tbl.size);
+        index = hash & (rt_tbl.size - 1);
+    }
     rt_tbl.num_entries++;
     DEBUG(LOG_INFO, 0, "Inserting %s (bucket %d) next hop %s",
           ip_to_str(dest_addr), index, ip_to_str(next));
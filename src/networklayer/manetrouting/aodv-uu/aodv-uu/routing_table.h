@@ -62,7 +62,11 @@ struct rt_table
     u_int8_t hello_cnt;
     int nprec;          /* Number of precursors */
     std::vector<precursor_t> precursors;      /* List of neighbors using the route */
+    AodvAddressMap<bool> precursor_index;     /* Precursor membership, kept once
+                                                 there are more than PRECURSOR_INDEX_MIN */
 };
+
+#define PRECURSOR_INDEX_MIN 8
 #else
 typedef struct precursor
 {
@@ -109,14 +113,18 @@ struct rt_table
 #define IMMORTAL  2
 
 
-#define RT_TABLESIZE 64     /* Must be a power of 2 */
-#define RT_TABLEMASK (RT_TABLESIZE - 1)
+#define RT_TABLESIZE 64     /* Initial number of buckets, must be a power of 2 */
+#define RT_TABLE_MAXLOAD 2  /* The buckets are doubled above this many
+                               entries per bucket */
 
 struct routing_table
 {
     unsigned int num_entries;
     unsigned int num_active;
-    list_t tbl[RT_TABLESIZE];
+#ifndef AODV_USE_STL_RT
+    unsigned int size;      /* Number of buckets, a power of 2 */
+    list_t *tbl;
+#endif
 };
 void precursor_list_destroy(rt_table_t * rt);
 #endif              /* NS_NO_GLOBALS */
@@ -145,6 +153,12 @@ rt_table_t *rt_table_find_gateway();
 int rt_table_update_inet_rt(rt_table_t * gw, u_int32_t life);
 int rt_table_invalidate(rt_table_t * rt);
 void rt_table_delete(rt_table_t * rt);
+#ifdef AODV_USE_STL_RT
+void rt_table_map_insert(rt_table_t * rt);
+void rt_table_map_remove(rt_table_t * rt);
+#else
+void rt_table_resize(unsigned int size);
+#endif
 void precursor_add(rt_table_t * rt, struct in_addr addr);
 void precursor_remove(rt_table_t * rt, struct in_addr addr);
 
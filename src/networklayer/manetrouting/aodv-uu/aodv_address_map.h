@@ -0,0 +1,155 @@
+//
+// Copyright (C) 2014 OpenSim Ltd.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef __INET_AODVADDRESSMAP_H
+#define __INET_AODVADDRESSMAP_H
+
+#include <vector>
+
+#include "ManetAddress.h"
+
+/**
+ * Hash table with open addressing (linear probing) that maps ManetAddress
+ * keys to values. Lookup, insertion and removal take O(1) expected time,
+ * and the table doubles its capacity to keep the load factor below 3/4,
+ * so it stays fast no matter how many entries it holds.
+ *
+ * Used by AODV-UU to index the routing table and the precursor lists.
+ * Iteration is not supported; keep the entries in an ordered container as
+ * well when the iteration order matters.
+ */
+template<class T>
+class AodvAddressMap
+{
+  protected:
+    struct Slot
+    {
+        ManetAddress key;
+        T value;
+        bool used;
+        Slot() : value(), used(false) {}
+    };
+
+    std::vector<Slot> slots;  // the capacity is zero or a power of two
+    unsigned int count;
+
+  protected:
+    unsigned int getHomeSlot(const ManetAddress& key) const
+    {
+        return (unsigned int)key.getHash() & (slots.size() - 1);
+    }
+
+    // returns the index of the slot holding key, or slots.size() if not found
+    unsigned int findSlot(const ManetAddress& key) const
+    {
+        if (count == 0)
+            return slots.size();
+        unsigned int mask = slots.size() - 1;
+        for (unsigned int i = getHomeSlot(key); slots[i].used; i = (i + 1) & mask)
+            if (slots[i].key == key)
+                return i;
+        return slots.size();
+    }
+
+    void grow()
+    {
+        std::vector<Slot> oldSlots(slots.empty() ? 8 : 2 * slots.size());
+        slots.swap(oldSlots);
+        unsigned int mask = slots.size() - 1;
+        for (unsigned int i = 0; i < oldSlots.size(); i++)
+        {
+            if (oldSlots[i].used)
+            {
+                unsigned int j = getHomeSlot(oldSlots[i].key);
+                while (slots[j].used)
+                    j = (j + 1) & mask;
+                slots[j] = oldSlots[i];
+            }
+        }
+    }
+
+  public:
+    AodvAddressMap() : count(0) {}
+
+    unsigned int size() const {return count;}
+    bool empty() const {return count == 0;}
+
+    /**
+     * Returns a pointer to the value stored for the key, or NULL.
+     */
+    T *find(const ManetAddress& key)
+    {
+        unsigned int i = findSlot(key);
+        return i == slots.size() ? NULL : &slots[i].value;
+    }
+
+    /**
+     * Stores the value for the key. Returns false and leaves the table
+     * unchanged if the key is already present.
+     */
+    bool insert(const ManetAddress& key, const T& value)
+    {
+        if (findSlot(key) != slots.size())
+            return false;
+        if (4 * (count + 1) > 3 * slots.size())
+            grow();
+        unsigned int mask = slots.size() - 1;
+        unsigned int i = getHomeSlot(key);
+        while (slots[i].used)
+            i = (i + 1) & mask;
+        slots[i].key = key;
+        slots[i].value = value;
+        slots[i].used = true;
+        count++;
+        return true;
+    }
+
+    /**
+     * Removes the key. Returns false if it was not present.
+     */
+    bool erase(const ManetAddress& key)
+    {
+        unsigned int i = findSlot(key);
+        if (i == slots.size())
+            return false;
+
+        // shift back the entries of the probe sequence that follow the
+        // removed one, so that lookups need no tombstones
+        unsigned int mask = slots.size() - 1;
+        for (unsigned int j = (i + 1) & mask; slots[j].used; j = (j + 1) & mask)
+        {
+            unsigned int home = getHomeSlot(slots[j].key);
+            if (((j - home) & mask) >= ((j - i) & mask))
+            {
+                slots[i] = slots[j];
+                i = j;
+            }
+        }
+        slots[i] = Slot();
+        count--;
+        return true;
+    }
+
+    void clear()
+    {
+        slots.clear();
+        count = 0;
+    }
+};
+
+#endif
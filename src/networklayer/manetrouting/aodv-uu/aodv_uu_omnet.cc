@@ -256,12 +256,13 @@ NS_CLASS ~ AODVUU()
 #ifdef AODV_USE_STL_RT
     while (!aodvRtTableMap.empty())
     {
-        free (aodvRtTableMap.begin()->second);
+        delete aodvRtTableMap.begin()->second;
         aodvRtTableMap.erase(aodvRtTableMap.begin());
     }
+    aodvRtTableIndex.clear();
 #else
     list_t *tmp = NULL, *pos = NULL;
-    for (int i = 0; i < RT_TABLESIZE; i++)
+    for (unsigned int i = 0; i < rt_tbl.size; i++)
     {
         list_foreach_safe(pos, tmp, &rt_tbl.tbl[i])
         {
@@ -271,6 +272,7 @@ NS_CLASS ~ AODVUU()
             free(rt);
         }
     }
+    free(rt_tbl.tbl);
 #endif
 #ifndef AODV_USE_STL
     while (!list_empty(&rreq_records))
@@ -1375,21 +1377,13 @@ bool  NS_CLASS setRoute(const ManetAddress &dest,const ManetAddress &add, const
             aodv_socket_send((AODV_msg *) rerr, rerr_dest,RERR_CALC_SIZE(rerr),
                              1, &DEV_IFINDEX(NS_IFINDEX));
         }
-        ManetAddress dest = fwd_rt->dest_addr.s_addr;
-        AodvRtTableMap::iterator it = aodvRtTableMap.find(dest);
-        if (it != aodvRtTableMap.end())
-        {
-            if (it->second != fwd_rt)
-                opp_error("AODV routing table error");
-        }
-        aodvRtTableMap.erase(it);
+        rt_table_map_remove(fwd_rt);
         if (fwd_rt->state == VALID || fwd_rt->state == IMMORTAL)
             rt_tbl.num_active--;
         timer_remove(&fwd_rt->rt_timer);
         timer_remove(&fwd_rt->hello_timer);
         timer_remove(&fwd_rt->ack_timer);
-        rt_tbl.num_entries = aodvRtTableMap.size();
-        free (fwd_rt);
+        delete fwd_rt;
     }
     else
         DEBUG(LOG_DEBUG, 0, "No route entry to delete");
@@ -1438,21 +1432,13 @@ bool  NS_CLASS setRoute(const ManetAddress &dest,const ManetAddress &add, const
             aodv_socket_send((AODV_msg *) rerr, rerr_dest,RERR_CALC_SIZE(rerr),
                              1, &DEV_IFINDEX(NS_IFINDEX));
         }
-        ManetAddress dest = fwd_rt->dest_addr.s_addr;
-        AodvRtTableMap::iterator it = aodvRtTableMap.find(dest);
-        if (it != aodvRtTableMap.end())
-        {
-            if (it->second != fwd_rt)
-                opp_error("AODV routing table error");
-        }
-        aodvRtTableMap.erase(it);
+        rt_table_map_remove(fwd_rt);
         if (fwd_rt->state == VALID || fwd_rt->state == IMMORTAL)
             rt_tbl.num_active--;
         timer_remove(&fwd_rt->rt_timer);
         timer_remove(&fwd_rt->hello_timer);
         timer_remove(&fwd_rt->ack_timer);
-        rt_tbl.num_entries = aodvRtTableMap.size();
-        free (fwd_rt);
+        delete fwd_rt;
     }
     else
         DEBUG(LOG_DEBUG, 0, "No route entry to delete");
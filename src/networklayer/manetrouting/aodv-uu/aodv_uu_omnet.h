@@ -70,6 +70,7 @@
 #include "Ieee80211Frame_m.h"
 
 #include "aodv_msg_struct.h"
+#include "aodv_address_map.h"
 /* Forward declaration needed to be able to reference the class */
 class AODVUU;
 
@@ -139,6 +140,9 @@ class AODVUU : public ManetRoutingBase
     AodvTimerMap aodvTimerMap;
     typedef std::map<ManetAddress, struct rt_table*> AodvRtTableMap;
     AodvRtTableMap aodvRtTableMap;
+    // hash index of aodvRtTableMap for the lookups; the map gives the iteration order
+    typedef AodvAddressMap<struct rt_table*> AodvRtTableIndex;
+    AodvRtTableIndex aodvRtTableIndex;
 
 
   public:
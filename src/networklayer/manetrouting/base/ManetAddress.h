@@ -90,6 +90,16 @@ class ManetAddress
     bool operator >(const ManetAddress& other) const { return compare(other) > 0; }
     bool operator >=(const ManetAddress& other) const { return compare(other) >= 0; }
 
+    /**
+     * Returns a hash value of the address, suitable for hash tables.
+     * Equal addresses have equal hash values.
+     */
+    uint64_t getHash() const
+    {
+        uint64_t h = (hi ^ (lo * 0x9E3779B97F4A7C15ULL) ^ ((uint64_t)addrType << 61)) * 0xFF51AFD7ED558CCDULL;
+        return h ^ (h >> 32);
+    }
+
     /**
      * Returns true if this is the broadcast address.
      */
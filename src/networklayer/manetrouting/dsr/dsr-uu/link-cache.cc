@@ -48,6 +48,11 @@ static struct lc_graph LC;
 #define LC_COST_INF UINT_MAX
 #define LC_HOPS_INF UINT_MAX
 
+/* Special values of lc_node.heap_pos */
+#define LC_HEAP_NONE -1     /* Not in the Dijkstra heap yet */
+#define LC_HEAP_DONE -2     /* Already removed from the Dijkstra heap */
+#define LC_HEAP_NO_TBL -3   /* Could not be added to the node table */
+
 #ifdef LC_TIMER
 #define LC_GARBAGE_COLLECT_INTERVAL 5 * 1000000 /* 5 Seconds */
 #endif              /* LC_TIMER */
@@ -62,12 +67,16 @@ struct lc_node
                  * length of the source route to allocate. Same as
                  * cost if cost is hops. */
     struct lc_node *pred;   /* predecessor */
+    struct lc_link *out_links;  /* Links from this node */
+    unsigned int order; /* Position in the node table when running Dijkstra */
+    int heap_pos;       /* Position in the Dijkstra heap or LC_HEAP_* */
     unsigned int vector_cost[0];
 };
 
 struct lc_link
 {
     dsr_list_t l;
+    struct lc_link *next_out;   /* Next link from the same source node */
     struct lc_node *src, *dst;
     int status;
     unsigned int cost;
@@ -79,9 +88,10 @@ struct link_query
     struct in_addr src, dst;
 };
 
-struct cheapest_node
+struct lc_heap
 {
-    struct lc_node *n;
+    struct lc_node **nodes;
+    int len;
 };
 
 #ifdef __KERNEL__
@@ -90,6 +100,20 @@ static int lc_print(struct lc_graph *LC, char *buf);
 
 static inline void __lc_link_del(struct lc_graph *lc, struct lc_link *link)
 {
+    struct lc_link **out;
+
+    for (out = &link->src->out_links; *out; out = &(*out)->next_out)
+    {
+        if (*out == link)
+        {
+            *out = link->next_out;
+            break;
+        }
+    }
+
+    /* The cached shortest path tree may have used this link */
+    lc->src = NULL;
+
     /* Also free the nodes if they lack other links */
     if (--link->src->links == 0)
         __tbl_del(&lc->nodes, &link->src->l);
@@ -139,18 +163,6 @@ static inline int crit_expire(void *pos, void *data)
     return 0;
 }
 
-static inline int do_lowest_cost(void *pos, void *data)
-{
-    struct lc_node *n = (struct lc_node *)pos;
-    struct cheapest_node *cn = (struct cheapest_node *)data;
-
-    if (n->cost != LC_COST_INF && (!cn->n || n->cost < cn->n->cost))
-    {
-        cn->n = n;
-    }
-    return 0;
-}
-
 static inline int do_relax(void *pos, void *node)
 {
     struct lc_link *link = (struct lc_link *)pos;
@@ -251,6 +263,8 @@ static inline struct lc_node *lc_node_create(struct in_addr addr)
     n->links = 0;
     n->cost = LC_COST_INF;
     n->pred = NULL;
+    n->out_links = NULL;
+    n->heap_pos = LC_HEAP_NONE;
 
     return n;
 };
@@ -262,9 +276,11 @@ static inline struct lc_link *__lc_link_find(struct tbl *t, struct in_addr src,
     return (struct lc_link *)__tbl_find(t, &q, crit_link_query);
 }
 
+/* Returns 1 if a new link was added and 0 if an existing one was updated;
+ * *changed is set if the link cache graph changed */
 static int __lc_link_tbl_add(struct tbl *t, struct lc_node *src,
                              struct lc_node *dst, usecs_t timeout,
-                             int status, int cost)
+                             int status, int cost, int *changed)
 {
     struct lc_link *link;
     int res;
@@ -284,7 +300,11 @@ static int __lc_link_tbl_add(struct tbl *t, struct lc_node *src,
 
         memset(link, 0, sizeof(struct lc_link));
 
-        __tbl_add_tail(t, &link->l);
+        if (__tbl_add_tail(t, &link->l) > 0)
+        {
+            link->next_out = src->out_links;
+            src->out_links = link;
+        }
 
         link->src = src;
         link->dst = dst;
@@ -292,9 +312,14 @@ static int __lc_link_tbl_add(struct tbl *t, struct lc_node *src,
         dst->links++;
 
         res = 1;
+        *changed = 1;
     }
     else
+    {
         res = 0;
+        if (link->status != status || link->cost != (unsigned int)cost)
+            *changed = 1;
+    }
 
     link->status = status;
     link->cost = cost;
@@ -308,7 +333,7 @@ int NSCLASS lc_link_add(struct in_addr src, struct in_addr dst,
                         usecs_t timeout, int status, int cost)
 {
     struct lc_node *sn, *dn;
-    int res;
+    int res, changed = 0;
 
     DSR_WRITE_LOCK(&LC.lock);
 
@@ -324,8 +349,9 @@ int NSCLASS lc_link_add(struct in_addr src, struct in_addr dst,
             DSR_WRITE_UNLOCK(&LC.lock);
             return -1;
         }
-        __tbl_add_tail(&LC.nodes, &sn->l);
-
+        if (__tbl_add_tail(&LC.nodes, &sn->l) < 0)
+            sn->heap_pos = LC_HEAP_NO_TBL;
+        changed = 1;
     }
 
     dn = (struct lc_node *)__tbl_find(&LC.nodes, &dst, crit_addr);
@@ -339,10 +365,17 @@ int NSCLASS lc_link_add(struct in_addr src, struct in_addr dst,
             DSR_WRITE_UNLOCK(&LC.lock);
             return -1;
         }
-        __tbl_add_tail(&LC.nodes, &dn->l);
+        if (__tbl_add_tail(&LC.nodes, &dn->l) < 0)
+            dn->heap_pos = LC_HEAP_NO_TBL;
+        changed = 1;
     }
 
-    res = __lc_link_tbl_add(&LC.links, sn, dn, timeout, status, cost);
+    res = __lc_link_tbl_add(&LC.links, sn, dn, timeout, status, cost, &changed);
+
+    /* Only refreshing the timeout of a link doesn't change the shortest
+     * path tree, anything else invalidates it */
+    if (changed)
+        LC.src = NULL;
 
     if (res)
     {
@@ -398,19 +431,81 @@ out:
     return res;
 }
 
-static inline void
-__dijkstra_init_single_source(struct tbl *t, struct in_addr src)
+/* The node a linear scan of the node table would pick: the one with the
+ * lowest cost, and the first one in the table among those */
+static inline int lc_heap_before(struct lc_node *a, struct lc_node *b)
 {
-    __tbl_do_for_each(t, &src, do_init);
+    return a->cost < b->cost || (a->cost == b->cost && a->order < b->order);
 }
 
-static inline struct lc_node *__dijkstra_find_lowest_cost_node(struct tbl *t)
+static void lc_heap_sift_up(struct lc_heap *h, int pos)
 {
-    struct cheapest_node cn = { NULL };
+    struct lc_node *n = h->nodes[pos];
 
-    __tbl_do_for_each(t, &cn, do_lowest_cost);
+    while (pos > 0)
+    {
+        int parent = (pos - 1) / 2;
 
-    return cn.n;
+        if (!lc_heap_before(n, h->nodes[parent]))
+            break;
+        h->nodes[pos] = h->nodes[parent];
+        h->nodes[pos]->heap_pos = pos;
+        pos = parent;
+    }
+    h->nodes[pos] = n;
+    n->heap_pos = pos;
+}
+
+static void lc_heap_sift_down(struct lc_heap *h, int pos)
+{
+    struct lc_node *n = h->nodes[pos];
+
+    while (1)
+    {
+        int child = 2 * pos + 1;
+
+        if (child >= h->len)
+            break;
+        if (child + 1 < h->len &&
+                lc_heap_before(h->nodes[child + 1], h->nodes[child]))
+            child++;
+        if (!lc_heap_before(h->nodes[child], n))
+            break;
+        h->nodes[pos] = h->nodes[child];
+        h->nodes[pos]->heap_pos = pos;
+        pos = child;
+    }
+    h->nodes[pos] = n;
+    n->heap_pos = pos;
+}
+
+/* Inserts the node, or moves it up after its cost decreased */
+static void lc_heap_update(struct lc_heap *h, struct lc_node *n)
+{
+    if (n->heap_pos == LC_HEAP_NONE)
+    {
+        h->nodes[h->len] = n;
+        n->heap_pos = h->len++;
+    }
+    lc_heap_sift_up(h, n->heap_pos);
+}
+
+static struct lc_node *lc_heap_pop(struct lc_heap *h)
+{
+    struct lc_node *n;
+
+    if (h->len == 0)
+        return NULL;
+
+    n = h->nodes[0];
+    n->heap_pos = LC_HEAP_DONE;
+
+    if (--h->len > 0)
+    {
+        h->nodes[0] = h->nodes[h->len];
+        lc_heap_sift_down(h, 0);
+    }
+    return n;
 }
 
 /*
@@ -436,7 +531,12 @@ void NSCLASS __dijkstra(struct in_addr src)
 {
     TBL(S, LC_NODES_MAX);
     struct lc_node *src_node, *u;
-    int i = 0;
+    struct lc_heap heap;
+    dsr_list_t *pos;
+    unsigned int order = 0;
+
+    /* The node costs are overwritten below */
+    LC.src = NULL;
 
     if (TBL_EMPTY(&LC.nodes))
     {
@@ -444,25 +544,51 @@ void NSCLASS __dijkstra(struct in_addr src)
         return;
     }
 
-    __dijkstra_init_single_source(&LC.nodes, src);
+    /* Initialize single source, and remember the order of the nodes in
+     * the table to break ties between nodes with equal cost */
+    list_for_each(pos, &LC.nodes.head)
+    {
+        struct lc_node *n = (struct lc_node *)pos;
+
+        do_init(n, &src);
+        n->order = order++;
+        n->heap_pos = LC_HEAP_NONE;
+    }
 
     src_node = (struct lc_node *)__tbl_find(&LC.nodes, &src, crit_addr);
 
     if (!src_node)
         return;
 
-    while ((u = __dijkstra_find_lowest_cost_node(&LC.nodes)))
+    heap.nodes = (struct lc_node **)MALLOC(LC.nodes.len * sizeof(struct lc_node *),
+                                           GFP_ATOMIC);
+    if (!heap.nodes)
     {
+        DEBUG("Could not allocate Dijkstra heap\n");
+        return;
+    }
+    heap.len = 0;
+    lc_heap_update(&heap, src_node);
+
+    while ((u = lc_heap_pop(&heap)))
+    {
+        struct lc_link *link;
 
         tbl_detach(&LC.nodes, &u->l);
 
         /* Add to S */
         tbl_add_tail(&S, &u->l);
 
-        tbl_do_for_each(&LC.links, u, do_relax);
-        i++;
+        for (link = u->out_links; link; link = link->next_out)
+        {
+            if (do_relax(link, u) && (link->dst->heap_pos == LC_HEAP_NONE ||
+                                      link->dst->heap_pos >= 0))
+                lc_heap_update(&heap, link->dst);
+        }
     }
 
+    FREE(heap.nodes);
+
     /* Restore the nodes in the LC graph */
     /* memcpy(&LC.nodes, &S, sizeof(S)); */
     /*  LC.nodes = S; */
@@ -482,8 +608,10 @@ struct dsr_srt *NSCLASS lc_srt_find(struct in_addr src, struct in_addr dst)
 
     DSR_WRITE_LOCK(&LC.lock);
 
-    /*  if (!LC.src || LC.src->addr.s_addr != src.s_addr) */
-    __dijkstra(src);
+    /* Reuse the shortest path tree if it was calculated for the same source;
+     * any change in the link cache invalidates it */
+    if (!LC.src || LC.src->addr.s_addr != src.s_addr)
+        __dijkstra(src);
 
     dst_node = (struct lc_node *)__tbl_find(&LC.nodes, &dst, crit_addr);
 
@@ -32,6 +32,7 @@
 
 #include <math.h>
 #include <limits.h>
+#include <algorithm>
 
 #include "UDPPacket.h"
 #include "IPv4Datagram.h"
@@ -755,28 +756,6 @@ OLSR::recv_olsr(cMessage* msg)
 }
 
 
- void CoverTwoHopNeighbors(const nsaddr_t &neighborMainAddr, nb2hopset_t & N2)
-{ // first gather all 2-hop neighbors to be removed
-    std::set<nsaddr_t> toRemove;
-    for (nb2hopset_t::iterator it = N2.begin(); it != N2.end(); it++)
-    {
-        OLSR_nb2hop_tuple* twoHopNeigh = *it;
-        if (twoHopNeigh->nb_main_addr() == neighborMainAddr)
-        {
-            toRemove.insert(twoHopNeigh->nb2hop_addr());
-        }
-    }
-    // Now remove all matching records from N2
-    for (nb2hopset_t::iterator it = N2.begin(); it != N2.end();)
-    {
-        OLSR_nb2hop_tuple* twoHopNeigh = *it;
-        if (toRemove.find(twoHopNeigh->nb2hop_addr()) != toRemove.end())
-            it = N2.erase(it);
-        else
-            it++;
-    }
-}
-
 ///
 /// \brief Computates MPR set of a node following RFC 3626 hints.
 ///
@@ -1062,9 +1041,13 @@ OLSR::mpr_computation()
     nbset_t N; nb2hopset_t N2;
     // N is the subset of neighbors of the node, which are
     // neighbor "of the interface I"
+    std::map<nsaddr_t, OLSR_nb_tuple*> firstN;
     for (nbset_t::iterator it = nbset().begin(); it != nbset().end(); it++)
         if ((*it)->getStatus() == OLSR_STATUS_SYM) // I think that we need this check
+        {
             N.push_back(*it);
+            firstN.insert(std::make_pair((*it)->nb_main_addr(), *it));
+        }
 
     // N2 is the set of 2-hop neighbors reachable from "the interface
     // I", excluding:
@@ -1082,25 +1065,8 @@ OLSR::mpr_computation()
         }
         // excluding:
         // (i) the nodes only reachable by members of N with willingness WILL_NEVER
-        bool ok = false;
-        for (nbset_t::const_iterator it2 = N.begin(); it2 != N.end(); it2++)
-        {
-            OLSR_nb_tuple* neigh = *it2;
-            if (neigh->nb_main_addr() == nb2hop_tuple->nb_main_addr())
-            {
-                if (neigh->willingness() == OLSR_WILL_NEVER)
-                {
-                    ok = false;
-                    break;
-                }
-                else
-                {
-                    ok = true;
-                    break;
-                }
-            }
-        }
-        if (!ok)
+        std::map<nsaddr_t, OLSR_nb_tuple*>::iterator itNb = firstN.find(nb2hop_tuple->nb_main_addr());
+        if (itNb == firstN.end() || itNb->second->willingness() == OLSR_WILL_NEVER)
         {
             continue;
         }
@@ -1108,19 +1074,23 @@ OLSR::mpr_computation()
         // excluding:
         // (iii) all the symmetric neighbors: the nodes for which there exists a symmetric
         //       link to this node on some interface.
-        for (nbset_t::iterator it2 = N.begin(); it2 != N.end(); it2++)
-        {
-            OLSR_nb_tuple* neigh = *it2;
-            if (neigh->nb_main_addr() == nb2hop_tuple->nb2hop_addr())
-            {
-                ok = false;
-                break;
-            }
-        }
-        if (ok)
+        if (firstN.find(nb2hop_tuple->nb2hop_addr()) == firstN.end())
             N2.push_back(nb2hop_tuple);
     }
 
+    // Instead of erasing the covered members of N2, they are marked, and the
+    // number of uncovered members reachable through each 1-hop neighbor
+    // is kept up to date.
+    TwoHopCoverage coverage;
+    coverage.covered.assign(N2.size(), false);
+    coverage.numUncovered = N2.size();
+    for (int i = 0; i < (int)N2.size(); i++)
+    {
+        coverage.byNb[N2[i]->nb_main_addr()].push_back(i);
+        coverage.by2hop[N2[i]->nb2hop_addr()].push_back(i);
+        coverage.reachability[N2[i]->nb_main_addr()]++;
+    }
+
     // 1. Start with an MPR set made of all members of N with
     // N_willingness equal to WILL_ALWAYS
     for (nbset_t::iterator it = N.begin(); it != N.end(); it++)
@@ -1131,7 +1101,7 @@ OLSR::mpr_computation()
             state_.insert_mpr_addr(nb_tuple->nb_main_addr());
             // (not in RFC but I think is needed: remove the 2-hop
             // neighbors reachable by the MPR from N2)
-            CoverTwoHopNeighbors (nb_tuple->nb_main_addr(), N2);
+            cover_two_hop_neighbors(nb_tuple->nb_main_addr(), N2, coverage);
         }
     }
 
@@ -1142,78 +1112,51 @@ OLSR::mpr_computation()
     // nodes to provide reachability to a node in N2. Remove the
     // nodes from N2 which are now covered by a node in the MPR set.
 
-    std::set<nsaddr_t> coveredTwoHopNeighbors;
-    for (nb2hopset_t::iterator it = N2.begin(); it != N2.end(); it++)
+    // for each uncovered 2-hop neighbor: whether more than one neighbor reaches it
+    std::map<nsaddr_t, bool> reachedByMore;
+    std::map<nsaddr_t, nsaddr_t> reachedBy;
+    for (int i = 0; i < (int)N2.size(); i++)
     {
-        OLSR_nb2hop_tuple* twoHopNeigh = *it;
-        bool onlyOne = true;
-        // try to find another neighbor that can reach twoHopNeigh->twoHopNeighborAddr
-        for (nb2hopset_t::const_iterator it2 = N2.begin(); it2 != N2.end(); it2++)
-        {
-            OLSR_nb2hop_tuple* otherTwoHopNeigh = *it2;
-            if (otherTwoHopNeigh->nb2hop_addr() == twoHopNeigh->nb2hop_addr()
-                    && otherTwoHopNeigh->nb_main_addr() != twoHopNeigh->nb_main_addr())
-            {
-                onlyOne = false;
-                break;
-            }
-        }
-        if (onlyOne)
+        if (coverage.covered[i])
+            continue;
+        std::map<nsaddr_t, nsaddr_t>::iterator itBy = reachedBy.find(N2[i]->nb2hop_addr());
+        if (itBy == reachedBy.end())
+            reachedBy.insert(std::make_pair(N2[i]->nb2hop_addr(), N2[i]->nb_main_addr()));
+        else if (itBy->second != N2[i]->nb_main_addr())
+            reachedByMore[N2[i]->nb2hop_addr()] = true;
+    }
+    std::set<nsaddr_t> onlyNbs;
+    for (std::map<nsaddr_t, nsaddr_t>::iterator it = reachedBy.begin(); it != reachedBy.end(); it++)
+    {
+        if (!reachedByMore[it->first])
         {
-            state_.insert_mpr_addr(twoHopNeigh->nb_main_addr());
-
-            // take note of all the 2-hop neighbors reachable by the newly elected MPR
-            for (nb2hopset_t::const_iterator it2 = N2.begin(); it2 != N2.end(); it2++)
-            {
-                OLSR_nb2hop_tuple* otherTwoHopNeigh = *it2;
-                if (otherTwoHopNeigh->nb_main_addr() == twoHopNeigh->nb_main_addr())
-                {
-                    coveredTwoHopNeighbors.insert(otherTwoHopNeigh->nb2hop_addr());
-                }
-            }
+            state_.insert_mpr_addr(it->second);
+            onlyNbs.insert(it->second);
         }
     }
     // Remove the nodes from N2 which are now covered by a node in the MPR set.
-    for (nb2hopset_t::iterator it = N2.begin(); it != N2.end();)
+    std::set<nsaddr_t> coveredTwoHopNeighbors;
+    for (std::set<nsaddr_t>::iterator it = onlyNbs.begin(); it != onlyNbs.end(); it++)
     {
-        OLSR_nb2hop_tuple* twoHopNeigh = *it;
-        if (coveredTwoHopNeighbors.find(twoHopNeigh->nb2hop_addr()) != coveredTwoHopNeighbors.end())
-        {
-            // This works correctly only because it is known that twoHopNeigh is reachable by exactly one neighbor,
-            // so only one record in N2 exists for each of them. This record is erased here.
-            it = N2.erase(it);
-        }
-        else
-        {
-            it++;
-        }
+        std::vector<int>& tuples = coverage.byNb[*it];
+        for (std::vector<int>::iterator it2 = tuples.begin(); it2 != tuples.end(); it2++)
+            if (!coverage.covered[*it2])
+                coveredTwoHopNeighbors.insert(N2[*it2]->nb2hop_addr());
     }
+    for (std::set<nsaddr_t>::iterator it = coveredTwoHopNeighbors.begin(); it != coveredTwoHopNeighbors.end(); it++)
+        cover_two_hop_neighbor(*it, N2, coverage);
+
     // 4. While there exist nodes in N2 which are not covered by at
     // least one node in the MPR set:
 
-    while (N2.begin() != N2.end())
+    // D(y) does not depend on N2, so it is calculated once per neighbor
+    std::vector<int> degrees(N.size(), -1);
+    while (coverage.numUncovered > 0)
     {
-
         // 4.1. For each node in N, calculate the reachability, i.e., the
         // number of nodes in N2 which are not yet covered by at
         // least one node in the MPR set, and which are reachable
         // through this 1-hop neighbor
-        std::map<int, std::vector<OLSR_nb_tuple*> > reachability;
-        std::set<int> rs;
-        for (nbset_t::iterator it = N.begin(); it != N.end(); it++)
-        {
-            OLSR_nb_tuple* nb_tuple = *it;
-            int r = 0;
-            for (nb2hopset_t::iterator it2 = N2.begin(); it2 != N2.end(); it2++)
-            {
-                OLSR_nb2hop_tuple* nb2hop_tuple = *it2;
-
-                if (nb_tuple->nb_main_addr() == nb2hop_tuple->nb_main_addr())
-                    r++;
-            }
-            rs.insert(r);
-            reachability[r].push_back(nb_tuple);
-        }
 
         // 4.2. Select as a MPR the node with highest N_willingness among
         // the nodes in N with non-zero reachability. In case of
@@ -1223,74 +1166,99 @@ OLSR::mpr_computation()
         // reachability, select the node as MPR whose D(y) is
         // greater. Remove the nodes from N2 which are now covered
         // by a node in the MPR set.
-        OLSR_nb_tuple *max = NULL;
+        // Of equal candidates, the first one in N is selected.
+        int max = -1;
         int max_r = 0;
-        for (std::set<int>::iterator it = rs.begin(); it != rs.end(); it++)
+        for (int i = 0; i < (int)N.size(); i++)
         {
-            int r = *it;
+            OLSR_nb_tuple *nb_tuple = N[i];
+            int r = coverage.reachability[nb_tuple->nb_main_addr()];
             if (r == 0)
-            {
                 continue;
-            }
-            for (std::vector<OLSR_nb_tuple *>::iterator it2 = reachability[r].begin();
-                    it2 != reachability[r].end(); it2++)
+            bool better = max == -1 || nb_tuple->willingness() > N[max]->willingness();
+            if (!better && nb_tuple->willingness() == N[max]->willingness())
             {
-                OLSR_nb_tuple *nb_tuple = *it2;
-                if (max == NULL || nb_tuple->willingness() > max->willingness())
+                if (r > max_r)
+                    better = true;
+                else if (r == max_r)
                 {
-                    max = nb_tuple;
-                    max_r = r;
-                }
-                else if (nb_tuple->willingness() == max->willingness())
-                {
-                    if (r > max_r)
-                    {
-                        max = nb_tuple;
-                        max_r = r;
-                    }
-                    else if (r == max_r)
-                    {
-                        if (degree(nb_tuple) > degree(max))
-                        {
-                            max = nb_tuple;
-                            max_r = r;
-                        }
-                    }
+                    if (degrees[i] == -1)
+                        degrees[i] = degree(nb_tuple);
+                    if (degrees[max] == -1)
+                        degrees[max] = degree(N[max]);
+                    better = degrees[i] > degrees[max];
                 }
             }
+            if (better)
+            {
+                max = i;
+                max_r = r;
+            }
         }
-        if (max != NULL)
-        {
-            state_.insert_mpr_addr(max->nb_main_addr());
-            CoverTwoHopNeighbors(max->nb_main_addr(), N2);
-            EV << N2.size () << " 2-hop neighbors left to cover! \n";
-        }
+        if (max == -1)
+            break;
+        state_.insert_mpr_addr(N[max]->nb_main_addr());
+        cover_two_hop_neighbors(N[max]->nb_main_addr(), N2, coverage);
+        EV << coverage.numUncovered << " 2-hop neighbors left to cover! \n";
     }
 }
 #endif
+
 ///
-/// \brief Creates the routing table of the node following RFC 3626 hints.
+/// \brief Marks the members of N2 reachable through the given 1-hop neighbor
+/// as covered, together with the other members for the same 2-hop neighbors.
 ///
 void
-OLSR::rtable_computation()
+OLSR::cover_two_hop_neighbors(const nsaddr_t &neighborMainAddr, const nb2hopset_t &N2, TwoHopCoverage &coverage)
 {
-    nsaddr_t netmask(IPv4Address::ALLONES_ADDRESS);
-    // 1. All the entries from the routing table are removed.
-    //
+    std::map<nsaddr_t, std::vector<int> >::iterator itNb = coverage.byNb.find(neighborMainAddr);
+    if (itNb == coverage.byNb.end())
+        return;
+    // first gather all 2-hop neighbors to be removed
+    std::vector<nsaddr_t> toRemove;
+    for (std::vector<int>::iterator it = itNb->second.begin(); it != itNb->second.end(); it++)
+        if (!coverage.covered[*it])
+            toRemove.push_back(N2[*it]->nb2hop_addr());
+    for (std::vector<nsaddr_t>::iterator it = toRemove.begin(); it != toRemove.end(); it++)
+        cover_two_hop_neighbor(*it, N2, coverage);
+}
 
-    if (par("DelOnlyRtEntriesInrtable_").boolValue())
+///
+/// \brief Marks the members of N2 for the given 2-hop neighbor as covered.
+///
+void
+OLSR::cover_two_hop_neighbor(const nsaddr_t &twoHopNeighborAddr, const nb2hopset_t &N2, TwoHopCoverage &coverage)
+{
+    std::vector<int>& tuples = coverage.by2hop[twoHopNeighborAddr];
+    for (std::vector<int>::iterator it = tuples.begin(); it != tuples.end(); it++)
     {
-        for (rtable_t::const_iterator itRtTable = rtable_.getInternalTable()->begin();itRtTable != rtable_.getInternalTable()->begin();++itRtTable)
+        if (!coverage.covered[*it])
         {
-            nsaddr_t addr = itRtTable->first;
-            omnet_chg_rte(addr, addr,netmask,1, true, addr);
+            coverage.covered[*it] = true;
+            coverage.reachability[N2[*it]->nb_main_addr()]--;
+            coverage.numUncovered--;
         }
     }
-    else
-        omnet_clean_rte(); // clean IP tables
-
+}
+///
+/// \brief Creates the routing table of the node following RFC 3626 hints.
+///
+void
+OLSR::rtable_computation()
+{
+    // 1. All the entries from the routing table are removed.
+    // The IP routing table is only updated with the differences at the end.
+    begin_ip_route_update();
     rtable_.clear();
 
+    // valid links, by the main address of the neighbor
+    std::map<nsaddr_t, std::vector<OLSR_link_tuple*> > links;
+    for (linkset_t::iterator it = linkset().begin(); it != linkset().end(); it++)
+    {
+        OLSR_link_tuple* link_tuple = *it;
+        if (link_tuple->time() >= CURRENT_TIME)
+            links[get_main_addr(link_tuple->nb_iface_addr())].push_back(link_tuple);
+    }
 
     // 2. The new routing entries are added starting with the
     // symmetric neighbors (h=1) as the destination nodes.
@@ -1300,32 +1268,30 @@ OLSR::rtable_computation()
         OLSR_nb_tuple* nb_tuple = *it;
         if (nb_tuple->getStatus() == OLSR_STATUS_SYM)
         {
+            std::map<nsaddr_t, std::vector<OLSR_link_tuple*> >::iterator itLinks = links.find(nb_tuple->nb_main_addr());
+            if (itLinks == links.end())
+                continue;
             bool nb_main_addr = false;
             OLSR_link_tuple* lt = NULL;
-            for (linkset_t::iterator it2 = linkset().begin(); it2 != linkset().end(); it2++)
+            for (std::vector<OLSR_link_tuple*>::iterator it2 = itLinks->second.begin(); it2 != itLinks->second.end(); it2++)
             {
                 OLSR_link_tuple* link_tuple = *it2;
-                if (get_main_addr(link_tuple->nb_iface_addr()) == nb_tuple->nb_main_addr() && link_tuple->time() >= CURRENT_TIME)
-                {
-                    lt = link_tuple;
-                    rtable_.add_entry(link_tuple->nb_iface_addr(),
-                                      link_tuple->nb_iface_addr(),
-                                      link_tuple->local_iface_addr(),
-                                      1, link_tuple->local_iface_index());
-                    if (!useIndex)
-                        omnet_chg_rte(link_tuple->nb_iface_addr(),
-                                       link_tuple->nb_iface_addr(),
-                                       netmask,
-                                       1, false, link_tuple->local_iface_addr());
-                    else
-                        omnet_chg_rte(link_tuple->nb_iface_addr(),
-                                       link_tuple->nb_iface_addr(),
-                                       netmask,
-                                       1, false, link_tuple->local_iface_index());
+                lt = link_tuple;
+                rtable_.add_entry(link_tuple->nb_iface_addr(),
+                                  link_tuple->nb_iface_addr(),
+                                  link_tuple->local_iface_addr(),
+                                  1, link_tuple->local_iface_index());
+                if (!useIndex)
+                    set_ip_route(link_tuple->nb_iface_addr(),
+                                 link_tuple->nb_iface_addr(),
+                                 1, link_tuple->local_iface_addr());
+                else
+                    set_ip_route(link_tuple->nb_iface_addr(),
+                                 link_tuple->nb_iface_addr(),
+                                 1, link_tuple->local_iface_index());
 
-                    if (link_tuple->nb_iface_addr() == nb_tuple->nb_main_addr())
-                        nb_main_addr = true;
-                }
+                if (link_tuple->nb_iface_addr() == nb_tuple->nb_main_addr())
+                    nb_main_addr = true;
             }
             if (!nb_main_addr && lt != NULL)
             {
@@ -1335,20 +1301,28 @@ OLSR::rtable_computation()
                                   1, lt->local_iface_index());
 
                 if (!useIndex)
-                    omnet_chg_rte(nb_tuple->nb_main_addr(),
-                                   lt->nb_iface_addr(),
-                                   netmask,// Default mask
-                                   1, false, lt->local_iface_addr());
-
+                    set_ip_route(nb_tuple->nb_main_addr(),
+                                 lt->nb_iface_addr(),
+                                 1, lt->local_iface_addr());
                 else
-                    omnet_chg_rte(nb_tuple->nb_main_addr(),
-                                   lt->nb_iface_addr(),
-                                   netmask,// Default mask
-                                   1, false, lt->local_iface_index());
+                    set_ip_route(nb_tuple->nb_main_addr(),
+                                 lt->nb_iface_addr(),
+                                 1, lt->local_iface_index());
             }
         }
     }
 
+    std::set<nsaddr_t> symNbs;
+    std::set<nsaddr_t> willNeverNbs;
+    for (nbset_t::iterator it = nbset().begin(); it != nbset().end(); it++)
+    {
+        OLSR_nb_tuple* nb_tuple = *it;
+        if (nb_tuple->getStatus() == OLSR_STATUS_SYM)
+            symNbs.insert(nb_tuple->nb_main_addr());
+        if (nb_tuple->willingness() == OLSR_WILL_NEVER)
+            willNeverNbs.insert(nb_tuple->nb_main_addr());
+    }
+
     // N2 is the set of 2-hop neighbors reachable from this node, excluding:
     // (i)   the nodes only reachable by members of N with willingness WILL_NEVER
     // (ii)  the node performing the computation
@@ -1357,22 +1331,9 @@ OLSR::rtable_computation()
     for (nb2hopset_t::iterator it = nb2hopset().begin(); it != nb2hopset().end(); it++)
     {
         OLSR_nb2hop_tuple* nb2hop_tuple = *it;
-        bool ok = true;
-        OLSR_nb_tuple* nb_tuple = state_.find_sym_nb_tuple(nb2hop_tuple->nb_main_addr());
-        if (nb_tuple == NULL)
-            ok = false;
-        else
-        {
-            nb_tuple = state_.find_nb_tuple(nb2hop_tuple->nb_main_addr(), OLSR_WILL_NEVER);
-            if (nb_tuple != NULL)
-                ok = false;
-            else
-            {
-                nb_tuple = state_.find_sym_nb_tuple(nb2hop_tuple->nb2hop_addr());
-                if (nb_tuple != NULL)
-                    ok = false;
-            }
-        }
+        bool ok = symNbs.find(nb2hop_tuple->nb_main_addr()) != symNbs.end()
+                && willNeverNbs.find(nb2hop_tuple->nb_main_addr()) == willNeverNbs.end()
+                && symNbs.find(nb2hop_tuple->nb2hop_addr()) == symNbs.end();
 
         // 3. For each node in N2 create a new entry in the routing table
         if (ok)
@@ -1384,20 +1345,26 @@ OLSR::rtable_computation()
                               entry->iface_addr(),
                               2, entry->local_iface_index());
             if (!useIndex)
-                omnet_chg_rte(nb2hop_tuple->nb2hop_addr(),
-                               entry->next_addr(),
-                               netmask,
-                               2, false, entry->iface_addr());
-
+                set_ip_route(nb2hop_tuple->nb2hop_addr(),
+                             entry->next_addr(),
+                             2, entry->iface_addr());
             else
-                omnet_chg_rte(nb2hop_tuple->nb2hop_addr(),
-                               entry->next_addr(),
-                               netmask,
-                               2, false, entry->local_iface_index());
-
+                set_ip_route(nb2hop_tuple->nb2hop_addr(),
+                             entry->next_addr(),
+                             2, entry->local_iface_index());
         }
     }
 
+    // topology tuples by T_last_addr, as positions in the topology set
+    std::map<nsaddr_t, std::vector<int> > topologyByLast;
+    for (int i = 0; i < (int)topologyset().size(); i++)
+        topologyByLast[topologyset()[i]->last_addr()].push_back(i);
+
+    // destinations of the routing table by R_dist; entries are not replaced from now on
+    std::map<uint32_t, std::vector<nsaddr_t> > destsByDist;
+    for (rtable_t::const_iterator it = rtable_.getInternalTable()->begin(); it != rtable_.getInternalTable()->end(); ++it)
+        destsByDist[it->second->dist()].push_back(it->first);
+
     for (uint32_t h = 2;; h++)
     {
         bool added = false;
@@ -1408,11 +1375,21 @@ OLSR::rtable_computation()
         // corresponds to R_dest_addr of a route entry whose R_dist
         // is equal to h, then a new route entry MUST be recorded in
         // the routing table (if it does not already exist)
-        for (topologyset_t::iterator it = topologyset().begin();
-                it != topologyset().end();
-                it++)
+        // Only the tuples whose T_last_addr is at distance h are visited,
+        // in topology set order.
+        std::vector<int> candidates;
+        std::vector<nsaddr_t>& dests = destsByDist[h];
+        for (std::vector<nsaddr_t>::iterator it = dests.begin(); it != dests.end(); it++)
+        {
+            std::map<nsaddr_t, std::vector<int> >::iterator itTopology = topologyByLast.find(*it);
+            if (itTopology != topologyByLast.end())
+                candidates.insert(candidates.end(), itTopology->second.begin(), itTopology->second.end());
+        }
+        std::sort(candidates.begin(), candidates.end());
+
+        for (std::vector<int>::iterator it = candidates.begin(); it != candidates.end(); it++)
         {
-            OLSR_topology_tuple* topology_tuple = *it;
+            OLSR_topology_tuple* topology_tuple = topologyset()[*it];
             OLSR_rt_entry* entry1 = rtable_.lookup(topology_tuple->dest_addr());
             OLSR_rt_entry* entry2 = rtable_.lookup(topology_tuple->last_addr());
             if (entry1 == NULL && entry2 != NULL && entry2->dist() == h)
@@ -1423,17 +1400,15 @@ OLSR::rtable_computation()
                                   h+1, entry2->local_iface_index(), entry2);
 
                 if (!useIndex)
-                    omnet_chg_rte(topology_tuple->dest_addr(),
-                                   entry2->next_addr(),
-                                   netmask,
-                                   h+1, false, entry2->iface_addr());
-
+                    set_ip_route(topology_tuple->dest_addr(),
+                                 entry2->next_addr(),
+                                 h+1, entry2->iface_addr());
                 else
-                    omnet_chg_rte(topology_tuple->dest_addr(),
-                                   entry2->next_addr(),
-                                   netmask,
-                                   h+1, false, entry2->local_iface_index());
+                    set_ip_route(topology_tuple->dest_addr(),
+                                 entry2->next_addr(),
+                                 h+1, entry2->local_iface_index());
 
+                destsByDist[h+1].push_back(topology_tuple->dest_addr());
                 added = true;
             }
         }
@@ -1459,16 +1434,15 @@ OLSR::rtable_computation()
                                   entry1->dist(), entry1->local_iface_index(), entry1);
 
                 if (!useIndex)
-                    omnet_chg_rte(tuple->iface_addr(),
-                                   entry1->next_addr(),
-                                   netmask,
-                                   entry1->dist(), false, entry1->iface_addr());
-
+                    set_ip_route(tuple->iface_addr(),
+                                 entry1->next_addr(),
+                                 entry1->dist(), entry1->iface_addr());
                 else
-                    omnet_chg_rte(tuple->iface_addr(),
-                                   entry1->next_addr(),
-                                   netmask,
-                                   entry1->dist(), false, entry1->local_iface_index());
+                    set_ip_route(tuple->iface_addr(),
+                                 entry1->next_addr(),
+                                 entry1->dist(), entry1->local_iface_index());
+
+                destsByDist[entry1->dist()].push_back(tuple->iface_addr());
                 added = true;
             }
         }
@@ -1476,9 +1450,88 @@ OLSR::rtable_computation()
         if (!added)
             break;
     }
+    commit_ip_route_update();
     setTopologyChanged(false);
 }
 
+///
+/// \brief Starts collecting the routes of a routing table computation.
+///
+/// The IP routing table is left untouched until commit_ip_route_update().
+///
+void
+OLSR::begin_ip_route_update()
+{
+    newIpRoutes_.clear();
+}
+
+///
+/// \brief Records the route of a destination, replacing the one recorded earlier
+/// in the same computation.
+///
+void
+OLSR::set_ip_route(const nsaddr_t &dest, const nsaddr_t &gateway, uint32_t hops, const nsaddr_t &iface)
+{
+    IpRoute& route = newIpRoutes_[dest];
+    route.gateway = gateway;
+    route.hops = hops;
+    route.byIndex = false;
+    route.iface = iface;
+    route.index = -1;
+}
+
+void
+OLSR::set_ip_route(const nsaddr_t &dest, const nsaddr_t &gateway, uint32_t hops, int index)
+{
+    IpRoute& route = newIpRoutes_[dest];
+    route.gateway = gateway;
+    route.hops = hops;
+    route.byIndex = true;
+    route.iface = ManetAddress::ZERO;
+    route.index = index;
+}
+
+///
+/// \brief Updates the IP routing table with the differences between the routes
+/// recorded since begin_ip_route_update() and the ones installed before.
+///
+/// Unless DelOnlyRtEntriesInrtable_ is set, the wlan routes of the IP routing
+/// table are flushed once, on the first update, as every update used to do.
+///
+void
+OLSR::commit_ip_route_update()
+{
+    nsaddr_t netmask(IPv4Address::ALLONES_ADDRESS);
+
+    if (!ipRoutesFlushed_)
+    {
+        if (!par("DelOnlyRtEntriesInrtable_").boolValue())
+            omnet_clean_rte(); // clean IP tables
+        ipRoutesFlushed_ = true;
+    }
+
+    for (IpRouteMap::iterator it = ipRoutes_.begin(); it != ipRoutes_.end(); it++)
+    {
+        if (newIpRoutes_.find(it->first) == newIpRoutes_.end())
+            omnet_chg_rte(it->first, it->first, netmask, 1, true, it->first);
+    }
+
+    for (IpRouteMap::iterator it = newIpRoutes_.begin(); it != newIpRoutes_.end(); it++)
+    {
+        IpRouteMap::iterator itOld = ipRoutes_.find(it->first);
+        if (itOld != ipRoutes_.end() && itOld->second == it->second)
+            continue;
+        const IpRoute& route = it->second;
+        if (!route.byIndex)
+            omnet_chg_rte(it->first, route.gateway, netmask, route.hops, false, route.iface);
+        else
+            omnet_chg_rte(it->first, route.gateway, netmask, route.hops, false, route.index);
+    }
+
+    ipRoutes_.swap(newIpRoutes_);
+    newIpRoutes_.clear();
+}
+
 ///
 /// \brief Processes a HELLO message following RFC 3626 specification.
 ///
@@ -2267,6 +2320,8 @@ OLSR::mac_failed(IPv4Datagram* p)
         }
     }
     deleteIpEntry(dest_addr);
+    // forget the deleted route, so that the next routing table computation installs it again
+    ipRoutes_.erase(dest_addr);
 }
 
 ///
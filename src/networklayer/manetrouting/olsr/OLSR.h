@@ -419,6 +419,39 @@ class OLSR : public ManetRoutingBase
 
     bool optimizedMid;
 
+    /// Route of a destination as installed into the IP routing table.
+    struct IpRoute
+    {
+        nsaddr_t gateway;
+        uint32_t hops;
+        bool byIndex;
+        nsaddr_t iface;
+        int index;
+        bool operator==(const IpRoute& other) const
+        {
+            return gateway == other.gateway && hops == other.hops && byIndex == other.byIndex
+                    && (byIndex ? index == other.index : iface == other.iface);
+        }
+    };
+    typedef std::map<nsaddr_t, IpRoute> IpRouteMap;
+
+    /// Coverage of the members of N2 during the MPR computation.
+    struct TwoHopCoverage
+    {
+        std::vector<bool> covered;  ///< by position in N2
+        int numUncovered;
+        std::map<nsaddr_t, std::vector<int> > byNb;    ///< positions by N_neighbor_main_addr
+        std::map<nsaddr_t, std::vector<int> > by2hop;  ///< positions by N_2hop_addr
+        std::map<nsaddr_t, int> reachability;  ///< uncovered members by N_neighbor_main_addr
+    };
+
+    /// Routes installed into the IP routing table by the last routing table computation.
+    IpRouteMap ipRoutes_;
+    /// Routes collected by the routing table computation in progress.
+    IpRouteMap newIpRoutes_;
+    /// Whether the wlan routes of the IP routing table were flushed already.
+    bool ipRoutesFlushed_;
+
   protected:
 // Omnet INET vaiables and functions
     char nodeName[50];
@@ -470,8 +503,15 @@ class OLSR : public ManetRoutingBase
     virtual void        recv_olsr(cMessage*);
 
     virtual void        mpr_computation();
+    virtual void        cover_two_hop_neighbors(const nsaddr_t &, const nb2hopset_t &, TwoHopCoverage &);
+    virtual void        cover_two_hop_neighbor(const nsaddr_t &, const nb2hopset_t &, TwoHopCoverage &);
     virtual void        rtable_computation();
 
+    virtual void        begin_ip_route_update();
+    virtual void        set_ip_route(const nsaddr_t &, const nsaddr_t &, uint32_t, const nsaddr_t &);
+    virtual void        set_ip_route(const nsaddr_t &, const nsaddr_t &, uint32_t, int);
+    virtual void        commit_ip_route_update();
+
     virtual bool        process_hello(OLSR_msg&, const nsaddr_t &, const nsaddr_t &, const int &);
     virtual bool        process_tc(OLSR_msg&, const nsaddr_t &, const int &);
     virtual void        process_mid(OLSR_msg&, const nsaddr_t &, const int &);
@@ -532,7 +572,7 @@ class OLSR : public ManetRoutingBase
     const char * getNodeId(const nsaddr_t &addr);
 
   public:
-    OLSR() {}
+    OLSR() {ipRoutesFlushed_ = false;}
     virtual ~OLSR();
 
 
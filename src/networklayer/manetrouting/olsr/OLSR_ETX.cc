@@ -1208,21 +1208,12 @@ OLSR_ETX::rtable_default_computation()
 void
 OLSR_ETX::rtable_dijkstra_computation()
 {
-    nsaddr_t netmask (IPv4Address::ALLONES_ADDRESS);
     // Declare a class that will run the dijkstra algorithm
     Dijkstra *dijkstra = new Dijkstra();
 
     // All the entries from the routing table are removed.
-    if (par("DelOnlyRtEntriesInrtable_").boolValue())
-    {
-        for (rtable_t::const_iterator itRtTable = rtable_.getInternalTable()->begin();itRtTable != rtable_.getInternalTable()->begin();++itRtTable)
-        {
-            nsaddr_t addr = itRtTable->first;
-            omnet_chg_rte(addr, addr,netmask,1, true, addr);
-        }
-    }
-    else
-        omnet_clean_rte(); // clean IP tables
+    // The IP routing table is only updated with the differences at the end.
+    begin_ip_route_update();
     rtable_.clear();
 
 
@@ -1360,7 +1351,7 @@ OLSR_ETX::rtable_dijkstra_computation()
         {
             // add route...
             rtable_.add_entry(it->second, it->second, itDij->second.link().last_node(), 1, -1,itDij->second.link().quality(),itDij->second.link().getDelay());
-            omnet_chg_rte(it->second, it->second, netmask, hopCount, false, itDij->second.link().last_node());
+            set_ip_route(it->second, it->second, hopCount, itDij->second.link().last_node());
         }
         else if (it->first > 1)
         {
@@ -1369,7 +1360,7 @@ OLSR_ETX::rtable_dijkstra_computation()
             if (entry==NULL)
                 opp_error("entry not found");
             rtable_.add_entry(it->second, entry->next_addr(), entry->iface_addr(), hopCount, entry->local_iface_index(),itDij->second.link().quality(),itDij->second.link().getDelay());
-            omnet_chg_rte (it->second, entry->next_addr(), netmask, hopCount, false, entry->iface_addr());
+            set_ip_route(it->second, entry->next_addr(), hopCount, entry->iface_addr());
         }
         processed_nodes.erase(processed_nodes.begin());
         dijkstra->dijkstraMap.erase(itDij);
@@ -1383,7 +1374,7 @@ OLSR_ETX::rtable_dijkstra_computation()
         {
             // add route...
             rtable_.add_entry(*it, *it, dijkstra->D(*it).link().last_node(), 1, -1);
-            omnet_chg_rte(*it, *it, netmask, 1, false, dijkstra->D(*it).link().last_node());
+            set_ip_route(*it, *it, 1, dijkstra->D(*it).link().last_node());
             processed_nodes.insert(*it);
         }
     }
@@ -1398,7 +1389,7 @@ OLSR_ETX::rtable_dijkstra_computation()
             OLSR_ETX_rt_entry* entry = rtable_.lookup(dijkstra->D(*it).link().last_node());
             assert(entry != NULL);
             rtable_.add_entry(*it, dijkstra->D(*it).link().last_node(), entry->iface_addr(), 2, entry->local_iface_index());
-            omnet_chg_rte(*it, dijkstra->D(*it).link().last_node(), netmask, 2, false, entry->iface_addr());
+            set_ip_route(*it, dijkstra->D(*it).link().last_node(), 2, entry->iface_addr());
             processed_nodes.insert(*it);
         }
     }
@@ -1415,7 +1406,7 @@ OLSR_ETX::rtable_dijkstra_computation()
                 OLSR_ETX_rt_entry* entry = rtable_.lookup(dijkstra->D(*it).link().last_node());
                 assert(entry != NULL);
                 rtable_.add_entry(*it, entry->next_addr(), entry->iface_addr(), i, entry->local_iface_index());
-                omnet_chg_rte(*it, entry->next_addr(), netmask, i, false, entry->iface_addr());
+                set_ip_route(*it, entry->next_addr(), i, entry->iface_addr());
                 processed_nodes.insert(*it);
             }
         }
@@ -1439,10 +1430,11 @@ OLSR_ETX::rtable_dijkstra_computation()
         {
             rtable_.add_entry(tuple->iface_addr(),
                               entry1->next_addr(), entry1->iface_addr(), entry1->dist(), entry1->local_iface_index(),entry1->quality,entry1->delay);
-            omnet_chg_rte(tuple->iface_addr(), entry1->next_addr(), netmask, entry1->dist(), false, entry1->iface_addr());
+            set_ip_route(tuple->iface_addr(), entry1->next_addr(), entry1->dist(), entry1->iface_addr());
 
         }
     }
+    commit_ip_route_update();
     // rtable_.print_debug(this);
     // destroy the dijkstra class we've created
     // dijkstra->clear ();
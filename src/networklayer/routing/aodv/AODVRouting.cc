@@ -28,6 +28,10 @@
 
 Define_Module(AODVRouting);
 
+simsignal_t AODVRouting::delayedPacketsSignal = registerSignal("delayedPackets");
+simsignal_t AODVRouting::delayedBytesSignal = registerSignal("delayedBytes");
+simsignal_t AODVRouting::dropPkFromDelayQueueSignal = registerSignal("dropPkFromDelayQueue");
+
 void AODVRouting::initialize(int stage)
 {
     if (stage == 0) {
@@ -65,6 +69,24 @@ void AODVRouting::initialize(int stage)
         netTraversalTime = par("netTraversalTime");
         nextHopWait = par("nextHopWait");
         pathDiscoveryTime = par("pathDiscoveryTime");
+
+        int maxDelayedPacketsPerDestinationPar = par("maxDelayedPacketsPerDestination");
+        if (maxDelayedPacketsPerDestinationPar < 0)
+            throw cRuntimeError("Invalid maxDelayedPacketsPerDestination parameter %d, must not be negative", maxDelayedPacketsPerDestinationPar);
+        maxDelayedPacketsPerDestination = maxDelayedPacketsPerDestinationPar;
+        maxDelayedBytes = par("maxDelayedBytes").longValue();
+        if (maxDelayedBytes < 0)
+            throw cRuntimeError("Invalid maxDelayedBytes parameter %" LL "d, must not be negative", maxDelayedBytes);
+        const char *delayQueueDropPolicy = par("delayQueueDropPolicy");
+        if (!strcmp(delayQueueDropPolicy, "dropTail"))
+            dropHeadWhenDelayQueueFull = false;
+        else if (!strcmp(delayQueueDropPolicy, "dropHead"))
+            dropHeadWhenDelayQueueFull = true;
+        else
+            throw cRuntimeError("Unknown delayQueueDropPolicy: '%s'", delayQueueDropPolicy);
+        numDelayedPackets = 0;
+        numDelayedBytes = 0;
+        rreqGenerationStart = SIMTIME_ZERO;
     }
     else if (stage == 4) {
         NodeStatus *nodeStatus = dynamic_cast<NodeStatus *>(host->getSubmodule("status"));
@@ -192,7 +214,7 @@ INetfilter::IHook::Result AODVRouting::ensureRouteForDatagram(IPv4Datagram *data
 
             EV_INFO << (isInactive ? "Inactive" : "Missing") << " route for destination " << destAddr << endl;
 
-            delayDatagram(datagram);
+            bool isDelayed = delayDatagram(datagram);
 
             if (!hasOngoingRouteDiscovery(destAddr)) {
                 // When a new route to the same destination is required at a later time
@@ -206,7 +228,7 @@ INetfilter::IHook::Result AODVRouting::ensureRouteForDatagram(IPv4Datagram *data
             else
                 EV_DETAIL << "Route discovery is in progress, originator " << getSelfIPAddress() << " target " << destAddr << endl;
 
-            return QUEUE;
+            return isDelayed ? QUEUE : DROP;
         }
         else
             return ACCEPT;
@@ -247,11 +269,98 @@ IPv4Address AODVRouting::getSelfIPAddress() const
     return routingTable->getRouterId();
 }
 
-void AODVRouting::delayDatagram(IPv4Datagram *datagram)
+bool AODVRouting::isDelayQueueFull(unsigned int queueLength, int64 delayedBytes) const
+{
+    // queueLength is the number of datagrams already waiting for the destination,
+    // delayedBytes the total size of all delayed datagrams including the arriving one
+    return (maxDelayedPacketsPerDestination != 0 && queueLength >= maxDelayedPacketsPerDestination) ||
+           (maxDelayedBytes != 0 && delayedBytes > maxDelayedBytes);
+}
+
+bool AODVRouting::delayDatagram(IPv4Datagram *datagram)
 {
-    EV_DETAIL << "Queuing datagram, source " << datagram->getSrcAddress() << ", destination " << datagram->getDestAddress() << endl;
     const IPv4Address& target = datagram->getDestAddress();
-    targetAddressToDelayedPackets.insert(std::pair<IPv4Address, IPv4Datagram *>(target, datagram));
+    int64 byteLength = datagram->getByteLength();
+    DelayedPacketQueue& queue = targetAddressToDelayedPackets[target];
+
+    // With the dropHead policy, room is made by dropping the oldest datagrams
+    // of the same destination. If even dropping all of them would not make room
+    // (because of the datagrams of other destinations), or with dropTail, the
+    // arriving datagram is dropped and the queue is left alone.
+    if (dropHeadWhenDelayQueueFull && isDelayQueueFull(queue.size(), numDelayedBytes + byteLength)) {
+        unsigned int numToDrop = 0;
+        int64 bytesToDrop = 0;
+        while (numToDrop < queue.size() && isDelayQueueFull(queue.size() - numToDrop, numDelayedBytes - bytesToDrop + byteLength))
+            bytesToDrop += queue[numToDrop++]->getByteLength();
+
+        if (!isDelayQueueFull(queue.size() - numToDrop, numDelayedBytes - bytesToDrop + byteLength)) {
+            for (unsigned int i = 0; i < numToDrop; i++) {
+                IPv4Datagram *oldestDatagram = queue.front();
+                queue.pop_front();
+                EV_WARN << "Delay queue is full, dropping the oldest datagram queued for destination " << target << endl;
+                dropDelayedDatagram(oldestDatagram);
+            }
+        }
+    }
+
+    if (isDelayQueueFull(queue.size(), numDelayedBytes + byteLength)) {
+        EV_WARN << "Delay queue is full, dropping datagram, source " << datagram->getSrcAddress() << ", destination " << target << endl;
+        if (queue.empty())
+            targetAddressToDelayedPackets.erase(target);
+        emit(dropPkFromDelayQueueSignal, datagram);
+        emitDelayedPacketStatistics();
+        return false;
+    }
+
+    EV_DETAIL << "Queuing datagram, source " << datagram->getSrcAddress() << ", destination " << target << endl;
+    queue.push_back(datagram);
+    numDelayedPackets++;
+    numDelayedBytes += byteLength;
+    emitDelayedPacketStatistics();
+    return true;
+}
+
+void AODVRouting::dropDelayedDatagram(IPv4Datagram *datagram)
+{
+    numDelayedPackets--;
+    numDelayedBytes -= datagram->getByteLength();
+    emit(dropPkFromDelayQueueSignal, datagram);
+    networkProtocol->dropQueuedDatagram(const_cast<const IPv4Datagram *>(datagram));
+}
+
+void AODVRouting::emitDelayedPacketStatistics()
+{
+    emit(delayedPacketsSignal, (long)numDelayedPackets);
+    emit(delayedBytesSignal, (long)numDelayedBytes);
+}
+
+void AODVRouting::expireRREQs()
+{
+    // all entries of the older generation arrived before rreqGenerationStart,
+    // so they have all expired after pathDiscoveryTime
+    if (simTime() - rreqGenerationStart >= pathDiscoveryTime) {
+        olderRREQs.swap(recentRREQs);
+        recentRREQs.clear();
+        rreqGenerationStart = simTime();
+    }
+}
+
+bool AODVRouting::hasRecentRREQ(const RREQIdentifier& rreqIdentifier)
+{
+    expireRREQs();
+    RREQArrivalTimeMap::iterator it = recentRREQs.find(rreqIdentifier);
+    if (it == recentRREQs.end()) {
+        it = olderRREQs.find(rreqIdentifier);
+        if (it == olderRREQs.end())
+            return false;
+    }
+    return simTime() - it->second <= pathDiscoveryTime;
+}
+
+void AODVRouting::rememberRREQ(const RREQIdentifier& rreqIdentifier)
+{
+    expireRREQs();
+    recentRREQs[rreqIdentifier] = simTime();
 }
 
 void AODVRouting::sendRREQ(AODVRREQ *rreq, const IPv4Address& destAddr, unsigned int timeToLive)
@@ -411,7 +520,7 @@ AODVRREQ *AODVRouting::createRREQ(const IPv4Address& destAddr)
     // it will not reprocess and re-forward the packet.
 
     RREQIdentifier rreqIdentifier(getSelfIPAddress(), rreqId);
-    rreqsArrivalTime[rreqIdentifier] = simTime();
+    rememberRREQ(rreqIdentifier);
 
     return rreqPacket;
 }
@@ -770,15 +879,14 @@ void AODVRouting::handleRREQ(AODVRREQ *rreq, const IPv4Address& sourceAddr, unsi
     // If such a RREQ has been received, the node silently discards the newly received RREQ.
 
     RREQIdentifier rreqIdentifier(rreq->getOriginatorAddr(), rreq->getRreqId());
-    std::map<RREQIdentifier, simtime_t, RREQIdentifierCompare>::iterator checkRREQArrivalTime = rreqsArrivalTime.find(rreqIdentifier);
-    if (checkRREQArrivalTime != rreqsArrivalTime.end() && simTime() - checkRREQArrivalTime->second <= pathDiscoveryTime) {
+    if (hasRecentRREQ(rreqIdentifier)) {
         EV_WARN << "The same packet has arrived within PATH_DISCOVERY_TIME= " << pathDiscoveryTime << ". Discarding it" << endl;
         delete rreq;
         return;
     }
 
     // update or create
-    rreqsArrivalTime[rreqIdentifier] = simTime();
+    rememberRREQ(rreqIdentifier);
 
     // First, it first increments the hop count value in the RREQ by one, to
     // account for the new hop through the intermediate node.
@@ -1215,13 +1323,18 @@ void AODVRouting::clearState()
         cancelAndDelete(it->second);
 
     // FIXME: Drop the queued datagrams.
-    //for (std::multimap<IPv4Address, IPv4Datagram *>::iterator it = targetAddressToDelayedPackets.begin(); it != targetAddressToDelayedPackets.end(); it++)
-    //    networkProtocol->dropQueuedDatagram(const_cast<const IPv4Datagram *>(it->second));
+    //for (std::map<IPv4Address, DelayedPacketQueue>::iterator it = targetAddressToDelayedPackets.begin(); it != targetAddressToDelayedPackets.end(); it++)
+    //    for (DelayedPacketQueue::iterator jt = it->second.begin(); jt != it->second.end(); jt++)
+    //        networkProtocol->dropQueuedDatagram(const_cast<const IPv4Datagram *>(*jt));
 
     targetAddressToDelayedPackets.clear();
+    numDelayedPackets = 0;
+    numDelayedBytes = 0;
 
     waitForRREPTimers.clear();
-    rreqsArrivalTime.clear();
+    recentRREQs.clear();
+    olderRREQs.clear();
+    rreqGenerationStart = simTime();
 
     if (useHelloMessages)
         cancelEvent(helloMsgTimer);
@@ -1275,19 +1388,24 @@ void AODVRouting::completeRouteDiscovery(const IPv4Address& target)
     EV_DETAIL << "Completing route discovery, originator " << getSelfIPAddress() << ", target " << target << endl;
     ASSERT(hasOngoingRouteDiscovery(target));
 
-    std::multimap<IPv4Address, IPv4Datagram *>::iterator lt = targetAddressToDelayedPackets.lower_bound(target);
-    std::multimap<IPv4Address, IPv4Datagram *>::iterator ut = targetAddressToDelayedPackets.upper_bound(target);
-
-    // reinject the delayed datagrams
-    for (std::multimap<IPv4Address, IPv4Datagram *>::iterator it = lt; it != ut; it++) {
-        IPv4Datagram *datagram = it->second;
-        EV_DETAIL << "Sending queued datagram: source " << datagram->getSrcAddress() << ", destination " << datagram->getDestAddress() << endl;
-        networkProtocol->reinjectQueuedDatagram(const_cast<const IPv4Datagram *>(datagram));
+    std::map<IPv4Address, DelayedPacketQueue>::iterator queueIt = targetAddressToDelayedPackets.find(target);
+    if (queueIt != targetAddressToDelayedPackets.end()) {
+        // take the queue out first, as reinjected datagrams may be delayed again
+        DelayedPacketQueue queue;
+        queue.swap(queueIt->second);
+        targetAddressToDelayedPackets.erase(queueIt);
+
+        // reinject the delayed datagrams in arrival order
+        for (DelayedPacketQueue::iterator it = queue.begin(); it != queue.end(); it++) {
+            IPv4Datagram *datagram = *it;
+            EV_DETAIL << "Sending queued datagram: source " << datagram->getSrcAddress() << ", destination " << datagram->getDestAddress() << endl;
+            numDelayedPackets--;
+            numDelayedBytes -= datagram->getByteLength();
+            networkProtocol->reinjectQueuedDatagram(const_cast<const IPv4Datagram *>(datagram));
+        }
+        emitDelayedPacketStatistics();
     }
 
-    // clear the multimap
-    targetAddressToDelayedPackets.erase(lt, ut);
-
     // we have a route for the destination, thus we must cancel the WaitForRREPTimer events
     std::map<IPv4Address, WaitForRREP *>::iterator waitRREPIter = waitForRREPTimers.find(target);
     ASSERT(waitRREPIter != waitForRREPTimers.end());
@@ -1565,12 +1683,15 @@ void AODVRouting::sendRERRWhenNoRouteToForward(const IPv4Address& unreachableAdd
 void AODVRouting::cancelRouteDiscovery(const IPv4Address& destAddr)
 {
     ASSERT(hasOngoingRouteDiscovery(destAddr));
-    std::multimap<IPv4Address, IPv4Datagram *>::iterator lt = targetAddressToDelayedPackets.lower_bound(destAddr);
-    std::multimap<IPv4Address, IPv4Datagram *>::iterator ut = targetAddressToDelayedPackets.upper_bound(destAddr);
-    for (std::multimap<IPv4Address, IPv4Datagram *>::iterator it = lt; it != ut; it++)
-        networkProtocol->dropQueuedDatagram(const_cast<const IPv4Datagram *>(it->second));
-
-    targetAddressToDelayedPackets.erase(lt, ut);
+    std::map<IPv4Address, DelayedPacketQueue>::iterator queueIt = targetAddressToDelayedPackets.find(destAddr);
+    if (queueIt != targetAddressToDelayedPackets.end()) {
+        DelayedPacketQueue queue;
+        queue.swap(queueIt->second);
+        targetAddressToDelayedPackets.erase(queueIt);
+        for (DelayedPacketQueue::iterator it = queue.begin(); it != queue.end(); it++)
+            dropDelayedDatagram(*it);
+        emitDelayedPacketStatistics();
+    }
 }
 
 bool AODVRouting::updateValidRouteLifeTime(const IPv4Address& destAddr, simtime_t lifetime)
@@ -32,6 +32,7 @@
 #include "UDPPacket.h"
 #include "AODVControlPackets_m.h"
 #include <map>
+#include <deque>
 
 /*
  * This class implements AODV routing protocol and Netfilter hooks
@@ -43,7 +44,7 @@ class INET_API AODVRouting : public cSimpleModule, public ILifecycle, public INe
   protected:
     /*
      * It implements a unique identifier for an arbitrary RREQ message
-     * in the network. See: rreqsArrivalTime.
+     * in the network. See: recentRREQs.
      */
     class RREQIdentifier
     {
@@ -62,7 +63,9 @@ class INET_API AODVRouting : public cSimpleModule, public ILifecycle, public INe
       public:
         bool operator()(const RREQIdentifier& lhs, const RREQIdentifier& rhs) const
         {
-            return lhs.rreqID < rhs.rreqID;
+            if (lhs.rreqID != rhs.rreqID)
+                return lhs.rreqID < rhs.rreqID;
+            return lhs.originatorAddr < rhs.originatorAddr;
         }
     };
 
@@ -105,12 +108,21 @@ class INET_API AODVRouting : public cSimpleModule, public ILifecycle, public INe
     simtime_t netTraversalTime;
     simtime_t nextHopWait;
     simtime_t pathDiscoveryTime;
+    unsigned int maxDelayedPacketsPerDestination;    // 0 means unlimited
+    int64 maxDelayedBytes;    // 0 means unlimited
+    bool dropHeadWhenDelayQueueFull;    // drop the oldest delayed datagram of the destination instead of the arriving one
 
     // state
     unsigned int rreqId;    // when sending a new RREQ packet, rreqID incremented by one from the last id used by this node
     unsigned int sequenceNum;    // it helps to prevent loops in the routes (RFC 3561 6.1 p11.)
     std::map<IPv4Address, WaitForRREP *> waitForRREPTimers;    // timeout for Route Replies
-    std::map<RREQIdentifier, simtime_t, RREQIdentifierCompare> rreqsArrivalTime;    // maps RREQ id to its arriving time
+    // RREQ duplicate cache: maps RREQ ids to their arrival time. Entries are kept in
+    // two generations of pathDiscoveryTime length each; a generation is discarded
+    // at once when all of its entries have expired.
+    typedef std::map<RREQIdentifier, simtime_t, RREQIdentifierCompare> RREQArrivalTimeMap;
+    RREQArrivalTimeMap recentRREQs;    // RREQs arrived since rreqGenerationStart
+    RREQArrivalTimeMap olderRREQs;    // RREQs arrived in the pathDiscoveryTime before rreqGenerationStart
+    simtime_t rreqGenerationStart;
     IPv4Address failedNextHop;    // next hop to the destination who failed to send us RREP-ACK
     std::map<IPv4Address, simtime_t> blacklist;    // we don't accept RREQs from blacklisted nodes
     unsigned int rerrCount;    // num of originated RERR in the last second
@@ -130,7 +142,15 @@ class INET_API AODVRouting : public cSimpleModule, public ILifecycle, public INe
     bool isOperational;
 
     // internal
-    std::multimap<IPv4Address, IPv4Datagram *> targetAddressToDelayedPackets;    // queue for the datagrams we have no route for
+    typedef std::deque<IPv4Datagram *> DelayedPacketQueue;
+    std::map<IPv4Address, DelayedPacketQueue> targetAddressToDelayedPackets;    // FIFO queues for the datagrams we have no route for
+    unsigned int numDelayedPackets;    // total number of delayed datagrams
+    int64 numDelayedBytes;    // total length of the delayed datagrams
+
+    // signals
+    static simsignal_t delayedPacketsSignal;
+    static simsignal_t delayedBytesSignal;
+    static simsignal_t dropPkFromDelayQueueSignal;
 
   protected:
     void handleMessage(cMessage *msg);
@@ -193,7 +213,15 @@ class INET_API AODVRouting : public cSimpleModule, public ILifecycle, public INe
     virtual Result datagramPostRoutingHook(IPv4Datagram *datagram, const InterfaceEntry *inputInterfaceEntry, const InterfaceEntry *& outputInterfaceEntry, IPv4Address& nextHopAddress) { return ACCEPT; }
     virtual Result datagramLocalInHook(IPv4Datagram *datagram, const InterfaceEntry *inputInterfaceEntry) { return ACCEPT; }
     virtual Result datagramLocalOutHook(IPv4Datagram *datagram, const InterfaceEntry *& outputInterfaceEntry, IPv4Address& nextHopAddress) { Enter_Method("datagramLocalOutHook"); return ensureRouteForDatagram(datagram); }
-    void delayDatagram(IPv4Datagram *datagram);
+    bool isDelayQueueFull(unsigned int queueLength, int64 delayedBytes) const;
+    bool delayDatagram(IPv4Datagram *datagram);
+    void dropDelayedDatagram(IPv4Datagram *datagram);
+    void emitDelayedPacketStatistics();
+
+    /* RREQ duplicate cache */
+    bool hasRecentRREQ(const RREQIdentifier& rreqIdentifier);
+    void rememberRREQ(const RREQIdentifier& rreqIdentifier);
+    void expireRREQs();
 
     /* Helper functions */
     IPv4Address getSelfIPAddress() const;
@@ -49,6 +49,8 @@ GPSR::GPSR()
     networkProtocol = NULL;
     beaconTimer = NULL;
     purgeNeighborsTimer = NULL;
+    isPlanarNeighborsValid = false;
+    planarNeighborsVersion = 0;
 }
 
 GPSR::~GPSR()
@@ -76,6 +78,7 @@ void GPSR::initialize(int stage)
         beaconInterval = par("beaconInterval");
         maxJitter = par("maxJitter");
         neighborValidityInterval = par("neighborValidityInterval");
+        neighborPositionTable.setCellSize(par("positionCellSize"));
         // context
         host = getContainingNode(this);
         nodeStatus = dynamic_cast<NodeStatus *>(host->getSubmodule("status"));
@@ -389,15 +392,22 @@ void GPSR::purgeNeighbors()
 
 std::vector<IPvXAddress> GPSR::getPlanarNeighbors()
 {
-    std::vector<IPvXAddress> planarNeighbors;
-    std::vector<IPvXAddress> neighborAddresses = neighborPositionTable.getAddresses();
     Coord selfPosition = mobility->getCurrentPosition();
+    // the planar graph only changes when a neighbor appears, moves or expires, or when this node moves
+    if (isPlanarNeighborsValid && planarNeighborsVersion == neighborPositionTable.getVersion()
+            && planarNeighborsSelfPosition.x == selfPosition.x && planarNeighborsSelfPosition.y == selfPosition.y
+            && planarNeighborsSelfPosition.z == selfPosition.z)
+        return planarNeighbors;
+    planarNeighbors.clear();
+    std::vector<IPvXAddress> neighborAddresses = neighborPositionTable.getAddresses();
     for (std::vector<IPvXAddress>::iterator it = neighborAddresses.begin(); it != neighborAddresses.end(); it++) {
         const IPvXAddress & neighborAddress = *it;
         Coord neighborPosition = neighborPositionTable.getPosition(neighborAddress);
         if (planarizationMode == GPSR_RNG_PLANARIZATION) {
             double neighborDistance = (neighborPosition - selfPosition).length();
-            for (std::vector<IPvXAddress>::iterator jt = neighborAddresses.begin(); jt != neighborAddresses.end(); jt++) {
+            // a witness must be nearer to this node than the neighbor
+            std::vector<IPvXAddress> witnessAddresses = neighborPositionTable.getAddressesWithinRadius(selfPosition, neighborDistance);
+            for (std::vector<IPvXAddress>::iterator jt = witnessAddresses.begin(); jt != witnessAddresses.end(); jt++) {
                 const IPvXAddress & witnessAddress = *jt;
                 Coord witnessPosition = neighborPositionTable.getPosition(witnessAddress);
                 double witnessDistance = (witnessPosition - selfPosition).length();;
@@ -411,7 +421,8 @@ std::vector<IPvXAddress> GPSR::getPlanarNeighbors()
         else if (planarizationMode == GPSR_GG_PLANARIZATION) {
             Coord middlePosition = (selfPosition + neighborPosition) / 2;
             double neighborDistance = (neighborPosition - middlePosition).length();
-            for (std::vector<IPvXAddress>::iterator jt = neighborAddresses.begin(); jt != neighborAddresses.end(); jt++) {
+            std::vector<IPvXAddress> witnessAddresses = neighborPositionTable.getAddressesWithinRadius(middlePosition, neighborDistance);
+            for (std::vector<IPvXAddress>::iterator jt = witnessAddresses.begin(); jt != witnessAddresses.end(); jt++) {
                 const IPvXAddress & witnessAddress = *jt;
                 Coord witnessPosition = neighborPositionTable.getPosition(witnessAddress);
                 double witnessDistance = (witnessPosition - middlePosition).length();;
@@ -426,6 +437,9 @@ std::vector<IPvXAddress> GPSR::getPlanarNeighbors()
         planarNeighbors.push_back(*it);
         eliminate: ;
     }
+    isPlanarNeighborsValid = true;
+    planarNeighborsVersion = neighborPositionTable.getVersion();
+    planarNeighborsSelfPosition = selfPosition;
     return planarNeighbors;
 }
 
@@ -472,18 +486,12 @@ IPvXAddress GPSR::findGreedyRoutingNextHop(IPv4Datagram * datagram, const IPvXAd
     IPvXAddress selfAddress = getSelfAddress();
     Coord selfPosition = mobility->getCurrentPosition();
     Coord destinationPosition = packet->getDestinationPosition();
-    double bestDistance = (destinationPosition - selfPosition).length();
+    double selfDistance = (destinationPosition - selfPosition).length();
     IPvXAddress bestNeighbor;
-    std::vector<IPvXAddress> neighborAddresses = neighborPositionTable.getAddresses();
-    for (std::vector<IPvXAddress>::iterator it = neighborAddresses.begin(); it != neighborAddresses.end(); it++) {
-        const IPvXAddress & neighborAddress = *it;
-        Coord neighborPosition = neighborPositionTable.getPosition(neighborAddress);
-        double neighborDistance = (destinationPosition - neighborPosition).length();
-        if (neighborDistance < bestDistance) {
-            bestDistance = neighborDistance;
-            bestNeighbor = neighborAddress.get4();
-        }
-    }
+    // the neighbor nearest to the destination, provided that it is nearer than this node
+    std::vector<IPvXAddress> nearestAddresses = neighborPositionTable.getNearestAddresses(destinationPosition, 1, selfDistance);
+    if (!nearestAddresses.empty())
+        bestNeighbor = nearestAddresses[0].get4();
     if (bestNeighbor.isUnspecified()) {
         GPSR_EV << "Switching to perimeter routing: destination = " << destination << endl;
         packet->setRoutingMode(GPSR_PERIMETER_ROUTING);
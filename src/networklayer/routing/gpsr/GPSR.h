@@ -66,6 +66,10 @@ class INET_API GPSR : public cSimpleModule, public ILifecycle, public INotifiabl
         cMessage * beaconTimer;
         cMessage * purgeNeighborsTimer;
         PositionTable neighborPositionTable;
+        bool isPlanarNeighborsValid;
+        unsigned int planarNeighborsVersion;  // version of the neighbor position table
+        Coord planarNeighborsSelfPosition;
+        std::vector<IPvXAddress> planarNeighbors;
 
     public:
         GPSR();
@@ -16,10 +16,19 @@
 // Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 //
 
+#include <algorithm>
+
 #include "PositionTable.h"
 
 static double const NaN = 0.0 / 0.0;
 
+static inline bool isNaN(double d) { return d != d;}
+
+// Coord::operator== only tests whether the coordinates are close
+static inline bool isSamePosition(const Coord & a, const Coord & b) {
+    return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
 std::vector<IPvXAddress> PositionTable::getAddresses() const {
     std::vector<IPvXAddress> addresses;
     for (AddressToPositionMap::const_iterator it = addressToPositionMap.begin(); it != addressToPositionMap.end(); it++)
@@ -42,24 +51,44 @@ Coord PositionTable::getPosition(const IPvXAddress & address) const {
 
 void PositionTable::setPosition(const IPvXAddress & address, const Coord & coord) {
     ASSERT(!address.isUnspecified());
-    addressToPositionMap[address] = AddressToPositionMapValue(simTime(), coord);
+    AddressToPositionMap::iterator it = addressToPositionMap.find(address);
+    if (it == addressToPositionMap.end()) {
+        addressToPositionMap[address] = AddressToPositionMapValue(simTime(), coord);
+        addToCell(address, coord);
+        version++;
+    }
+    else {
+        if (!isSamePosition(it->second.second, coord)) {
+            removeFromCell(address, it->second.second);
+            addToCell(address, coord);
+            version++;
+        }
+        it->second = AddressToPositionMapValue(simTime(), coord);
+    }
 }
 
 void PositionTable::removePosition(const IPvXAddress & address) {
     AddressToPositionMap::iterator it = addressToPositionMap.find(address);
+    removeFromCell(address, it->second.second);
     addressToPositionMap.erase(it);
+    version++;
 }
 
 void PositionTable::removeOldPositions(simtime_t timestamp) {
     for (AddressToPositionMap::iterator it = addressToPositionMap.begin(); it != addressToPositionMap.end();)
-        if (it->second.first <= timestamp)
+        if (it->second.first <= timestamp) {
+            removeFromCell(it->first, it->second.second);
             addressToPositionMap.erase(it++);
+            version++;
+        }
         else
             it++;
 }
 
 void PositionTable::clear() {
     addressToPositionMap.clear();
+    cellToAddressesMap.clear();
+    version++;
 }
 
 simtime_t PositionTable::getOldestPosition() const {
@@ -71,3 +100,171 @@ simtime_t PositionTable::getOldestPosition() const {
     }
     return oldestPosition;
 }
+
+std::vector<IPvXAddress> PositionTable::getAddressesWithinRadius(const Coord & center, double radius) const {
+    std::vector<IPvXAddress> addresses;
+    if (!(radius > 0) || cellToAddressesMap.empty())
+        return addresses;
+    Cell low = getCell(center - Coord(radius, radius, 0));
+    Cell high = getCell(center + Coord(radius, radius, 0));
+    int x0 = std::max(low.first, minCell.first);
+    int x1 = std::min(high.first, maxCell.first);
+    int y0 = std::max(low.second, minCell.second);
+    int y1 = std::min(high.second, maxCell.second);
+    if (x0 > x1 || y0 > y1)
+        return addresses;
+    // look up the cells in range, or go through the used cells if there are fewer of them
+    if ((double)(x1 - x0 + 1) * (y1 - y0 + 1) <= cellToAddressesMap.size()) {
+        for (int x = x0; x <= x1; x++) {
+            for (int y = y0; y <= y1; y++) {
+                CellToAddressesMap::const_iterator it = cellToAddressesMap.find(Cell(x, y));
+                if (it != cellToAddressesMap.end())
+                    collectWithinRadius(it->second, center, radius, addresses);
+            }
+        }
+    }
+    else {
+        for (CellToAddressesMap::const_iterator it = cellToAddressesMap.begin(); it != cellToAddressesMap.end(); it++) {
+            const Cell & cell = it->first;
+            if (x0 <= cell.first && cell.first <= x1 && y0 <= cell.second && cell.second <= y1)
+                collectWithinRadius(it->second, center, radius, addresses);
+        }
+    }
+    std::sort(addresses.begin(), addresses.end());
+    return addresses;
+}
+
+std::vector<IPvXAddress> PositionTable::getNearestAddresses(const Coord & position, int count, double maxDistance) const {
+    std::vector<IPvXAddress> addresses;
+    if (count <= 0 || cellToAddressesMap.empty() || isNaN(position.x) || isNaN(position.y))
+        return addresses;
+    std::vector<std::pair<double, IPvXAddress> > candidates;
+    double boxCellCount = (double)(maxCell.first - minCell.first + 1) * (maxCell.second - minCell.second + 1);
+    if (boxCellCount > 4.0 * cellToAddressesMap.size()) {
+        // sparsely used cells: it is cheaper to go through all positions
+        for (AddressToPositionMap::const_iterator it = addressToPositionMap.begin(); it != addressToPositionMap.end(); it++) {
+            double distance = (it->second.second - position).length();
+            if (distance < maxDistance)
+                candidates.push_back(std::make_pair(distance, it->first));
+        }
+    }
+    else {
+        // visit the rings of cells around the cell of the position, from the first
+        // one that overlaps the bounding box of the used cells to the last one
+        Cell center = getCell(position);
+        int firstRing = std::max(std::max(minCell.first - center.first, center.first - maxCell.first),
+                                 std::max(minCell.second - center.second, center.second - maxCell.second));
+        int lastRing = std::max(std::max(center.first - minCell.first, maxCell.first - center.first),
+                                std::max(center.second - minCell.second, maxCell.second - center.second));
+        for (int ring = std::max(firstRing, 0); ring <= lastRing; ring++) {
+            collectRing(position, center, ring, maxDistance, candidates);
+            // positions in the next rings are farther than this
+            double ringDistance = ring * cellSize;
+            if (maxDistance <= ringDistance)
+                break;
+            if ((int)candidates.size() >= count) {
+                std::nth_element(candidates.begin(), candidates.begin() + count - 1, candidates.end());
+                if (candidates[count - 1].first <= ringDistance)
+                    break;
+            }
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+    for (int i = 0; i < (int)candidates.size() && i < count; i++)
+        addresses.push_back(candidates[i].second);
+    return addresses;
+}
+
+void PositionTable::setCellSize(double cellSize) {
+    if (!(cellSize > 0))
+        throw cRuntimeError("PositionTable: cell size must be positive");
+    this->cellSize = cellSize;
+    cellToAddressesMap.clear();
+    for (AddressToPositionMap::const_iterator it = addressToPositionMap.begin(); it != addressToPositionMap.end(); it++)
+        addToCell(it->first, it->second.second);
+}
+
+PositionTable::Cell PositionTable::getCell(const Coord & coord) const {
+    // far away (and unknown) positions share the cells at the border
+    double x = floor(coord.x / cellSize);
+    double y = floor(coord.y / cellSize);
+    x = isNaN(x) ? 0 : std::min(std::max(x, -1E9), 1E9);
+    y = isNaN(y) ? 0 : std::min(std::max(y, -1E9), 1E9);
+    return Cell((int)x, (int)y);
+}
+
+void PositionTable::addToCell(const IPvXAddress & address, const Coord & coord) {
+    Cell cell = getCell(coord);
+    if (cellToAddressesMap.empty())
+        minCell = maxCell = cell;
+    else {
+        minCell = Cell(std::min(minCell.first, cell.first), std::min(minCell.second, cell.second));
+        maxCell = Cell(std::max(maxCell.first, cell.first), std::max(maxCell.second, cell.second));
+    }
+    cellToAddressesMap[cell].push_back(address);
+}
+
+void PositionTable::removeFromCell(const IPvXAddress & address, const Coord & coord) {
+    CellToAddressesMap::iterator it = cellToAddressesMap.find(getCell(coord));
+    std::vector<IPvXAddress> & addresses = it->second;
+    addresses.erase(std::find(addresses.begin(), addresses.end(), address));
+    if (addresses.empty()) {
+        Cell cell = it->first;
+        cellToAddressesMap.erase(it);
+        // shrink the bounding box if the cell was on its border
+        if (cell.first == minCell.first || cell.first == maxCell.first || cell.second == minCell.second || cell.second == maxCell.second)
+            updateCellBounds();
+    }
+}
+
+void PositionTable::updateCellBounds() {
+    if (cellToAddressesMap.empty())
+        return;
+    // the cells are ordered by x, then by y
+    minCell.first = cellToAddressesMap.begin()->first.first;
+    maxCell.first = cellToAddressesMap.rbegin()->first.first;
+    minCell.second = maxCell.second = cellToAddressesMap.begin()->first.second;
+    for (CellToAddressesMap::const_iterator it = cellToAddressesMap.begin(); it != cellToAddressesMap.end(); it++) {
+        minCell.second = std::min(minCell.second, it->first.second);
+        maxCell.second = std::max(maxCell.second, it->first.second);
+    }
+}
+
+void PositionTable::collectWithinRadius(const std::vector<IPvXAddress> & cellAddresses, const Coord & center, double radius, std::vector<IPvXAddress> & addresses) const {
+    for (std::vector<IPvXAddress>::const_iterator it = cellAddresses.begin(); it != cellAddresses.end(); it++)
+        if ((getPosition(*it) - center).length() < radius)
+            addresses.push_back(*it);
+}
+
+void PositionTable::collectRing(const Coord & position, const Cell & center, int ring, double maxDistance, std::vector<std::pair<double, IPvXAddress> > & candidates) const {
+    int x0 = std::max(center.first - ring, minCell.first);
+    int x1 = std::min(center.first + ring, maxCell.first);
+    int y0 = std::max(center.second - ring, minCell.second);
+    int y1 = std::min(center.second + ring, maxCell.second);
+    int bottom = center.second - ring;
+    int top = center.second + ring;
+    for (int x = x0; x <= x1; x++) {
+        if (x == center.first - ring || x == center.first + ring) {
+            for (int y = y0; y <= y1; y++)
+                collectCell(Cell(x, y), position, maxDistance, candidates);
+        }
+        else {
+            // only the bottom and top cells of the inner columns belong to the ring
+            if (y0 <= bottom && bottom <= y1)
+                collectCell(Cell(x, bottom), position, maxDistance, candidates);
+            if (y0 <= top && top <= y1)
+                collectCell(Cell(x, top), position, maxDistance, candidates);
+        }
+    }
+}
+
+void PositionTable::collectCell(const Cell & cell, const Coord & position, double maxDistance, std::vector<std::pair<double, IPvXAddress> > & candidates) const {
+    CellToAddressesMap::const_iterator it = cellToAddressesMap.find(cell);
+    if (it == cellToAddressesMap.end())
+        return;
+    for (std::vector<IPvXAddress>::const_iterator jt = it->second.begin(); jt != it->second.end(); jt++) {
+        double distance = (getPosition(*jt) - position).length();
+        if (distance < maxDistance)
+            candidates.push_back(std::make_pair(distance, *jt));
+    }
+}
@@ -21,21 +21,32 @@
 
 #include <vector>
 #include <map>
+#include <float.h>
 #include "INETDefs.h"
 #include "IPvXAddress.h"
 #include "Coord.h"
 
 /**
  * This class provides a mapping between node addresses and their positions.
+ *
+ * Positions are also indexed by a uniform grid on the x-y plane, so that the
+ * nodes near a position can be found without looking at all of them.
  */
 class INET_API PositionTable {
     private:
         typedef std::pair<simtime_t, Coord> AddressToPositionMapValue;
         typedef std::map<IPvXAddress, AddressToPositionMapValue> AddressToPositionMap;
+        typedef std::pair<int, int> Cell;
+        typedef std::map<Cell, std::vector<IPvXAddress> > CellToAddressesMap;
         AddressToPositionMap addressToPositionMap;
+        CellToAddressesMap cellToAddressesMap;
+        double cellSize;
+        Cell minCell;    // bounding box of the used cells
+        Cell maxCell;
+        unsigned int version;
 
     public:
-        PositionTable() { }
+        explicit PositionTable(double cellSize = 100) : cellSize(cellSize), version(0) { }
 
         std::vector<IPvXAddress> getAddresses() const;
 
@@ -49,6 +60,38 @@ class INET_API PositionTable {
         void clear();
 
         simtime_t getOldestPosition() const;
+
+        /**
+         * Returns the addresses whose position is closer to center than radius,
+         * in address order.
+         */
+        std::vector<IPvXAddress> getAddressesWithinRadius(const Coord & center, double radius) const;
+
+        /**
+         * Returns the addresses of at most count positions nearest to position
+         * which are closer than maxDistance, in the order of increasing distance.
+         * Addresses with equal distance are in address order.
+         */
+        std::vector<IPvXAddress> getNearestAddresses(const Coord & position, int count, double maxDistance = DBL_MAX) const;
+
+        /**
+         * Changes the cell size of the spatial index, the default is 100 meters.
+         */
+        void setCellSize(double cellSize);
+
+        /**
+         * Returns a number that changes whenever a position is added, removed or moved.
+         */
+        unsigned int getVersion() const { return version; }
+
+    private:
+        Cell getCell(const Coord & coord) const;
+        void addToCell(const IPvXAddress & address, const Coord & coord);
+        void removeFromCell(const IPvXAddress & address, const Coord & coord);
+        void updateCellBounds();
+        void collectWithinRadius(const std::vector<IPvXAddress> & cellAddresses, const Coord & center, double radius, std::vector<IPvXAddress> & addresses) const;
+        void collectRing(const Coord & position, const Cell & center, int ring, double maxDistance, std::vector<std::pair<double, IPvXAddress> > & candidates) const;
+        void collectCell(const Cell & cell, const Coord & position, double maxDistance, std::vector<std::pair<double, IPvXAddress> > & candidates) const;
 };
 
 #endif
@@ -13,6 +13,9 @@
 //
 
 #include <algorithm>
+#include <functional>
+#include <map>
+#include <queue>
 
 #include "INETDefs.h"
 
@@ -29,6 +32,9 @@
 
 #define LS_INFINITY   1e16
 
+// number of shortest path trees (bandwidth/priority pairs) kept for reuse
+#define CSPF_MAX_TREES   16
+
 Define_Module(TED);
 
 TED::TED()
@@ -182,24 +188,6 @@ std::ostream & operator<<(std::ostream & os, const TELinkStateInfo& info)
     return os;
 }
 
-// FIXME should this be called findOrCreateVertex() or something like that?
-int TED::assignIndex(std::vector<vertex_t>& vertices, IPv4Address nodeAddr)
-{
-    // find node in vertices[] whose IPv4 address is nodeAddr
-    for (unsigned int i = 0; i < vertices.size(); i++)
-        if (vertices[i].node == nodeAddr)
-            return i;
-
-    // if not found, create
-    vertex_t newVertex;
-    newVertex.node = nodeAddr;
-    newVertex.dist = LS_INFINITY;
-    newVertex.parent = -1;
-
-    vertices.push_back(newVertex);
-    return vertices.size() - 1;
-}
-
 IPAddressVector TED::calculateShortestPath(IPAddressVector dest,
             const TELinkStateInfoVector& topology, double req_bandwidth, int priority)
 {
@@ -360,62 +348,161 @@ bool TED::isLocalPeer(IPv4Address inetAddr)
     return it != ted.end();
 }
 
-std::vector<TED::vertex_t> TED::calculateShortestPaths(const TELinkStateInfoVector& topology,
+bool TED::canReuseShortestPaths(cspf_tree_t& tree, const TELinkStateInfoVector& topology,
             double req_bandwidth, int priority)
 {
-    std::vector<vertex_t> vertices;
-    std::vector<edge_t> edges;
+    if (tree.links.size() != topology.size())
+        return false;
 
-    // select edges that have enough bandwidth left, and store them into edges[].
-    // meanwhile, collect vertices in vectices[].
     for (unsigned int i = 0; i < topology.size(); i++)
     {
-        if (!topology[i].state)
-            continue;
+        const cspf_link_t& link = tree.links[i];
+        if (link.advrouter != topology[i].advrouter || link.linkid != topology[i].linkid ||
+            link.metric != topology[i].metric || link.state != topology[i].state)
+            return false;
+    }
 
-        if (topology[i].UnResvBandwidth[priority] < req_bandwidth)
+    // the links and metrics are the same, only the unreserved bandwidths may
+    // have changed; check if that made a difference for the tree
+    for (unsigned int i = 0; i < topology.size(); i++)
+    {
+        const cspf_link_t& link = tree.links[i];
+        bool feasible = link.state && topology[i].UnResvBandwidth[priority] >= req_bandwidth;
+        if (feasible == link.feasible)
             continue;
 
-        edge_t edge;
-        edge.src = assignIndex(vertices, topology[i].advrouter);
-        edge.dest = assignIndex(vertices, topology[i].linkid);
-        edge.metric = topology[i].metric;
-        edges.push_back(edge);
+        if (!feasible)
+        {
+            // pruning a link that is not in the tree keeps the tree
+            if (tree.parentLinks[link.dest] == (int)i)
+                return false;
+        }
+        else
+        {
+            // a new link that doesn't lead to a shorter (or equally short) path keeps the tree
+            if (tree.vertices[link.src].dist + link.metric <= tree.vertices[link.dest].dist)
+                return false;
+        }
     }
 
-    IPv4Address srcAddr = routerId;
+    for (unsigned int i = 0; i < topology.size(); i++)
+        tree.links[i].feasible = tree.links[i].state && topology[i].UnResvBandwidth[priority] >= req_bandwidth;
+    return true;
+}
 
-    int srcIndex = assignIndex(vertices, srcAddr);
-    vertices[srcIndex].dist = 0.0;
+std::vector<TED::vertex_t> TED::calculateShortestPaths(const TELinkStateInfoVector& topology,
+            double req_bandwidth, int priority)
+{
+    if (cspfRoot != routerId)
+    {
+        cspfTrees.clear();
+        cspfRoot = routerId;
+    }
 
-    // FIXME comment: Dijkstra? just guessing...
-    for (unsigned int i = 1; i < vertices.size(); i++)
+    CSPFTrees::iterator treeIt = cspfTrees.find(std::make_pair(req_bandwidth, priority));
+    if (treeIt != cspfTrees.end() && canReuseShortestPaths(treeIt->second, topology, req_bandwidth, priority))
+        return treeIt->second.vertices;
+
+    std::vector<vertex_t> vertices;
+    std::map<IPv4Address, int> vertexIndices;
+    std::vector<cspf_link_t> links(topology.size());
+    std::vector<std::vector<int> > outLinks;
+
+    // collect vertices from all links, so that pruning a link doesn't renumber them,
+    // and build the adjacency lists from the links that are up and have enough bandwidth left
+    for (unsigned int i = 0; i <= topology.size(); i++)
     {
-        bool mod = false;
+        IPv4Address nodeAddrs[2];
+        int numNodeAddrs = 0;
+        if (i < topology.size())
+        {
+            nodeAddrs[numNodeAddrs++] = topology[i].advrouter;
+            nodeAddrs[numNodeAddrs++] = topology[i].linkid;
+        }
+        else
+            nodeAddrs[numNodeAddrs++] = routerId;
+
+        int indices[2];
+        for (int j = 0; j < numNodeAddrs; j++)
+        {
+            std::map<IPv4Address, int>::iterator it = vertexIndices.find(nodeAddrs[j]);
+            if (it != vertexIndices.end())
+                indices[j] = it->second;
+            else
+            {
+                vertex_t newVertex;
+                newVertex.node = nodeAddrs[j];
+                newVertex.dist = LS_INFINITY;
+                newVertex.parent = -1;
+                indices[j] = vertices.size();
+                vertexIndices[nodeAddrs[j]] = indices[j];
+                vertices.push_back(newVertex);
+                outLinks.push_back(std::vector<int>());
+            }
+        }
 
-        for (unsigned int j = 0; j < edges.size(); j++)
+        if (i < topology.size())
         {
-            int src = edges[j].src;
-            int dest = edges[j].dest;
+            cspf_link_t& link = links[i];
+            link.advrouter = topology[i].advrouter;
+            link.linkid = topology[i].linkid;
+            link.metric = topology[i].metric;
+            link.state = topology[i].state;
+            link.feasible = link.state && topology[i].UnResvBandwidth[priority] >= req_bandwidth;
+            link.src = indices[0];
+            link.dest = indices[1];
+            if (link.feasible)
+            {
+                ASSERT(link.src != link.dest);
+                outLinks[link.src].push_back(i);
+            }
+        }
+    }
+
+    // Dijkstra; vertices with equal distance are visited in index order
+    std::vector<int> parentLinks(vertices.size(), -1);
+    std::vector<bool> done(vertices.size(), false);
+    typedef std::pair<double, int> QueueEntry;
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry> > queue;
+
+    int srcIndex = vertexIndices[routerId];
+    vertices[srcIndex].dist = 0.0;
+    queue.push(QueueEntry(0.0, srcIndex));
 
-            ASSERT(src >= 0);
-            ASSERT(dest >= 0);
-            ASSERT(src < (int)vertices.size());
-            ASSERT(dest < (int)vertices.size());
-            ASSERT(src != dest);
+    while (!queue.empty())
+    {
+        int src = queue.top().second;
+        queue.pop();
+        if (done[src])
+            continue;   // stale entry
+        done[src] = true;
+
+        for (unsigned int j = 0; j < outLinks[src].size(); j++)
+        {
+            const cspf_link_t& link = links[outLinks[src][j]];
+            int dest = link.dest;
 
-            if (vertices[src].dist + edges[j].metric >= vertices[dest].dist)
+            if (vertices[src].dist + link.metric >= vertices[dest].dist)
                 continue;
 
-            vertices[dest].dist = vertices[src].dist + edges[j].metric;
+            vertices[dest].dist = vertices[src].dist + link.metric;
             vertices[dest].parent = src;
-
-            mod = true;
+            parentLinks[dest] = outLinks[src][j];
+            queue.push(QueueEntry(vertices[dest].dist, dest));
         }
+    }
 
-        if (!mod)
-            break;
+    if (treeIt == cspfTrees.end())
+    {
+        // requests may come with many different bandwidths, so start over when the cache is full
+        if (cspfTrees.size() >= CSPF_MAX_TREES)
+            cspfTrees.clear();
+        treeIt = cspfTrees.insert(std::make_pair(std::make_pair(req_bandwidth, priority), cspf_tree_t())).first;
     }
+    cspf_tree_t& tree = treeIt->second;
+    tree.links.swap(links);
+    tree.parentLinks.swap(parentLinks);
+    tree.vertices = vertices;
 
     return vertices;
 }
@@ -15,6 +15,8 @@
 #ifndef __INET_TED_H
 #define __INET_TED_H
 
+#include <map>
+
 #include "INETDefs.h"
 
 #include "TED_m.h"
@@ -48,14 +50,31 @@ class TED : public cSimpleModule, public ILifecycle
     };
 
     /**
-     * Only used internally, during shortest path calculation:
-     * edge in the graph we build from links in TELinkStateInfoVector.
+     * Only used internally, during shortest path calculation: the part of a
+     * TELinkStateInfo the shortest path tree depends on, as it was seen by
+     * the previous calculation.
+     */
+    struct cspf_link_t
+    {
+        IPv4Address advrouter;
+        IPv4Address linkid;
+        double metric;
+        bool state;
+        bool feasible;  // state is up and there is enough unreserved bandwidth
+        int src;        // index into the vertex_t[] vector
+        int dest;       // index into the vertex_t[] vector
+    };
+
+    /**
+     * Only used internally, during shortest path calculation: a shortest
+     * path tree for a given bandwidth and priority, and the links it was
+     * calculated from.
      */
-    struct edge_t
+    struct cspf_tree_t
     {
-        int src;       // index into the vertex_t[] vector
-        int dest;      // index into the vertex_t[] vector
-        double metric; // link cost
+        std::vector<cspf_link_t> links;
+        std::vector<vertex_t> vertices;
+        std::vector<int> parentLinks;   // index of the link towards the parent of each vertex, or -1
     };
 
     /**
@@ -106,10 +125,27 @@ class TED : public cSimpleModule, public ILifecycle
   protected:
     int maxMessageId;
 
-    virtual int assignIndex(std::vector<vertex_t>& vertices, IPv4Address nodeAddr);
+    // results of the previous shortest path calculations from cspfRoot, keyed
+    // by the requested bandwidth and priority, see calculateShortestPaths()
+    typedef std::map<std::pair<double, int>, cspf_tree_t> CSPFTrees;
+    IPv4Address cspfRoot;
+    CSPFTrees cspfTrees;
 
+    /**
+     * Constrained shortest path first: Dijkstra's algorithm from routerId
+     * over the links that are up and have at least req_bandwidth unreserved
+     * bandwidth at the given priority. The returned vector contains all
+     * routers mentioned in the topology; unreachable ones have no parent.
+     *
+     * The previous tree for the same bandwidth and priority is reused without
+     * running the algorithm if only the unreserved bandwidths changed since
+     * then, and the links that became feasible or infeasible due to that
+     * don't affect the tree.
+     */
     std::vector<vertex_t> calculateShortestPaths(const TELinkStateInfoVector& topology,
         double req_bandwidth, int priority);
+    virtual bool canReuseShortestPaths(cspf_tree_t& tree, const TELinkStateInfoVector& topology,
+        double req_bandwidth, int priority);
 
   public: //FIXME
     virtual bool checkLinkValidity(TELinkStateInfo link, TELinkStateInfo *&match);
@@ -15,6 +15,7 @@
 // along with this program; if not, see <http://www.gnu.org/licenses/>.
 //
 
+#include <algorithm>
 
 #include "TCP.h"
 
@@ -27,6 +28,8 @@
 #include "NodeStatus.h"
 #include "TCPConnection.h"
 #include "TCPSegment.h"
+#include "TCPSegmentOffload.h"
+#include "TCPTimerWheel.h"
 #include "TCPCommand_m.h"
 
 #ifdef WITH_IPv4
@@ -54,6 +57,8 @@ bool TCP::logverbose;
 #define EPHEMERAL_PORTRANGE_START 1024
 #define EPHEMERAL_PORTRANGE_END   5000
 
+#define CONN_HASHTABLE_INITIAL_SIZE 64
+
 static std::ostream& operator<<(std::ostream& os, const TCP::SockPair& sp)
 {
     os << "loc=" << IPvXAddress(sp.localAddr) << ":" << sp.localPort << " "
@@ -91,8 +96,22 @@ void TCP::initialize(int stage)
             error("Don't use obsolete receiveQueueClass = \"%s\" parameter", q);
 
         lastEphemeralPort = EPHEMERAL_PORTRANGE_START;
+        ephemeralPortUseCounts.assign(EPHEMERAL_PORTRANGE_END - EPHEMERAL_PORTRANGE_START, 0);
         WATCH(lastEphemeralPort);
 
+        connHashTable.assign(CONN_HASHTABLE_INITIAL_SIZE, ConnBucket());
+        numHashedConns = 0;
+
+        if (par("offloadSegments").longValue() < 1)
+            error("Invalid offloadSegments parameter: %ld", par("offloadSegments").longValue());
+        TCPSegmentOffload::clearUsed();
+
+        if (par("useTimerWheel").boolValue())
+        {
+            timerWheel = new TCPTimerWheel(par("timerWheelGranularity").doubleValue());
+            timerWheelEvent = new cMessage("timerWheel");
+        }
+
         WATCH_PTRMAP(tcpConnMap);
         WATCH_PTRMAP(tcpAppConnMap);
 
@@ -104,6 +123,10 @@ void TCP::initialize(int stage)
     }
     else if (stage == 1)
     {
+        // after all TCP modules have cleared the flag in stage 0
+        if (par("offloadSegments").longValue() > 1)
+            TCPSegmentOffload::setUsed();
+
         NodeStatus *nodeStatus = dynamic_cast<NodeStatus *>(findContainingNode(this)->getSubmodule("status"));
         isOperational = (!nodeStatus) || nodeStatus->getState() == NodeStatus::UP;
         IPSocket ipSocket(gate("ipOut"));
@@ -115,6 +138,11 @@ void TCP::initialize(int stage)
 
 TCP::~TCP()
 {
+    // detach the timers from the wheel, connections delete them below
+    delete timerWheel;
+    timerWheel = NULL;
+    cancelAndDelete(timerWheelEvent);
+
     while (!tcpAppConnMap.empty())
     {
         TcpAppConnMap::iterator i = tcpAppConnMap.begin();
@@ -132,6 +160,10 @@ void TCP::handleMessage(cMessage *msg)
         EV << "TCP is turned off, dropping '" << msg->getName() << "' message\n";
         delete msg;
     }
+    else if (msg == timerWheelEvent)
+    {
+        processTimerWheelEvent();
+    }
     else if (msg->isSelfMessage())
     {
         TCPConnection *conn = (TCPConnection *) msg->getContextPointer();
@@ -302,42 +334,44 @@ void TCP::updateDisplayString()
 
 TCPConnection *TCP::findConnForSegment(TCPSegment *tcpseg, IPvXAddress srcAddr, IPvXAddress destAddr)
 {
-    SockPair key;
-    key.localAddr = destAddr;
-    key.remoteAddr = srcAddr;
-    key.localPort = tcpseg->getDestPort();
-    key.remotePort = tcpseg->getSrcPort();
-    SockPair save = key;
-
-    // try with fully qualified SockPair
-    TcpConnMap::iterator i;
-    i = tcpConnMap.find(key);
-
-    if (i != tcpConnMap.end())
-        return i->second;
-
-    // try with localAddr missing (only localPort specified in passive/active open)
-    key.localAddr = IPvXAddress();
-    i = tcpConnMap.find(key);
-
-    if (i != tcpConnMap.end())
-        return i->second;
-
-    // try fully qualified local socket + blank remote socket (for incoming SYN)
-    key = save;
-    key.remoteAddr = IPvXAddress();
-    key.remotePort = -1;
-    i = tcpConnMap.find(key);
-
-    if (i != tcpConnMap.end())
-        return i->second;
-
-    // try with blank remote socket, and localAddr missing (for incoming SYN)
-    key.localAddr = IPvXAddress();
-    i = tcpConnMap.find(key);
+    int localPort = tcpseg->getDestPort();
+    int remotePort = tcpseg->getSrcPort();
+
+    // try with fully qualified socket pair, then with localAddr missing (only
+    // localPort specified in passive/active open); both live in the same bucket
+    const ConnBucket& bucket = connHashTable[hashSockPair(srcAddr, remotePort, localPort) & (connHashTable.size() - 1)];
+    TCPConnection *blankLocalAddrConn = NULL;
+    for (ConnBucket::const_iterator it = bucket.begin(); it != bucket.end(); ++it)
+    {
+        TCPConnection *conn = *it;
+        if (conn->localPort == localPort && conn->remotePort == remotePort && conn->remoteAddr == srcAddr)
+        {
+            if (conn->localAddr == destAddr)
+                return conn;
+            if (conn->localAddr.isUnspecified())
+                blankLocalAddrConn = conn;
+        }
+    }
+    if (blankLocalAddrConn)
+        return blankLocalAddrConn;
 
-    if (i != tcpConnMap.end())
-        return i->second;
+    // try fully qualified local socket + blank remote socket, then blank remote
+    // socket with localAddr missing (for incoming SYN)
+    ListenerMap::const_iterator it = listenerMap.find(localPort);
+    if (it != listenerMap.end())
+    {
+        const std::vector<TCPConnection*>& listeners = it->second;
+        TCPConnection *blankLocalAddrListener = NULL;
+        for (unsigned int i = 0; i < listeners.size(); i++)
+        {
+            if (listeners[i]->localAddr == destAddr)
+                return listeners[i];
+            if (listeners[i]->localAddr.isUnspecified())
+                blankLocalAddrListener = listeners[i];
+        }
+        if (blankLocalAddrListener)
+            return blankLocalAddrListener;
+    }
 
     // given up
     return NULL;
@@ -360,7 +394,7 @@ ushort TCP::getEphemeralPort()
     if (lastEphemeralPort == EPHEMERAL_PORTRANGE_END) // wrap
         lastEphemeralPort = EPHEMERAL_PORTRANGE_START;
 
-    while (usedEphemeralPorts.find(lastEphemeralPort) != usedEphemeralPorts.end())
+    while (ephemeralPortUseCounts[lastEphemeralPort - EPHEMERAL_PORTRANGE_START] != 0)
     {
         if (lastEphemeralPort == searchUntil) // got back to starting point?
             error("Ephemeral port range %d..%d exhausted, all ports occupied", EPHEMERAL_PORTRANGE_START, EPHEMERAL_PORTRANGE_END);
@@ -399,10 +433,11 @@ void TCP::addSockPair(TCPConnection *conn, IPvXAddress localAddr, IPvXAddress re
 
     // then insert it into tcpConnMap
     tcpConnMap[key] = conn;
+    addToConnIndex(conn);
 
     // mark port as used
     if (localPort >= EPHEMERAL_PORTRANGE_START && localPort < EPHEMERAL_PORTRANGE_END)
-        usedEphemeralPorts.insert(localPort);
+        ephemeralPortUseCounts[localPort - EPHEMERAL_PORTRANGE_START]++;
 }
 
 void TCP::updateSockPair(TCPConnection *conn, IPvXAddress localAddr, IPvXAddress remoteAddr, int localPort, int remotePort)
@@ -419,6 +454,7 @@ void TCP::updateSockPair(TCPConnection *conn, IPvXAddress localAddr, IPvXAddress
 
     // ...and remove from the old place in tcpConnMap
     tcpConnMap.erase(it);
+    removeFromConnIndex(conn);
 
     // then update addresses/ports, and re-insert it with new key into tcpConnMap
     key.localAddr = conn->localAddr = localAddr;
@@ -426,8 +462,9 @@ void TCP::updateSockPair(TCPConnection *conn, IPvXAddress localAddr, IPvXAddress
     ASSERT(conn->localPort == localPort);
     key.remotePort = conn->remotePort = remotePort;
     tcpConnMap[key] = conn;
+    addToConnIndex(conn);
 
-    // localPort doesn't change (see ASSERT above), so there's no need to update usedEphemeralPorts[].
+    // localPort doesn't change (see ASSERT above), so there's no need to update ephemeralPortUseCounts[].
 }
 
 void TCP::addForkedConnection(TCPConnection *conn, TCPConnection *newConn, IPvXAddress localAddr, IPvXAddress remoteAddr, int localPort, int remotePort)
@@ -465,17 +502,151 @@ void TCP::removeConnection(TCPConnection *conn)
     key2.localPort = conn->localPort;
     key2.remotePort = conn->remotePort;
     tcpConnMap.erase(key2);
+    removeFromConnIndex(conn);
 
-    // IMPORTANT: usedEphemeralPorts.erase(conn->localPort) is NOT GOOD because it
-    // deletes ALL occurrences of the port from the multiset.
-    std::multiset<ushort>::iterator it = usedEphemeralPorts.find(conn->localPort);
-
-    if (it != usedEphemeralPorts.end())
-        usedEphemeralPorts.erase(it);
+    // the port may still be used by other connections (e.g. forked from the same listener)
+    int localPort = conn->localPort;
+    if (localPort >= EPHEMERAL_PORTRANGE_START && localPort < EPHEMERAL_PORTRANGE_END)
+    {
+        int& useCount = ephemeralPortUseCounts[localPort - EPHEMERAL_PORTRANGE_START];
+        if (useCount > 0)
+            useCount--;
+    }
 
     delete conn;
 }
 
+unsigned int TCP::hashSockPair(const IPvXAddress& remoteAddr, int remotePort, int localPort)
+{
+    // FNV-1a over the address words and the ports
+    const uint32 *words = remoteAddr.words();
+    uint32 hash = 2166136261u;
+    for (int i = 0; i < remoteAddr.wordCount(); i++)
+        hash = (hash ^ words[i]) * 16777619u;
+    hash = (hash ^ (uint32)remotePort) * 16777619u;
+    hash = (hash ^ (uint32)localPort) * 16777619u;
+    return hash ^ (hash >> 16);
+}
+
+void TCP::addToConnIndex(TCPConnection *conn)
+{
+    if (conn->remoteAddr.isUnspecified() && conn->remotePort == -1)
+        listenerMap[conn->localPort].push_back(conn);
+    else
+    {
+        if (numHashedConns >= (int)connHashTable.size())
+            resizeConnHashTable(2 * connHashTable.size());
+        connHashTable[hashSockPair(conn->remoteAddr, conn->remotePort, conn->localPort) & (connHashTable.size() - 1)].push_back(conn);
+        numHashedConns++;
+    }
+}
+
+void TCP::removeFromConnIndex(TCPConnection *conn)
+{
+    if (conn->remoteAddr.isUnspecified() && conn->remotePort == -1)
+    {
+        ListenerMap::iterator it = listenerMap.find(conn->localPort);
+        if (it == listenerMap.end())
+            return;
+        std::vector<TCPConnection*>& listeners = it->second;
+        std::vector<TCPConnection*>::iterator pos = std::find(listeners.begin(), listeners.end(), conn);
+        if (pos != listeners.end())
+            listeners.erase(pos);
+        if (listeners.empty())
+            listenerMap.erase(it);
+    }
+    else
+    {
+        ConnBucket& bucket = connHashTable[hashSockPair(conn->remoteAddr, conn->remotePort, conn->localPort) & (connHashTable.size() - 1)];
+        ConnBucket::iterator pos = std::find(bucket.begin(), bucket.end(), conn);
+        if (pos != bucket.end())
+        {
+            // order within a bucket doesn't matter
+            *pos = bucket.back();
+            bucket.pop_back();
+            numHashedConns--;
+        }
+    }
+}
+
+void TCP::resizeConnHashTable(int numBuckets)
+{
+    std::vector<ConnBucket> oldTable(numBuckets);
+    oldTable.swap(connHashTable);
+    for (unsigned int i = 0; i < oldTable.size(); i++)
+        for (ConnBucket::iterator it = oldTable[i].begin(); it != oldTable[i].end(); ++it)
+            connHashTable[hashSockPair((*it)->remoteAddr, (*it)->remotePort, (*it)->localPort) & (numBuckets - 1)].push_back(*it);
+}
+
+void TCP::scheduleTimer(cMessage *timer, simtime_t time)
+{
+    TCPTimer *wheelTimer = timerWheel ? dynamic_cast<TCPTimer *>(timer) : NULL;
+
+    if (!wheelTimer)
+        scheduleAt(time, timer);
+    else
+    {
+        if (time < simTime())
+            error("scheduleTimer(): timer (%s)%s cannot be scheduled to the past", timer->getClassName(), timer->getName());
+
+        timerWheel->insert(wheelTimer, time);
+
+        if (!timerWheelEvent->isScheduled() || time < timerWheelEvent->getArrivalTime())
+        {
+            cancelEvent(timerWheelEvent);
+            scheduleAt(time, timerWheelEvent);
+        }
+    }
+}
+
+cMessage *TCP::cancelTimer(cMessage *timer)
+{
+    TCPTimer *wheelTimer = timerWheel ? dynamic_cast<TCPTimer *>(timer) : NULL;
+
+    if (!wheelTimer || !wheelTimer->isOnWheel())
+        return cancelEvent(timer);
+
+    timerWheel->remove(wheelTimer);
+
+    // timerWheelEvent may have been scheduled for this timer
+    if (wheelTimer->getExpiry() == timerWheelEvent->getArrivalTime())
+        updateTimerWheelEvent();
+
+    return timer;
+}
+
+bool TCP::isTimerScheduled(cMessage *timer) const
+{
+    TCPTimer *wheelTimer = timerWheel ? dynamic_cast<TCPTimer *>(timer) : NULL;
+    return timer->isScheduled() || (wheelTimer && wheelTimer->isOnWheel());
+}
+
+void TCP::updateTimerWheelEvent()
+{
+    TCPTimer *first = timerWheel->getFirst();
+
+    if (!first)
+        cancelEvent(timerWheelEvent);
+    else if (!timerWheelEvent->isScheduled() || timerWheelEvent->getArrivalTime() != first->getExpiry())
+    {
+        cancelEvent(timerWheelEvent);
+        scheduleAt(first->getExpiry(), timerWheelEvent);
+    }
+}
+
+void TCP::processTimerWheelEvent()
+{
+    // one timer per event, like when the timers are scheduled individually
+    TCPTimer *timer = timerWheel->removeFirst();
+    ASSERT(timer && timer->getExpiry() == simTime());
+    updateTimerWheelEvent();
+
+    TCPConnection *conn = (TCPConnection *) timer->getContextPointer();
+    bool ret = conn->processTimer(timer);
+    if (!ret)
+        removeConnection(conn);
+}
+
 void TCP::finish()
 {
     tcpEV << getFullPath() << ": finishing with " << tcpConnMap.size() << " connections open.\n";
@@ -547,7 +718,10 @@ void TCP::reset()
         delete it->second;
     tcpAppConnMap.clear();
     tcpConnMap.clear();
-    usedEphemeralPorts.clear();
+    connHashTable.assign(CONN_HASHTABLE_INITIAL_SIZE, ConnBucket());
+    numHashedConns = 0;
+    listenerMap.clear();
+    ephemeralPortUseCounts.assign(EPHEMERAL_PORTRANGE_END - EPHEMERAL_PORTRANGE_START, 0);
     lastEphemeralPort = EPHEMERAL_PORTRANGE_START;
 }
 
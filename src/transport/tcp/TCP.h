@@ -20,7 +20,7 @@
 #define __INET_TCPMAIN_H
 
 #include <map>
-#include <set>
+#include <vector>
 
 #include "INETDefs.h"
 
@@ -33,6 +33,7 @@ class TCPConnection;
 class TCPSegment;
 class TCPSendQueue;
 class TCPReceiveQueue;
+class TCPTimerWheel;
 
 // macro for normal EV<< logging (Note: deliberately no parens in macro def)
 #define tcpEV (ev.isDisabled()||TCP::testing)?EV:EV
@@ -144,8 +145,22 @@ class INET_API TCP : public cSimpleModule, public ILifecycle
     TcpAppConnMap tcpAppConnMap;
     TcpConnMap tcpConnMap;
 
+    // segment demultiplexing index over the connections in tcpConnMap:
+    // connections with a remote socket are hashed on remote address, remote
+    // port and local port (so that the ones with and without a local address
+    // share a bucket), the LISTENing ones are kept by local port
+    typedef std::vector<TCPConnection*> ConnBucket;
+    typedef std::map<int, std::vector<TCPConnection*> > ListenerMap;
+
+    std::vector<ConnBucket> connHashTable;  // size is a power of two
+    int numHashedConns;
+    ListenerMap listenerMap;
+
     ushort lastEphemeralPort;
-    std::multiset<ushort> usedEphemeralPorts;
+    std::vector<int> ephemeralPortUseCounts;  // indexed by port - EPHEMERAL_PORTRANGE_START
+
+    TCPTimerWheel *timerWheel;    // connection timers, if useTimerWheel is set
+    cMessage *timerWheelEvent;    // scheduled for the expiry of the first timer on the wheel
 
   protected:
     /** Factory method; may be overriden for customizing TCP */
@@ -158,6 +173,16 @@ class INET_API TCP : public cSimpleModule, public ILifecycle
     virtual void removeConnection(TCPConnection *conn);
     virtual void updateDisplayString();
 
+    // segment demultiplexing index
+    static unsigned int hashSockPair(const IPvXAddress& remoteAddr, int remotePort, int localPort);
+    virtual void addToConnIndex(TCPConnection *conn);
+    virtual void removeFromConnIndex(TCPConnection *conn);
+    virtual void resizeConnHashTable(int numBuckets);
+
+    // timer wheel
+    virtual void updateTimerWheelEvent();
+    virtual void processTimerWheelEvent();
+
   public:
     static bool testing;    // switches between tcpEV and testingEV
     static bool logverbose; // if !testing, turns on more verbose logging
@@ -166,7 +191,7 @@ class INET_API TCP : public cSimpleModule, public ILifecycle
     bool isOperational;     // lifecycle: node is up/down
 
   public:
-    TCP() {}
+    TCP() : timerWheel(NULL), timerWheelEvent(NULL) {}
     virtual ~TCP();
 
   protected:
@@ -194,6 +219,25 @@ class INET_API TCP : public cSimpleModule, public ILifecycle
      */
     virtual void addForkedConnection(TCPConnection *conn, TCPConnection *newConn, IPvXAddress localAddr, IPvXAddress remoteAddr, int localPort, int remotePort);
 
+    /**
+     * To be called from TCPConnection and TCPAlgorithm: schedules a connection
+     * timer for the given time. The timer goes on the timer wheel if it is
+     * enabled and the timer is a TCPTimer, otherwise it is scheduled as a
+     * normal self-message.
+     */
+    virtual void scheduleTimer(cMessage *timer, simtime_t time);
+
+    /**
+     * To be called from TCPConnection and TCPAlgorithm: cancels a timer
+     * scheduled with scheduleTimer(), and returns it.
+     */
+    virtual cMessage *cancelTimer(cMessage *timer);
+
+    /**
+     * Returns true if the timer is scheduled with scheduleTimer().
+     */
+    virtual bool isTimerScheduled(cMessage *timer) const;
+
     /**
      * To be called from TCPConnection: reserves an ephemeral port for the connection.
      */
@@ -199,6 +199,7 @@ class INET_API TCPStateVariables : public cObject
     bool delayed_acks_enabled;  // set if delayed ACK algorithm (RFC 1122) is enabled
     bool limited_transmit_enabled; // set if Limited Transmit algorithm (RFC 3042) is enabled
     bool increased_IW_enabled;  // set if Increased Initial Window (RFC 3390) is enabled
+    uint32 offload_segments;    // max number of segments sent as one super-segment (segmentation offload; 1 if disabled)
 
     uint32 full_sized_segment_counter; // this counter is needed for delayed ACK
     bool ack_now;               // send ACK immediately, needed if delayed_acks_enabled is set
@@ -505,8 +506,10 @@ class INET_API TCPConnection
     /**
      * Utility: sends one segment of 'bytes' bytes from snd_nxt, and advances snd_nxt.
      * sendData(), sendProbe() and retransmitData() internally all rely on this one.
+     * With maxSegments > 1, up to that many segments worth of bytes may be sent
+     * as one super-segment (segmentation offload, see TCPSegmentOffload).
      */
-    virtual void sendSegment(uint32 bytes);
+    virtual void sendSegment(uint32 bytes, uint32 maxSegments = 1);
 
     /** Utility: adds control info to segment and sends it to IP */
     virtual void sendToIP(TCPSegment *tcpseg);
@@ -525,11 +528,14 @@ class INET_API TCPConnection
 
     /** Utility: start a timer */
     void scheduleTimeout(cMessage *msg, simtime_t timeout)
-        {tcpMain->scheduleAt(simTime()+timeout, msg);}
+        {tcpMain->scheduleTimer(msg, simTime()+timeout);}
+
+    /** Utility: returns true if the timer is running */
+    bool isTimerScheduled(cMessage *msg) const {return tcpMain->isTimerScheduled(msg);}
 
   protected:
     /** Utility: cancel a timer */
-    cMessage *cancelEvent(cMessage *msg) {return tcpMain->cancelEvent(msg);}
+    cMessage *cancelEvent(cMessage *msg) {return tcpMain->cancelTimer(msg);}
 
     /** Utility: send IP packet */
     static void sendToIP(TCPSegment *tcpseg, IPvXAddress src, IPvXAddress dest);
@@ -27,6 +27,7 @@
 #include "TCPReceiveQueue.h"
 #include "TCPAlgorithm.h"
 #include "TCPSACKRexmitQueue.h"
+#include "TCPTimerWheel.h"
 
 
 TCPStateVariables::TCPStateVariables()
@@ -64,6 +65,7 @@ TCPStateVariables::TCPStateVariables()
     delayed_acks_enabled = false; // will be set from configureStateVariables()
     limited_transmit_enabled = false; // will be set from configureStateVariables()
     increased_IW_enabled = false; // will be set from configureStateVariables()
+    offload_segments = 1;       // will be set from configureStateVariables()
     full_sized_segment_counter = 0;
     ack_now = false;
 
@@ -149,6 +151,7 @@ std::string TCPStateVariables::detailedInfo() const
     out << "nagle_enabled=" << nagle_enabled << "\n";
     out << "limited_transmit_enabled=" << limited_transmit_enabled << "\n";
     out << "increased_IW_enabled=" << increased_IW_enabled << "\n";
+    out << "offload_segments=" << offload_segments << "\n";
     out << "delayed_acks_enabled=" << delayed_acks_enabled << "\n";
     out << "ws_support=" << ws_support << "\n";
     out << "ws_enabled=" << ws_enabled << "\n";
@@ -206,10 +209,10 @@ TCPConnection::TCPConnection(TCP *_mod, int _appGateIndex, int _connId)
     tcpAlgorithm = NULL;
     state = NULL;
 
-    the2MSLTimer = new cMessage("2MSL");
-    connEstabTimer = new cMessage("CONN-ESTAB");
-    finWait2Timer = new cMessage("FIN-WAIT-2");
-    synRexmitTimer = new cMessage("SYN-REXMIT");
+    the2MSLTimer = new TCPTimer("2MSL");
+    connEstabTimer = new TCPTimer("CONN-ESTAB");
+    finWait2Timer = new TCPTimer("FIN-WAIT-2");
+    synRexmitTimer = new TCPTimer("SYN-REXMIT");
 
     the2MSLTimer->setContextPointer(this);
     connEstabTimer->setContextPointer(this);
@@ -491,8 +491,10 @@ TCPEventCode TCPConnection::processSegment1stThru8th(TCPSegment *tcpseg)
 
         if (tcpseg->getPayloadLength() > 0)
         {
-            // check for full sized segment
-            if (tcpseg->getPayloadLength() == state->snd_mss || tcpseg->getPayloadLength() + tcpseg->getHeaderLength() - TCP_HEADER_OCTETS == state->snd_mss)
+            // check for full sized segment (a super-segment counts as all the segments it stands for)
+            if (tcpseg->getSegmentCount() > 1)
+                state->full_sized_segment_counter += tcpseg->getSegmentCount();
+            else if (tcpseg->getPayloadLength() == state->snd_mss || tcpseg->getPayloadLength() + tcpseg->getHeaderLength() - TCP_HEADER_OCTETS == state->snd_mss)
                 state->full_sized_segment_counter++;
 
             // check for persist probe
@@ -868,7 +870,7 @@ TCPEventCode TCPConnection::processSegmentInListen(TCPSegment *tcpseg, IPvXAddre
         sendSynAck();
         startSynRexmitTimer();
 
-        if (!connEstabTimer->isScheduled())
+        if (!isTimerScheduled(connEstabTimer))
             scheduleTimeout(connEstabTimer, TCP_TIMEOUT_CONN_ESTAB);
 
         //"
@@ -1290,6 +1292,25 @@ bool TCPConnection::processAckInEstabEtc(TCPSegment *tcpseg)
         // otherwise we would use an old ACKNo
         if (tcpseg->getPayloadLength() == 0 && fsm.getState() != TCP_S_SYN_RCVD)
         {
+            // segmentation offload: if the ACK stands for several ACKs of a
+            // coalescing receiver, let the algorithm see them one by one, so
+            // that the congestion window grows as without offload
+            uint32 ackCount = tcpseg->getAckCount();
+            uint32 ackedBytes = state->snd_una - old_snd_una;
+            if (ackCount > 1 && ackedBytes >= ackCount)
+            {
+                uint32 first_snd_una = old_snd_una;
+                uint32 new_snd_una = state->snd_una;
+                for (uint32 i = 1; i < ackCount; i++)
+                {
+                    state->snd_una = first_snd_una + (uint32)((uint64)ackedBytes * i / ackCount);
+                    tcpAlgorithm->receivedDataAck(old_snd_una);
+                    state->dupacks = 0;
+                    old_snd_una = state->snd_una;
+                }
+                state->snd_una = new_snd_una;
+            }
+
             // notify
             tcpAlgorithm->receivedDataAck(old_snd_una);
 
@@ -1385,7 +1406,7 @@ void TCPConnection::startSynRexmitTimer()
     state->syn_rexmit_count = 0;
     state->syn_rexmit_timeout = TCP_TIMEOUT_SYN_REXMIT;
 
-    if (synRexmitTimer->isScheduled())
+    if (isTimerScheduled(synRexmitTimer))
         cancelEvent(synRexmitTimer);
 
     scheduleTimeout(synRexmitTimer, state->syn_rexmit_timeout);
@@ -24,6 +24,7 @@
 #include "TCP.h"
 #include "TCPConnection.h"
 #include "TCPSegment.h"
+#include "TCPSegmentOffload.h"
 #include "TCPCommand_m.h"
 #include "IPv4ControlInfo.h"
 #include "IPv6ControlInfo.h"
@@ -223,7 +224,7 @@ void TCPConnection::sendToIP(TCPSegment *tcpseg)
     tcpseg->setDestPort(remotePort);
     ASSERT(tcpseg->getHeaderLength() >= TCP_HEADER_OCTETS);     // TCP_HEADER_OCTETS = 20 (without options)
     ASSERT(tcpseg->getHeaderLength() <= TCP_MAX_HEADER_OCTETS); // TCP_MAX_HEADER_OCTETS = 60
-    tcpseg->setByteLength(tcpseg->getHeaderLength() + tcpseg->getPayloadLength());
+    tcpseg->setByteLength(tcpseg->getSegmentCount() * tcpseg->getHeaderLength() + tcpseg->getPayloadLength()); // a super-segment has a header per segment
     state->sentBytes = tcpseg->getPayloadLength(); // resetting sentBytes to 0 if sending a segment without data (e.g. ACK)
 
     tcpEV << "Sending: ";
@@ -380,6 +381,7 @@ void TCPConnection::configureStateVariables()
     state->nagle_enabled = tcpMain->par("nagleEnabled"); // Nagle's algorithm (RFC 896) enabled/disabled
     state->limited_transmit_enabled = tcpMain->par("limitedTransmitEnabled"); // Limited Transmit algorithm (RFC 3042) enabled/disabled
     state->increased_IW_enabled = tcpMain->par("increasedIWEnabled"); // Increased Initial Window (RFC 3390) enabled/disabled
+    state->offload_segments = tcpMain->par("offloadSegments").longValue(); // segmentation offload (TSO/GRO)
     state->snd_mss = tcpMain->par("mss").longValue(); // Maximum Segment Size (RFC 793)
     state->ts_support = tcpMain->par("timestampSupport"); // if set, this means that current host supports TS (RFC 1323)
     state->sack_support = tcpMain->par("sackSupport"); // if set, this means that current host supports SACK (RFC 2018, 2883, 3517)
@@ -562,6 +564,15 @@ void TCPConnection::sendAck()
     // write header options
     writeHeaderOptions(tcpseg);
 
+    // GRO: an ACK for coalesced super-segments stands for all the ACKs
+    // the individual segments would have triggered
+    if (TCPSegmentOffload::isUsed())
+    {
+        uint32 ackCount = state->delayed_acks_enabled ? state->full_sized_segment_counter / 2 : state->full_sized_segment_counter;
+        if (ackCount > 1)
+            tcpseg->setAckCount(ackCount);
+    }
+
     // send it
     sendToIP(tcpseg);
 
@@ -588,7 +599,7 @@ void TCPConnection::sendFin()
     tcpAlgorithm->ackSent();
 }
 
-void TCPConnection::sendSegment(uint32 bytes)
+void TCPConnection::sendSegment(uint32 bytes, uint32 maxSegments)
 {
     if (state->sack_enabled && state->afterRto)
     {
@@ -619,8 +630,10 @@ void TCPConnection::sendSegment(uint32 bytes)
 
     ASSERT(options_len < state->snd_mss);
 
-    if (bytes + options_len > state->snd_mss)
-        bytes = state->snd_mss - options_len;
+    uint32 maxSegmentBytes = state->snd_mss - options_len;
+
+    if (bytes > maxSegments * maxSegmentBytes)
+        bytes = maxSegments * maxSegmentBytes;
 
     state->sentBytes = bytes;
 
@@ -635,6 +648,13 @@ void TCPConnection::sendSegment(uint32 bytes)
     tcpseg->setAckBit(true);
     tcpseg->setWindow(updateRcvWnd());
 
+    // segmentation offload: the bytes of several segments travel as one super-segment
+    if (bytes > maxSegmentBytes)
+    {
+        tcpseg->setSegmentCount((bytes + maxSegmentBytes - 1) / maxSegmentBytes);
+        tcpseg->setSegmentSize(maxSegmentBytes);
+    }
+
     // TBD when to set PSH bit?
     // TBD set URG bit if needed
     ASSERT(bytes == tcpseg->getPayloadLength());
@@ -753,7 +773,10 @@ bool TCPConnection::sendData(bool fullSegmentsOnly, uint32 congestionWindow)
     {
         while (bytesToSend >= effectiveMaxBytesSend)
         {
-            sendSegment(state->snd_mss);
+            // with segmentation offload, send all the full segments (up to
+            // offload_segments) at once, as a super-segment
+            uint32 numSegments = std::min((uint32)(bytesToSend / effectiveMaxBytesSend), state->offload_segments);
+            sendSegment(numSegments * state->snd_mss, numSegments);
             bytesToSend -= state->sentBytes;
         }
     }
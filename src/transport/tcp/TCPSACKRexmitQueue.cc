@@ -24,18 +24,22 @@ TCPSACKRexmitQueue::TCPSACKRexmitQueue()
 {
     conn = NULL;
     begin = end = 0;
+    sackedBytes = 0;
+    highestRexmittedSeqNum = 0;
 }
 
 TCPSACKRexmitQueue::~TCPSACKRexmitQueue()
 {
-    while (!rexmitQueue.empty())
-        rexmitQueue.pop_front();
 }
 
 void TCPSACKRexmitQueue::init(uint32 seqNum)
 {
+    rexmitQueue.clear();
+    sackedIntervals.clear();
     begin = seqNum;
     end = seqNum;
+    sackedBytes = 0;
+    highestRexmittedSeqNum = seqNum;
 }
 
 std::string TCPSACKRexmitQueue::str() const
@@ -54,13 +58,80 @@ void TCPSACKRexmitQueue::info() const
 
     for (RexmitQueue::const_iterator i = rexmitQueue.begin(); i != rexmitQueue.end(); i++)
     {
-        tcpEV << j << ". region: [" << i->beginSeqNum << ".." << i->endSeqNum
-              << ") \t sacked=" << i->sacked << "\t rexmitted=" << i->rexmitted
+        tcpEV << j << ". region: [" << i->second.beginSeqNum << ".." << i->second.endSeqNum
+              << ") \t sacked=" << i->second.sacked << "\t rexmitted=" << i->second.rexmitted
               << endl;
         j++;
     }
 }
 
+TCPSACKRexmitQueue::RexmitQueue::iterator TCPSACKRexmitQueue::findRegion(uint32 seqNum)
+{
+    RexmitQueue::iterator i = rexmitQueue.upper_bound(seqNum);
+
+    if (i == rexmitQueue.begin())
+        return rexmitQueue.end();
+
+    --i;
+    return seqLess(seqNum, i->second.endSeqNum) ? i : rexmitQueue.end();
+}
+
+TCPSACKRexmitQueue::RexmitQueue::const_iterator TCPSACKRexmitQueue::findRegion(uint32 seqNum) const
+{
+    RexmitQueue::const_iterator i = rexmitQueue.upper_bound(seqNum);
+
+    if (i == rexmitQueue.begin())
+        return rexmitQueue.end();
+
+    --i;
+    return seqLess(seqNum, i->second.endSeqNum) ? i : rexmitQueue.end();
+}
+
+TCPSACKRexmitQueue::RexmitQueue::iterator TCPSACKRexmitQueue::splitRegion(uint32 seqNum)
+{
+    if (seqNum == end)
+        return rexmitQueue.end();
+
+    RexmitQueue::iterator i = findRegion(seqNum);
+
+    ASSERT(i != rexmitQueue.end());
+
+    if (i->second.beginSeqNum == seqNum)
+        return i;
+
+    // chunk item
+    Region region = i->second;
+    region.beginSeqNum = seqNum;
+    i->second.endSeqNum = seqNum;
+    return rexmitQueue.insert(++i, std::make_pair(seqNum, region));
+}
+
+void TCPSACKRexmitQueue::addSackedInterval(uint32 fromSeqNum, uint32 toSeqNum)
+{
+    SackedIntervals::iterator i = sackedIntervals.upper_bound(fromSeqNum);
+
+    if (i != sackedIntervals.begin())
+    {
+        SackedIntervals::iterator prev = i;
+        --prev;
+
+        if (seqGE(prev->second, fromSeqNum))
+            i = prev;
+    }
+
+    // absorb the overlapping and adjacent intervals
+    while (i != sackedIntervals.end() && seqLE(i->first, toSeqNum))
+    {
+        fromSeqNum = seqMin(fromSeqNum, i->first);
+        toSeqNum = seqMax(toSeqNum, i->second);
+        sackedBytes -= (i->second - i->first);
+        sackedIntervals.erase(i++);
+    }
+
+    sackedIntervals.insert(i, std::make_pair(fromSeqNum, toSeqNum));
+    sackedBytes += (toSeqNum - fromSeqNum);
+}
+
 void TCPSACKRexmitQueue::discardUpTo(uint32 seqNum)
 {
     ASSERT(seqLE(begin, seqNum) && seqLE(seqNum, end));
@@ -69,18 +140,40 @@ void TCPSACKRexmitQueue::discardUpTo(uint32 seqNum)
     {
         RexmitQueue::iterator i = rexmitQueue.begin();
 
-        while ((i != rexmitQueue.end()) && seqLE(i->endSeqNum, seqNum)) // discard/delete regions from rexmit queue, which have been acked
-            i = rexmitQueue.erase(i);
+        while ((i != rexmitQueue.end()) && seqLE(i->second.endSeqNum, seqNum)) // discard/delete regions from rexmit queue, which have been acked
+            rexmitQueue.erase(i++);
 
-        if (i != rexmitQueue.end())
+        if (i != rexmitQueue.end() && i->second.beginSeqNum != seqNum)
         {
-            ASSERT(seqLE(i->beginSeqNum, seqNum) && seqLess(seqNum, i->endSeqNum));
-            i->beginSeqNum = seqNum;
+            ASSERT(seqLess(i->second.beginSeqNum, seqNum) && seqLess(seqNum, i->second.endSeqNum));
+            Region region = i->second;
+            region.beginSeqNum = seqNum;
+            rexmitQueue.erase(i);
+            rexmitQueue.insert(std::make_pair(seqNum, region));
+        }
+
+        SackedIntervals::iterator j = sackedIntervals.begin();
+
+        while (j != sackedIntervals.end() && seqLE(j->second, seqNum))
+        {
+            sackedBytes -= (j->second - j->first);
+            sackedIntervals.erase(j++);
+        }
+
+        if (j != sackedIntervals.end() && seqLess(j->first, seqNum))
+        {
+            uint32 intervalEnd = j->second;
+            sackedBytes -= (seqNum - j->first);
+            sackedIntervals.erase(j);
+            sackedIntervals.insert(std::make_pair(seqNum, intervalEnd));
         }
     }
 
     begin = seqNum;
 
+    if (seqLess(highestRexmittedSeqNum, begin))
+        highestRexmittedSeqNum = begin;
+
     // TESTING queue:
     ASSERT(checkQueue());
 }
@@ -89,7 +182,6 @@ void TCPSACKRexmitQueue::enqueueSentData(uint32 fromSeqNum, uint32 toSeqNum)
 {
     ASSERT(seqLE(begin, fromSeqNum) && seqLE(fromSeqNum, end));
 
-    bool found = false;
     Region region;
 
     tcpEV << "rexmitQ: " << str() << " enqueueSentData [" << fromSeqNum << ".." << toSeqNum << ")\n";
@@ -102,68 +194,52 @@ void TCPSACKRexmitQueue::enqueueSentData(uint32 fromSeqNum, uint32 toSeqNum)
         region.endSeqNum = toSeqNum;
         region.sacked = false;
         region.rexmitted = false;
-        rexmitQueue.push_back(region);
-        found = true;
+        rexmitQueue.insert(rexmitQueue.end(), std::make_pair(fromSeqNum, region));
         fromSeqNum = toSeqNum;
     }
     else
     {
-        RexmitQueue::iterator i = rexmitQueue.begin();
+        RexmitQueue::iterator i = splitRegion(fromSeqNum);
 
-        while (i != rexmitQueue.end() && seqLE(i->endSeqNum, fromSeqNum))
-            i++;
-
-        ASSERT(i != rexmitQueue.end());
-        ASSERT(seqLE(i->beginSeqNum, fromSeqNum) && seqLess(fromSeqNum, i->endSeqNum));
-
-        if (i->beginSeqNum != fromSeqNum)
+        while (i != rexmitQueue.end() && seqLE(i->second.endSeqNum, toSeqNum))
         {
-            // chunk item
-            region = *i;
-            region.endSeqNum = fromSeqNum;
-            rexmitQueue.insert(i, region);
-            i->beginSeqNum = fromSeqNum;
-        }
-
-        while (i != rexmitQueue.end() && seqLE(i->endSeqNum, toSeqNum))
-        {
-            i->rexmitted = true;
-            fromSeqNum = i->endSeqNum;
-            found = true;
+            i->second.rexmitted = true;
+            fromSeqNum = i->second.endSeqNum;
             i++;
         }
 
         if (fromSeqNum != toSeqNum)
         {
-            bool beforeEnd = (i != rexmitQueue.end());
-
-            ASSERT(i == rexmitQueue.end() || seqLess(i->beginSeqNum, toSeqNum));
+            if (i != rexmitQueue.end())
+            {
+                // the region continues beyond toSeqNum
+                ASSERT(seqLess(i->second.beginSeqNum, toSeqNum));
+                splitRegion(toSeqNum);
+                i->second.rexmitted = true;
+            }
+            else
+            {
+                region.beginSeqNum = fromSeqNum;
+                region.endSeqNum = toSeqNum;
+                region.sacked = false;
+                region.rexmitted = false;
+                rexmitQueue.insert(i, std::make_pair(fromSeqNum, region));
+            }
 
-            region.beginSeqNum = fromSeqNum;
-            region.endSeqNum = toSeqNum;
-            region.sacked = beforeEnd ? i->sacked : false;
-            region.rexmitted = beforeEnd;
-            rexmitQueue.insert(i, region);
-            found = true;
             fromSeqNum = toSeqNum;
-
-            if (beforeEnd)
-                i->beginSeqNum = toSeqNum;
         }
-    }
 
-    ASSERT(fromSeqNum == toSeqNum);
+        // everything up to the old end has just been rexmitted
+        uint32 rexmittedUpTo = seqMin(toSeqNum, end);
 
-    if (!found)
-    {
-        EV << "Not found enqueueSentData(" << fromSeqNum << ", " << toSeqNum << ")\nThe Queue is:\n";
-        info();
+        if (seqLess(highestRexmittedSeqNum, rexmittedUpTo))
+            highestRexmittedSeqNum = rexmittedUpTo;
     }
 
-    ASSERT(found);
+    ASSERT(fromSeqNum == toSeqNum);
 
-    begin = rexmitQueue.front().beginSeqNum;
-    end = rexmitQueue.back().endSeqNum;
+    begin = rexmitQueue.begin()->second.beginSeqNum;
+    end = rexmitQueue.rbegin()->second.endSeqNum;
 
     // TESTING queue:
     ASSERT(checkQueue());
@@ -178,13 +254,41 @@ bool TCPSACKRexmitQueue::checkQueue() const
 
     for (RexmitQueue::const_iterator i = rexmitQueue.begin(); i != rexmitQueue.end(); i++)
     {
-        f = f && (b == i->beginSeqNum);
-        f = f && seqLess(i->beginSeqNum, i->endSeqNum);
-        b = i->endSeqNum;
+        f = f && (i->first == i->second.beginSeqNum);
+        f = f && (b == i->second.beginSeqNum);
+        f = f && seqLess(i->second.beginSeqNum, i->second.endSeqNum);
+        b = i->second.endSeqNum;
     }
 
     f = f && (b == end);
 
+    // the sacked intervals must be exactly the maximal runs of sacked regions
+    SackedIntervals::const_iterator j = sackedIntervals.begin();
+    uint32 bytes = 0;
+
+    for (RexmitQueue::const_iterator i = rexmitQueue.begin(); f && i != rexmitQueue.end(); )
+    {
+        if (!i->second.sacked)
+        {
+            i++;
+            continue;
+        }
+
+        uint32 runBegin = i->second.beginSeqNum;
+
+        while (i != rexmitQueue.end() && i->second.sacked)
+            i++;
+
+        uint32 runEnd = (i == rexmitQueue.end()) ? end : i->second.beginSeqNum;
+        f = f && j != sackedIntervals.end() && j->first == runBegin && j->second == runEnd;
+        bytes += runEnd - runBegin;
+
+        if (j != sackedIntervals.end())
+            j++;
+    }
+
+    f = f && j == sackedIntervals.end() && bytes == sackedBytes;
+
     if (!f)
     {
         EV << "Invalid Queue\nThe Queue is:\n";
@@ -207,42 +311,22 @@ void TCPSACKRexmitQueue::setSackedBit(uint32 fromSeqNum, uint32 toSeqNum)
 
     if (!rexmitQueue.empty())
     {
-        RexmitQueue::iterator i = rexmitQueue.begin();
-
-        while (i != rexmitQueue.end() && seqLE(i->endSeqNum, fromSeqNum))
-            i++;
+        RexmitQueue::iterator i = splitRegion(fromSeqNum);
 
-        ASSERT(i != rexmitQueue.end() && seqLE(i->beginSeqNum, fromSeqNum) && seqLess(fromSeqNum, i->endSeqNum));
-
-        if (i->beginSeqNum != fromSeqNum)
-        {
-            Region region = *i;
-
-            region.endSeqNum = fromSeqNum;
-            rexmitQueue.insert(i, region);
-            i->beginSeqNum = fromSeqNum;
-        }
-
-        while (i != rexmitQueue.end() && seqLE(i->endSeqNum, toSeqNum))
+        while (i != rexmitQueue.end() && seqLE(i->second.endSeqNum, toSeqNum))
         {
-            if (seqGE(i->beginSeqNum, fromSeqNum)) // Search region in queue!
-            {
-                found = true;
-                i->sacked = true; // set sacked bit
-            }
-
+            found = true;
+            i->second.sacked = true; // set sacked bit
             i++;
         }
 
-        if (i != rexmitQueue.end() && seqLess(i->beginSeqNum, toSeqNum) && seqLess(toSeqNum, i->endSeqNum))
+        if (i != rexmitQueue.end() && seqLess(i->second.beginSeqNum, toSeqNum))
         {
-            Region region = *i;
-
-            region.endSeqNum = toSeqNum;
-            region.sacked = true;
-            rexmitQueue.insert(i, region);
-            i->beginSeqNum = toSeqNum;
+            splitRegion(toSeqNum);
+            i->second.sacked = true;
         }
+
+        addSackedInterval(fromSeqNum, toSeqNum);
     }
 
     if (!found)
@@ -255,39 +339,27 @@ bool TCPSACKRexmitQueue::getSackedBit(uint32 seqNum) const
 {
     ASSERT(seqLE(begin, seqNum) && seqLE(seqNum, end));
 
-    RexmitQueue::const_iterator i = rexmitQueue.begin();
-
     if (end == seqNum)
         return false;
 
-    while (i != rexmitQueue.end() && seqLE(i->endSeqNum, seqNum))
-        i++;
+    RexmitQueue::const_iterator i = findRegion(seqNum);
 
-    ASSERT((i != rexmitQueue.end()) && seqLE(i->beginSeqNum, seqNum) && seqLess(seqNum, i->endSeqNum));
+    ASSERT(i != rexmitQueue.end());
 
-    return i->sacked;
+    return i->second.sacked;
 }
 
 uint32 TCPSACKRexmitQueue::getHighestSackedSeqNum() const
 {
-    for (RexmitQueue::const_reverse_iterator i = rexmitQueue.rbegin(); i != rexmitQueue.rend(); i++)
-    {
-        if (i->sacked)
-            return i->endSeqNum;
-    }
+    if (sackedIntervals.empty())
+        return begin;
 
-    return begin;
+    return sackedIntervals.rbegin()->second;
 }
 
 uint32 TCPSACKRexmitQueue::getHighestRexmittedSeqNum() const
 {
-    for (RexmitQueue::const_reverse_iterator i = rexmitQueue.rbegin(); i != rexmitQueue.rend(); i++)
-    {
-        if (i->rexmitted)
-            return i->endSeqNum;
-    }
-
-    return begin;
+    return highestRexmittedSeqNum;
 }
 
 uint32 TCPSACKRexmitQueue::checkRexmitQueueForSackedOrRexmittedSegments(uint32 fromSeqNum) const
@@ -297,18 +369,15 @@ uint32 TCPSACKRexmitQueue::checkRexmitQueueForSackedOrRexmittedSegments(uint32 f
     if (rexmitQueue.empty() || (end == fromSeqNum))
         return 0;
 
-    RexmitQueue::const_iterator i = rexmitQueue.begin();
+    RexmitQueue::const_iterator i = findRegion(fromSeqNum);
     uint32 bytes = 0;
 
-    while (i != rexmitQueue.end() && seqLE(i->endSeqNum, fromSeqNum))
-        i++;
-
-    while (i != rexmitQueue.end() && ((i->sacked || i->rexmitted)))
+    while (i != rexmitQueue.end() && ((i->second.sacked || i->second.rexmitted)))
     {
-        ASSERT(seqLE(i->beginSeqNum, fromSeqNum) && seqLess(fromSeqNum, i->endSeqNum));
+        ASSERT(seqLE(i->second.beginSeqNum, fromSeqNum) && seqLess(fromSeqNum, i->second.endSeqNum));
 
-        bytes += (i->endSeqNum - fromSeqNum);
-        fromSeqNum = i->endSeqNum;
+        bytes += (i->second.endSeqNum - fromSeqNum);
+        fromSeqNum = i->second.endSeqNum;
         i++;
     }
 
@@ -318,46 +387,34 @@ uint32 TCPSACKRexmitQueue::checkRexmitQueueForSackedOrRexmittedSegments(uint32 f
 void TCPSACKRexmitQueue::resetSackedBit()
 {
     for (RexmitQueue::iterator i = rexmitQueue.begin(); i != rexmitQueue.end(); i++)
-        i->sacked = false; // reset sacked bit
+        i->second.sacked = false; // reset sacked bit
+
+    sackedIntervals.clear();
+    sackedBytes = 0;
 }
 
 void TCPSACKRexmitQueue::resetRexmittedBit()
 {
     for (RexmitQueue::iterator i = rexmitQueue.begin(); i != rexmitQueue.end(); i++)
-        i->rexmitted = false; // reset rexmitted bit
+        i->second.rexmitted = false; // reset rexmitted bit
+
+    highestRexmittedSeqNum = begin;
 }
 
 uint32 TCPSACKRexmitQueue::getTotalAmountOfSackedBytes() const
 {
-    uint32 bytes = 0;
-
-    for (RexmitQueue::const_iterator i = rexmitQueue.begin(); i != rexmitQueue.end(); i++)
-    {
-        if (i->sacked)
-            bytes += (i->endSeqNum - i->beginSeqNum);
-    }
-
-    return bytes;
+    return sackedBytes;
 }
 
 uint32 TCPSACKRexmitQueue::getAmountOfSackedBytes(uint32 fromSeqNum) const
 {
     ASSERT(seqLE(begin, fromSeqNum) && seqLE(fromSeqNum, end));
 
-    uint32 bytes = 0;
-    RexmitQueue::const_reverse_iterator i = rexmitQueue.rbegin();
-
-    for (; i != rexmitQueue.rend() && seqLE(fromSeqNum, i->beginSeqNum); i++)
-    {
-        if (i->sacked)
-            bytes += (i->endSeqNum - i->beginSeqNum);
-    }
+    // subtract the sacked bytes below fromSeqNum from the total
+    uint32 bytes = sackedBytes;
 
-    if ( i != rexmitQueue.rend()
-            && seqLess(i->beginSeqNum, fromSeqNum) && seqLess(fromSeqNum, i->endSeqNum) && i->sacked)
-    {
-        bytes += (i->endSeqNum - fromSeqNum);
-    }
+    for (SackedIntervals::const_iterator i = sackedIntervals.begin(); i != sackedIntervals.end() && seqLess(i->first, fromSeqNum); i++)
+        bytes -= (seqMin(i->second, fromSeqNum) - i->first);
 
     return bytes;
 }
@@ -369,23 +426,11 @@ uint32 TCPSACKRexmitQueue::getNumOfDiscontiguousSacks(uint32 fromSeqNum) const
     if (rexmitQueue.empty() || (fromSeqNum == end))
         return 0;
 
-    RexmitQueue::const_iterator i = rexmitQueue.begin();
-    uint32 counter = 0;
-
-    while (i != rexmitQueue.end() && seqLE(i->endSeqNum, fromSeqNum)) // search for seqNum
-        i++;
+    // every sacked interval that doesn't end at or below fromSeqNum counts
+    uint32 counter = sackedIntervals.size();
 
-    // search for discontiguous sacked regions
-    bool prevSacked = false;
-
-    while (i != rexmitQueue.end())
-    {
-        if (i->sacked && !prevSacked)
-            counter++;
-
-        prevSacked = i->sacked;
-        i++;
-    }
+    for (SackedIntervals::const_iterator i = sackedIntervals.begin(); i != sackedIntervals.end() && seqLE(i->second, fromSeqNum); i++)
+        counter--;
 
     return counter;
 }
@@ -394,15 +439,11 @@ void TCPSACKRexmitQueue::checkSackBlock(uint32 fromSeqNum, uint32 &length, bool
 {
     ASSERT(seqLE(begin, fromSeqNum) && seqLess(fromSeqNum, end));
 
-    RexmitQueue::const_iterator i = rexmitQueue.begin();
-
-    while (i != rexmitQueue.end() && seqLE(i->endSeqNum, fromSeqNum)) // search for seqNum
-        i++;
+    RexmitQueue::const_iterator i = findRegion(fromSeqNum);
 
     ASSERT(i != rexmitQueue.end());
-    ASSERT(seqLE(i->beginSeqNum, fromSeqNum) && seqLess(fromSeqNum, i->endSeqNum));
 
-    length = (i->endSeqNum - fromSeqNum);
-    sacked = i->sacked;
-    rexmitted = i->rexmitted;
+    length = (i->second.endSeqNum - fromSeqNum);
+    sacked = i->second.sacked;
+    rexmitted = i->second.rexmitted;
 }
@@ -18,6 +18,8 @@
 #ifndef __INET_TCPSACKREXMITQUEUE_H
 #define __INET_TCPSACKREXMITQUEUE_H
 
+#include <map>
+
 #include "INETDefs.h"
 
 #include "TCPConnection.h"
@@ -26,6 +28,13 @@
 
 /**
  * Retransmission data for SACK.
+ *
+ * Regions are kept in a map keyed by their first sequence number, so the
+ * region holding a given sequence number is found in logarithmic time.
+ * The SACKed sequence space is also kept as a separate set of maximal
+ * contiguous intervals, with the total number of SACKed bytes cached, so
+ * that the RFC 3517 scoreboard queries don't have to walk every region
+ * in the window.
  */
 class INET_API TCPSACKRexmitQueue
 {
@@ -40,12 +49,24 @@ class INET_API TCPSACKRexmitQueue
         bool rexmitted;   // indicates whether region has already been retransmitted by data sender
     };
 
-    typedef std::list<Region> RexmitQueue;
-    RexmitQueue rexmitQueue; // rexmitQueue is ordered by seqnum, and doesn't have overlapped Regions
+    // orders sequence numbers within the (less than 2^31 long) window
+    struct SeqNumLess
+    {
+        bool operator()(uint32 a, uint32 b) const { return seqLess(a, b); }
+    };
+
+    typedef std::map<uint32, Region, SeqNumLess> RexmitQueue;
+    RexmitQueue rexmitQueue; // keyed by beginSeqNum; Regions are contiguous and don't overlap
+
+    typedef std::map<uint32, uint32, SeqNumLess> SackedIntervals;
+    SackedIntervals sackedIntervals; // begin -> end of maximal contiguous sacked sequence ranges
 
     uint32 begin;  // 1st sequence number stored
     uint32 end;    // last sequence number stored + 1
 
+    uint32 sackedBytes;             // total length of sackedIntervals
+    uint32 highestRexmittedSeqNum;  // end of the highest rexmitted region, or begin if there is none
+
   public:
     /**
      * Ctor
@@ -173,6 +194,24 @@ class INET_API TCPSACKRexmitQueue
     virtual void checkSackBlock(uint32 seqNum, uint32 &length, bool &sacked, bool &rexmitted) const;
 
   protected:
+    /*
+     * Returns the region containing seqNum, or rexmitQueue.end().
+     */
+    RexmitQueue::iterator findRegion(uint32 seqNum);
+    RexmitQueue::const_iterator findRegion(uint32 seqNum) const;
+
+    /*
+     * Splits the region containing seqNum so that a region starts at seqNum,
+     * and returns that region (rexmitQueue.end() if seqNum is the end).
+     */
+    RexmitQueue::iterator splitRegion(uint32 seqNum);
+
+    /*
+     * Adds [fromSeqNum, toSeqNum) to sackedIntervals, merging it with the
+     * overlapping and adjacent intervals.
+     */
+    void addSackedInterval(uint32 fromSeqNum, uint32 toSeqNum);
+
     /*
      * Returns if TCPSACKRexmitQueue is valid or not.
      */
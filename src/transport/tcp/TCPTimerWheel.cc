@@ -0,0 +1,198 @@
+//
+// Copyright (C) 2014 OpenSim Ltd.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <algorithm>
+
+#include "TCPTimerWheel.h"
+
+
+TCPTimer::TCPTimer(const char *name, short kind) : cMessage(name, kind)
+{
+    wheel = NULL;
+    tick = 0;
+    insertOrder = 0;
+    level = slot = -1;
+    prev = next = NULL;
+}
+
+TCPTimer::TCPTimer(const TCPTimer& other) : cMessage(other)
+{
+    wheel = NULL;
+    tick = 0;
+    insertOrder = 0;
+    level = slot = -1;
+    prev = next = NULL;
+}
+
+TCPTimer::~TCPTimer()
+{
+    if (wheel)
+        wheel->remove(this);
+}
+
+TCPTimerWheel::TCPTimerWheel(simtime_t granularity)
+{
+    if (granularity <= SIMTIME_ZERO)
+        throw cRuntimeError("TCPTimerWheel: granularity must be positive");
+    this->granularity = granularity.raw();
+    currentTick = 0;
+    lastInsertOrder = 0;
+    numTimers = 0;
+    for (int level = 0; level < NUM_LEVELS; level++)
+        for (int slot = 0; slot < NUM_SLOTS; slot++)
+            slots[level][slot] = lastInSlots[level][slot] = NULL;
+}
+
+TCPTimerWheel::~TCPTimerWheel()
+{
+    for (int level = 0; level < NUM_LEVELS; level++)
+    {
+        for (int slot = 0; slot < NUM_SLOTS; slot++)
+        {
+            for (TCPTimer *timer = slots[level][slot]; timer; timer = timer->next)
+                timer->wheel = NULL;
+        }
+    }
+}
+
+bool TCPTimerWheel::isEarlier(const TCPTimer *timer, const TCPTimer *other)
+{
+    return timer->expiry < other->expiry || (timer->expiry == other->expiry && timer->insertOrder < other->insertOrder);
+}
+
+void TCPTimerWheel::place(TCPTimer *timer)
+{
+    // the level is that of the highest digit in which the tick differs from the current one
+    uint64 diff = (uint64)(timer->tick ^ currentTick);
+    int level = 0;
+    while (diff > SLOT_MASK)
+    {
+        diff >>= LEVEL_BITS;
+        level++;
+    }
+
+    timer->level = level;
+    timer->slot = getSlotIndex(timer->tick, level);
+
+    // append, but keep level 0 slots sorted
+    TCPTimer *prev = lastInSlots[level][timer->slot];
+    if (level == 0)
+        while (prev && isEarlier(timer, prev))
+            prev = prev->prev;
+
+    TCPTimer *& next = prev ? prev->next : slots[level][timer->slot];
+    timer->prev = prev;
+    timer->next = next;
+    if (next)
+        next->prev = timer;
+    else
+        lastInSlots[level][timer->slot] = timer;
+    next = timer;
+}
+
+void TCPTimerWheel::unlink(TCPTimer *timer)
+{
+    if (timer->prev)
+        timer->prev->next = timer->next;
+    else
+        slots[timer->level][timer->slot] = timer->next;
+    if (timer->next)
+        timer->next->prev = timer->prev;
+    else
+        lastInSlots[timer->level][timer->slot] = timer->prev;
+    timer->prev = timer->next = NULL;
+}
+
+void TCPTimerWheel::insert(TCPTimer *timer, simtime_t expiry)
+{
+    if (timer->wheel)
+        throw cRuntimeError("TCPTimerWheel: timer (%s)%s is already scheduled", timer->getClassName(), timer->getName());
+
+    timer->wheel = this;
+    timer->expiry = expiry;
+    timer->tick = std::max(expiry.raw() / granularity, currentTick);
+    timer->insertOrder = ++lastInsertOrder;
+    place(timer);
+    numTimers++;
+}
+
+void TCPTimerWheel::remove(TCPTimer *timer)
+{
+    ASSERT(timer->wheel == this);
+    unlink(timer);
+    timer->wheel = NULL;
+    numTimers--;
+}
+
+bool TCPTimerWheel::cascade()
+{
+    // advance the current tick to the beginning of the first non-empty
+    // higher level slot (all lower levels are empty), and redistribute its timers
+    for (int level = 1; level < NUM_LEVELS; level++)
+    {
+        for (int slot = getSlotIndex(currentTick, level) + 1; slot < NUM_SLOTS; slot++)
+        {
+            if (slots[level][slot])
+            {
+                int shift = level * LEVEL_BITS;
+                int64 higherDigits = level == NUM_LEVELS - 1 ? 0 : (currentTick >> (shift + LEVEL_BITS)) << (shift + LEVEL_BITS);
+                currentTick = higherDigits | ((int64)slot << shift);
+
+                TCPTimer *list = slots[level][slot];
+                slots[level][slot] = lastInSlots[level][slot] = NULL;
+                while (list)
+                {
+                    TCPTimer *timer = list;
+                    list = timer->next;
+                    place(timer);
+                }
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+TCPTimer *TCPTimerWheel::findFirst()
+{
+    while (true)
+    {
+        // slots of level 0 before the current tick's digit are always empty
+        for (int slot = getSlotIndex(currentTick, 0); slot < NUM_SLOTS; slot++)
+            if (slots[0][slot])
+                return slots[0][slot];
+
+        if (!cascade())
+            throw cRuntimeError("TCPTimerWheel: inconsistent state");
+    }
+}
+
+TCPTimer *TCPTimerWheel::getFirst()
+{
+    return numTimers == 0 ? NULL : findFirst();
+}
+
+TCPTimer *TCPTimerWheel::removeFirst()
+{
+    if (numTimers == 0)
+        return NULL;
+
+    TCPTimer *timer = findFirst();
+    currentTick = timer->tick;
+    remove(timer);
+    return timer;
+}
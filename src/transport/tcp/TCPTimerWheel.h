@@ -0,0 +1,136 @@
+//
+// Copyright (C) 2014 OpenSim Ltd.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __INET_TCPTIMERWHEEL_H
+#define __INET_TCPTIMERWHEEL_H
+
+#include "INETDefs.h"
+
+class TCPTimerWheel;
+
+/**
+ * Self-message used for the timers of TCP connections. It can be scheduled
+ * either like any other message, or on the TCPTimerWheel of the TCP module.
+ */
+class INET_API TCPTimer : public cMessage
+{
+    friend class TCPTimerWheel;
+
+  protected:
+    TCPTimerWheel *wheel;  // the wheel it is on, or NULL
+    simtime_t expiry;
+    int64 tick;            // expiry in wheel granularity units
+    uint64 insertOrder;    // breaks ties between equal expiries, like in the FES
+    int level;
+    int slot;
+    TCPTimer *prev;        // doubly linked list of the timers in the slot,
+    TCPTimer *next;        // level 0 slots are sorted by expiry and insertOrder
+
+  public:
+    explicit TCPTimer(const char *name = NULL, short kind = 0);
+    TCPTimer(const TCPTimer& other);
+    virtual ~TCPTimer();
+    virtual TCPTimer *dup() const {return new TCPTimer(*this);}
+
+    /** True while the timer is scheduled on a timer wheel */
+    bool isOnWheel() const {return wheel != NULL;}
+
+    /** The time the timer was scheduled for on the wheel */
+    simtime_t getExpiry() const {return expiry;}
+};
+
+/**
+ * Hierarchical timing wheel that lets a TCP module multiplex the timers of
+ * all its connections onto a single self-message, instead of inserting each
+ * of them into the future event set.
+ *
+ * Time is divided into ticks of the given granularity. Every level has 256
+ * slots; a timer goes to the level of the most significant 8-bit digit in
+ * which its tick differs from the current tick, and higher level slots are
+ * cascaded down as time advances. Removal is O(1). Level 0 slots are kept
+ * sorted, so the first timer is found without scanning the timers of a
+ * slot; a timer is sorted in from the end of its slot, which is O(1) when
+ * timers of the same tick are scheduled in the order of their expiry.
+ *
+ * The granularity only affects performance: timers keep their exact expiry
+ * time, and timers with equal expiry are returned in the order they were
+ * inserted, just like the future event set would deliver them.
+ *
+ * The order relative to other events at the same simulation time cannot be
+ * kept, though. The future event set breaks such ties by the order of
+ * insertion, and the wheel's self-message is inserted when it is
+ * (re)scheduled for the first timer, not when that timer was scheduled;
+ * OMNeT++ does not allow setting the insertion order of a message.
+ */
+class INET_API TCPTimerWheel
+{
+  protected:
+    enum { LEVEL_BITS = 8, NUM_SLOTS = 1 << LEVEL_BITS, SLOT_MASK = NUM_SLOTS - 1, NUM_LEVELS = 8 };
+
+    int64 granularity;   // in raw simtime units
+    int64 currentTick;   // no timer expires before this tick
+    uint64 lastInsertOrder;
+    int numTimers;
+    TCPTimer *slots[NUM_LEVELS][NUM_SLOTS];       // first timer of each slot
+    TCPTimer *lastInSlots[NUM_LEVELS][NUM_SLOTS]; // last timer of each slot
+
+  protected:
+    int getSlotIndex(int64 tick, int level) const {return (int)((tick >> (level * LEVEL_BITS)) & SLOT_MASK);}
+    void place(TCPTimer *timer);
+    void unlink(TCPTimer *timer);
+    bool cascade();
+    TCPTimer *findFirst();
+    static bool isEarlier(const TCPTimer *timer, const TCPTimer *other);
+
+  public:
+    TCPTimerWheel(simtime_t granularity);
+
+    /**
+     * Removes the timers still on the wheel, but does not delete them.
+     */
+    ~TCPTimerWheel();
+
+    /**
+     * Schedules the timer for the given time, which must not be earlier
+     * than the expiry of any timer removed by removeFirst() so far.
+     */
+    void insert(TCPTimer *timer, simtime_t expiry);
+
+    /**
+     * Cancels the timer.
+     */
+    void remove(TCPTimer *timer);
+
+    /**
+     * Returns the timer that expires first, or NULL if the wheel is empty.
+     * May cascade timers to lower levels, but does not remove any timer.
+     */
+    TCPTimer *getFirst();
+
+    /**
+     * Removes and returns the timer that expires first, or NULL if the
+     * wheel is empty.
+     */
+    TCPTimer *removeFirst();
+
+    /**
+     * Returns the number of timers on the wheel.
+     */
+    int getNumTimers() const {return numTimers;}
+};
+
+#endif
@@ -17,6 +17,7 @@
 
 #include "DumbTCP.h"
 #include "TCP.h"
+#include "TCPTimerWheel.h"
 
 Register_Class(DumbTCP);
 
@@ -35,14 +36,14 @@ DumbTCP::~DumbTCP()
 {
     // cancel and delete timers
     if (rexmitTimer)
-        delete conn->getTcpMain()->cancelEvent(rexmitTimer);
+        delete conn->getTcpMain()->cancelTimer(rexmitTimer);
 }
 
 void DumbTCP::initialize()
 {
     TCPAlgorithm::initialize();
 
-    rexmitTimer = new cMessage("REXMIT");
+    rexmitTimer = new TCPTimer("REXMIT");
     rexmitTimer->setContextPointer(conn);
 }
 
@@ -60,7 +61,7 @@ void DumbTCP::established(bool active)
 
 void DumbTCP::connectionClosed()
 {
-    conn->getTcpMain()->cancelEvent(rexmitTimer);
+    conn->getTcpMain()->cancelTimer(rexmitTimer);
 }
 
 void DumbTCP::processTimer(cMessage *timer, TCPEventCode& event)
@@ -116,8 +117,8 @@ void DumbTCP::ackSent()
 
 void DumbTCP::dataSent(uint32 fromseq)
 {
-    if (rexmitTimer->isScheduled())
-        conn->getTcpMain()->cancelEvent(rexmitTimer);
+    if (conn->isTimerScheduled(rexmitTimer))
+        conn->getTcpMain()->cancelTimer(rexmitTimer);
 
     conn->scheduleTimeout(rexmitTimer, REXMIT_TIMEOUT);
 }
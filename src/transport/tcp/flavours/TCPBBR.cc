@@ -0,0 +1,426 @@
+//
+// Copyright (C) 2014 OpenSim Ltd.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <algorithm>   // min,max
+
+#include "TCPBBR.h"
+#include "TCP.h"
+
+
+Register_Class(TCPBBR);
+
+const double TCPBBR::HIGH_GAIN = 2.885;
+const double TCPBBR::PACING_GAIN_CYCLE[] = { 1.25, 0.75, 1, 1, 1, 1, 1, 1 };
+const int TCPBBR::CYCLE_LENGTH = 8;
+const int TCPBBR::BTLBW_FILTER_ROUNDS = 10;
+const double TCPBBR::RTPROP_FILTER_LENGTH = 10;
+const double TCPBBR::PROBE_RTT_DURATION = 0.2;
+const int TCPBBR::MIN_CWND_SEGMENTS = 4;
+
+
+static const char *getModeName(TCPBBRStateVariables::Mode mode)
+{
+    switch (mode)
+    {
+        case TCPBBRStateVariables::STARTUP: return "STARTUP";
+        case TCPBBRStateVariables::DRAIN: return "DRAIN";
+        case TCPBBRStateVariables::PROBE_BW: return "PROBE_BW";
+        case TCPBBRStateVariables::PROBE_RTT: return "PROBE_RTT";
+        default: return "???";
+    }
+}
+
+TCPBBRStateVariables::TCPBBRStateVariables()
+{
+    mode = STARTUP;
+    btlBw = 0;
+    rtProp = 0;
+    rtPropStamp = 0;
+    rtPropExpired = false;
+    delivered = 0;
+    roundCount = 0;
+    roundEndSeq = 0;
+    roundStartDelivered = 0;
+    roundStartTime = 0;
+    roundAppLimited = false;
+    pacingGain = cwndGain = 2.885;
+    cycleIndex = 0;
+    cycleStamp = 0;
+    fullBw = 0;
+    fullBwCount = 0;
+    filledPipe = false;
+    probeRttDoneStamp = 0;
+    probeRttRoundDone = false;
+    priorCwnd = 0;
+    rtoRecovery = false;
+    rtoRecoveryPoint = 0;
+}
+
+std::string TCPBBRStateVariables::info() const
+{
+    std::stringstream out;
+    out << TCPBaseAlgStateVariables::info();
+    out << " mode=" << getModeName(mode);
+    out << " btlBw=" << btlBw;
+    out << " rtProp=" << rtProp;
+    return out.str();
+}
+
+std::string TCPBBRStateVariables::detailedInfo() const
+{
+    std::stringstream out;
+    out << TCPBaseAlgStateVariables::detailedInfo();
+    out << "mode = " << getModeName(mode) << "\n";
+    out << "btlBw = " << btlBw << "\n";
+    out << "rtProp = " << rtProp << "\n";
+    out << "pacingGain = " << pacingGain << "\n";
+    out << "cwndGain = " << cwndGain << "\n";
+    out << "roundCount = " << roundCount << "\n";
+    out << "filledPipe = " << filledPipe << "\n";
+    return out.str();
+}
+
+TCPBBR::TCPBBR()
+    : TCPBaseAlg(), state((TCPBBRStateVariables *&)TCPAlgorithm::state)
+{
+}
+
+uint32 TCPBBR::getBdp(double gain)
+{
+    if (state->btlBw == 0 || state->rtProp == 0)
+        return 0;
+    return (uint32)(gain * state->btlBw * SIMTIME_DBL(state->rtProp));
+}
+
+double TCPBBR::getPacingRate()
+{
+    if (state->btlBw > 0)
+        return state->pacingGain * state->btlBw;
+
+    // no bandwidth sample yet: pace the initial window over the RTT, if known
+    if (state->srtt > 0)
+        return state->pacingGain * state->snd_cwnd / SIMTIME_DBL(state->srtt);
+
+    return 0;
+}
+
+bool TCPBBR::sendData(bool sendCommandInvoked)
+{
+    bool sent = TCPBaseAlg::sendData(sendCommandInvoked);
+
+    // delivery rate samples taken while the sender has nothing to send
+    // underestimate the bandwidth
+    if (conn->isSendQueueEmpty() && getBytesInFlight() < state->snd_cwnd)
+        state->roundAppLimited = true;
+
+    return sent;
+}
+
+void TCPBBR::updateRtProp(uint32 firstSeqAcked)
+{
+    // decided before the filter update, which refreshes rtPropStamp, so that
+    // updateMode() can still see the expiry and enter PROBE_RTT
+    state->rtPropExpired = state->rtProp > 0 && simTime() > state->rtPropStamp + RTPROP_FILTER_LENGTH;
+
+    const TCPSegmentTransmitInfoList::Item *found = state->regions.get(firstSeqAcked);
+
+    // Karn: don't take samples from retransmitted data; like in BBR v1, samples
+    // equal to rtProp don't refresh it, so that a stable RTT is probed as well
+    if (found != NULL && found->getTransmitCount() == 1)
+    {
+        simtime_t rtt = simTime() - found->getFirstSentTime();
+
+        if (rtt > 0 && (state->rtProp == 0 || rtt < state->rtProp || state->rtPropExpired))
+        {
+            state->rtProp = rtt;
+            state->rtPropStamp = simTime();
+            tcpEV << "BBR: new rtProp=" << state->rtProp << "\n";
+        }
+    }
+
+    state->regions.clearTo(state->snd_una);
+}
+
+bool TCPBBR::updateRound()
+{
+    if (state->roundCount != 0 && seqLess(state->snd_una, state->roundEndSeq))
+        return false;
+
+    // a round trip ends when the data sent at its start is acked
+    simtime_t interval = simTime() - state->roundStartTime;
+    if (state->roundCount != 0 && interval > 0)
+    {
+        double bandwidth = (state->delivered - state->roundStartDelivered) / SIMTIME_DBL(interval);
+        if (!state->roundAppLimited || bandwidth >= state->btlBw)
+            updateBtlBw(bandwidth);
+    }
+
+    state->roundCount++;
+    state->roundEndSeq = state->snd_max;
+    state->roundStartDelivered = state->delivered;
+    state->roundStartTime = simTime();
+    state->roundAppLimited = false;
+    return true;
+}
+
+void TCPBBR::updateBtlBw(double bandwidth)
+{
+    // windowed max filter: samples that are neither the largest nor newer
+    // than a larger one can never become the maximum, so drop them
+    std::deque<TCPBBRStateVariables::BandwidthSample>& filter = state->btlBwFilter;
+    while (!filter.empty() && filter.back().bandwidth <= bandwidth)
+        filter.pop_back();
+    filter.push_back(TCPBBRStateVariables::BandwidthSample(state->roundCount, bandwidth));
+    while (filter.front().round + BTLBW_FILTER_ROUNDS <= state->roundCount)
+        filter.pop_front();
+
+    state->btlBw = filter.front().bandwidth;
+    tcpEV << "BBR: delivery rate sample " << bandwidth << " bytes/s, btlBw=" << state->btlBw << "\n";
+}
+
+void TCPBBR::checkFullPipe()
+{
+    if (state->filledPipe || state->roundAppLimited)
+        return;
+
+    // the pipe is full when the bandwidth estimate did not grow by 25% in 3 rounds
+    if (state->btlBw >= state->fullBw * 1.25)
+    {
+        state->fullBw = state->btlBw;
+        state->fullBwCount = 0;
+    }
+    else if (++state->fullBwCount >= 3)
+    {
+        state->filledPipe = true;
+        tcpEV << "BBR: pipe filled, btlBw=" << state->btlBw << "\n";
+    }
+}
+
+void TCPBBR::enterProbeBw()
+{
+    state->mode = TCPBBRStateVariables::PROBE_BW;
+    state->cwndGain = 2;
+    // start at a random phase other than the draining one
+    state->cycleIndex = conn->getTcpMain()->intrand(CYCLE_LENGTH - 1);
+    if (state->cycleIndex >= 1)
+        state->cycleIndex++;
+    state->pacingGain = PACING_GAIN_CYCLE[state->cycleIndex];
+    state->cycleStamp = simTime();
+}
+
+void TCPBBR::enterProbeRtt()
+{
+    state->mode = TCPBBRStateVariables::PROBE_RTT;
+    state->pacingGain = state->cwndGain = 1;
+    state->priorCwnd = state->snd_cwnd;
+    state->probeRttDoneStamp = 0;
+}
+
+void TCPBBR::updateMode()
+{
+    uint32 inflight = getBytesInFlight();
+
+    if (state->mode == TCPBBRStateVariables::STARTUP && state->filledPipe)
+    {
+        state->mode = TCPBBRStateVariables::DRAIN;
+        state->pacingGain = 1 / HIGH_GAIN;
+        state->cwndGain = HIGH_GAIN;
+    }
+
+    if (state->mode == TCPBBRStateVariables::DRAIN && inflight <= getBdp(1))
+        enterProbeBw();
+
+    if (state->mode == TCPBBRStateVariables::PROBE_BW)
+    {
+        // a gain phase lasts one rtProp; the draining phase ends early once the
+        // queue built up by the probing phase is gone
+        bool elapsed = simTime() - state->cycleStamp > state->rtProp;
+        double gain = state->pacingGain;
+        if ((elapsed && (gain <= 1 || inflight >= getBdp(gain))) || (gain < 1 && inflight <= getBdp(1)))
+        {
+            state->cycleIndex = (state->cycleIndex + 1) % CYCLE_LENGTH;
+            state->pacingGain = PACING_GAIN_CYCLE[state->cycleIndex];
+            state->cycleStamp = simTime();
+        }
+    }
+
+    if (state->mode != TCPBBRStateVariables::PROBE_RTT && state->rtPropExpired)
+    {
+        tcpEV << "BBR: rtProp expired at t=" << simTime() << ", entering PROBE_RTT\n";
+        enterProbeRtt();
+    }
+
+    if (state->mode == TCPBBRStateVariables::PROBE_RTT)
+    {
+        // hold the minimal window for PROBE_RTT_DURATION and at least one round trip
+        if (state->probeRttDoneStamp == 0 && inflight <= MIN_CWND_SEGMENTS * state->snd_mss)
+        {
+            state->probeRttDoneStamp = simTime() + PROBE_RTT_DURATION;
+            state->probeRttRoundDone = false;
+            state->roundEndSeq = state->snd_max;
+        }
+        else if (state->probeRttDoneStamp != 0 && state->probeRttRoundDone && simTime() > state->probeRttDoneStamp)
+        {
+            state->rtPropStamp = simTime();
+            state->snd_cwnd = std::max(state->snd_cwnd, state->priorCwnd);
+            if (state->filledPipe)
+                enterProbeBw();
+            else
+            {
+                state->mode = TCPBBRStateVariables::STARTUP;
+                state->pacingGain = state->cwndGain = HIGH_GAIN;
+            }
+        }
+    }
+}
+
+void TCPBBR::updateCwnd(uint32 bytesAcked)
+{
+    uint32 minCwnd = MIN_CWND_SEGMENTS * state->snd_mss;
+
+    if (state->rtoRecovery && seqGE(state->snd_una, state->rtoRecoveryPoint))
+    {
+        state->rtoRecovery = false;
+        state->snd_cwnd = std::max(state->snd_cwnd, state->priorCwnd);
+    }
+
+    uint32 target = getBdp(state->cwndGain);
+    if (target == 0)
+        state->snd_cwnd += bytesAcked; // no model yet: grow like slow start
+    else if (state->filledPipe)
+        state->snd_cwnd = std::min(state->snd_cwnd + bytesAcked, std::max(target, minCwnd));
+    else if (state->snd_cwnd < target)
+        state->snd_cwnd += bytesAcked;
+
+    if (!state->rtoRecovery)
+        state->snd_cwnd = std::max(state->snd_cwnd, minCwnd);
+
+    if (state->mode == TCPBBRStateVariables::PROBE_RTT)
+        state->snd_cwnd = std::min(state->snd_cwnd, minCwnd);
+
+    if (cwndVector)
+        cwndVector->record(state->snd_cwnd);
+}
+
+void TCPBBR::receivedDataAck(uint32 firstSeqAcked)
+{
+    TCPBaseAlg::receivedDataAck(firstSeqAcked);
+
+    uint32 bytesAcked = state->snd_una - firstSeqAcked;
+    state->delivered += bytesAcked;
+
+    updateRtProp(firstSeqAcked);
+    if (updateRound())
+    {
+        checkFullPipe();
+        if (state->mode == TCPBBRStateVariables::PROBE_RTT && state->probeRttDoneStamp != 0)
+            state->probeRttRoundDone = true;
+    }
+    updateMode();
+    updateCwnd(bytesAcked);
+
+    tcpEV << "BBR: mode=" << getModeName(state->mode) << ", btlBw=" << state->btlBw
+          << ", rtProp=" << state->rtProp << ", cwnd=" << state->snd_cwnd << "\n";
+
+    if (state->sack_enabled && state->lossRecovery)
+    {
+        // RFC 3517, page 7, (A) and (B), see TCPReno
+        if (seqGE(state->snd_una, state->recoveryPoint))
+        {
+            tcpEV << "Loss Recovery terminated.\n";
+            state->lossRecovery = false;
+        }
+        else
+        {
+            conn->setPipe();
+            if (((int)state->snd_cwnd - (int)state->pipe) >= (int)state->snd_mss) // Note: Typecast needed to avoid prohibited transmissions
+                conn->sendDataDuringLossRecoveryPhase(state->snd_cwnd);
+        }
+    }
+
+    sendData(false);
+}
+
+void TCPBBR::receivedDuplicateAck()
+{
+    TCPBaseAlg::receivedDuplicateAck();
+
+    if (state->dupacks == DUPTHRESH) // DUPTHRESH = 3
+    {
+        // loss is not taken as a congestion signal: retransmit the missing
+        // segment, but keep the window given by the model
+        tcpEV << "BBR on dupAcks == DUPTHRESH(=3): perform Fast Retransmit\n";
+
+        if (state->sack_enabled && (state->recoveryPoint == 0 || seqGE(state->snd_una, state->recoveryPoint)))
+        {
+            state->recoveryPoint = state->snd_max;
+            state->lossRecovery = true;
+            tcpEV << " recoveryPoint=" << state->recoveryPoint << "\n";
+        }
+
+        conn->retransmitOneSegment(false);
+
+        if (state->sack_enabled && state->lossRecovery)
+        {
+            conn->setPipe();
+            restartRexmitTimer();
+            if (((int)state->snd_cwnd - (int)state->pipe) >= (int)state->snd_mss) // Note: Typecast needed to avoid prohibited transmissions
+                conn->sendDataDuringLossRecoveryPhase(state->snd_cwnd);
+        }
+    }
+
+    sendData(false);
+}
+
+void TCPBBR::processRexmitTimer(TCPEventCode& event)
+{
+    TCPBaseAlg::processRexmitTimer(event);
+
+    if (event == TCP_E_ABORT)
+        return;
+
+    // remember the window, restart from one segment, and return to the
+    // model (or the remembered window) once the outstanding data is acked
+    if (!state->rtoRecovery)
+        state->priorCwnd = state->snd_cwnd;
+    state->rtoRecovery = true;
+    state->rtoRecoveryPoint = state->snd_max;
+    state->snd_cwnd = state->snd_mss;
+
+    if (cwndVector)
+        cwndVector->record(state->snd_cwnd);
+
+    tcpEV << "BBR: RTO, resetting cwnd to " << state->snd_cwnd << "\n";
+
+    state->afterRto = true;
+    conn->retransmitOneSegment(true);
+}
+
+void TCPBBR::dataSent(uint32 fromseq)
+{
+    TCPBaseAlg::dataSent(fromseq);
+
+    state->regions.clearTo(state->snd_una);
+    state->regions.set(fromseq, state->snd_max, simTime());
+}
+
+void TCPBBR::segmentRetransmitted(uint32 fromseq, uint32 toseq)
+{
+    TCPBaseAlg::segmentRetransmitted(fromseq, toseq);
+
+    state->regions.set(fromseq, toseq, simTime());
+}
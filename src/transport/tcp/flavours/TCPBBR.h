@@ -0,0 +1,178 @@
+//
+// Copyright (C) 2014 OpenSim Ltd.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __INET_TCPBBR_H
+#define __INET_TCPBBR_H
+
+#include <deque>
+
+#include "INETDefs.h"
+
+#include "TCPBaseAlg.h"
+#include "TCPSegmentTransmitInfoList.h"
+
+
+/**
+ * State variables for TCPBBR.
+ */
+class INET_API TCPBBRStateVariables : public TCPBaseAlgStateVariables
+{
+  public:
+    enum Mode { STARTUP, DRAIN, PROBE_BW, PROBE_RTT };
+
+    // bandwidth sample of a round trip, for the windowed max filter
+    struct BandwidthSample
+    {
+        uint64 round;
+        double bandwidth;
+        BandwidthSample(uint64 round, double bandwidth) : round(round), bandwidth(bandwidth) {}
+    };
+
+  public:
+    TCPBBRStateVariables();
+    virtual std::string info() const;
+    virtual std::string detailedInfo() const;
+
+    Mode mode;
+
+    /// path model
+    //@{
+    double btlBw;             ///< bottleneck bandwidth estimate in bytes/s (0 if none yet)
+    std::deque<BandwidthSample> btlBwFilter; ///< samples of the last rounds, in decreasing bandwidth order
+    simtime_t rtProp;         ///< round-trip propagation time estimate (0 if none yet)
+    simtime_t rtPropStamp;    ///< time rtProp was last refreshed
+    bool rtPropExpired;       ///< rtProp was older than the filter length at the last ACK
+    //@}
+
+    /// delivery rate measurement, one sample per round trip
+    //@{
+    uint64 delivered;         ///< total number of bytes acked
+    uint64 roundCount;        ///< number of round trips so far
+    uint32 roundEndSeq;       ///< the round trip ends when this is acked
+    uint64 roundStartDelivered;
+    simtime_t roundStartTime;
+    bool roundAppLimited;     ///< the sender ran out of data during the round
+    //@}
+
+    /// gains and PROBE_BW gain cycling
+    //@{
+    double pacingGain;
+    double cwndGain;
+    int cycleIndex;
+    simtime_t cycleStamp;
+    //@}
+
+    /// STARTUP: detecting that the pipe is full
+    //@{
+    double fullBw;
+    int fullBwCount;
+    bool filledPipe;
+    //@}
+
+    /// PROBE_RTT and loss recovery
+    //@{
+    simtime_t probeRttDoneStamp; ///< 0 until inflight drops to the PROBE_RTT window
+    bool probeRttRoundDone;
+    uint32 priorCwnd;            ///< cwnd to restore after PROBE_RTT or RTO recovery
+    bool rtoRecovery;
+    uint32 rtoRecoveryPoint;
+    //@}
+
+    TCPSegmentTransmitInfoList regions;
+};
+
+
+/**
+ * A model-based congestion control in the spirit of BBR (Cardwell et al.,
+ * "BBR: Congestion-Based Congestion Control", ACM Queue 2016). Instead of
+ * reacting to loss, it estimates the bottleneck bandwidth (windowed max of
+ * the delivery rate over the last 10 round trips) and the round-trip
+ * propagation time (windowed min of the RTT over 10 seconds), paces new
+ * segments at pacingGain * btlBw, and limits the data in flight to
+ * cwndGain * btlBw * rtProp.
+ *
+ * It goes through the STARTUP, DRAIN, PROBE_BW (gain cycling) and PROBE_RTT
+ * modes of BBR v1. Simplifications: the delivery rate is sampled once per
+ * round trip rather than per ACK, and RTT samples are taken from
+ * TCPSegmentTransmitInfoList, skipping retransmitted data (Karn). Losses are
+ * repaired with fast retransmit and SACK based loss recovery, without
+ * reducing the window; after an RTO the window restarts from one segment
+ * and grows back to the model within a round trip.
+ */
+class INET_API TCPBBR : public TCPBaseAlg
+{
+  protected:
+    TCPBBRStateVariables *&state; // alias to TCPAlgorithm's 'state'
+
+    static const double HIGH_GAIN;     // 2/ln(2), doubles the delivery rate every round in STARTUP
+    static const double PACING_GAIN_CYCLE[];
+    static const int CYCLE_LENGTH;
+    static const int BTLBW_FILTER_ROUNDS;
+    static const double RTPROP_FILTER_LENGTH; // in seconds
+    static const double PROBE_RTT_DURATION;   // in seconds
+    static const int MIN_CWND_SEGMENTS;
+
+    /** Create and return a TCPBBRStateVariables object. */
+    virtual TCPStateVariables *createStateVariables()
+    {
+        return new TCPBBRStateVariables();
+    }
+
+    /** Restart from one segment, and grow back to the model */
+    virtual void processRexmitTimer(TCPEventCode& event);
+
+    /** Paces data at pacingGain * btlBw */
+    virtual double getPacingRate();
+
+    /** Send data, and note if the sender is application limited */
+    virtual bool sendData(bool sendCommandInvoked);
+
+    /** @name Updating the path model and the state machine on ACKs */
+    //@{
+    virtual void updateRtProp(uint32 firstSeqAcked);
+    virtual bool updateRound();
+    virtual void updateBtlBw(double bandwidth);
+    virtual void checkFullPipe();
+    virtual void updateMode();
+    virtual void updateCwnd(uint32 bytesAcked);
+    //@}
+
+    virtual void enterProbeBw();
+    virtual void enterProbeRtt();
+
+    /** Returns btlBw * rtProp scaled by the gain, or 0 if there is no estimate yet */
+    virtual uint32 getBdp(double gain);
+
+    uint32 getBytesInFlight() {return state->snd_max - state->snd_una;}
+
+  public:
+    /** Ctor */
+    TCPBBR();
+
+    /** Redefine what should happen when data got acked, to update the model */
+    virtual void receivedDataAck(uint32 firstSeqAcked);
+
+    /** Redefine what should happen when dupAck was received, to retransmit lost data */
+    virtual void receivedDuplicateAck();
+
+    /** Called after we send data */
+    virtual void dataSent(uint32 fromseq);
+
+    virtual void segmentRetransmitted(uint32 fromseq, uint32 toseq);
+};
+
+#endif
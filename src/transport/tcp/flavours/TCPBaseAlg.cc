@@ -19,6 +19,7 @@
 #include "TCPBaseAlg.h"
 #include "TCP.h"
 #include "TCPSACKRexmitQueue.h"
+#include "TCPTimerWheel.h"
 
 
 //
@@ -95,7 +96,7 @@ std::string TCPBaseAlgStateVariables::detailedInfo() const
 TCPBaseAlg::TCPBaseAlg() : TCPAlgorithm(),
         state((TCPBaseAlgStateVariables *&)TCPAlgorithm::state)
 {
-    rexmitTimer = persistTimer = delayedAckTimer = keepAliveTimer = NULL;
+    rexmitTimer = persistTimer = delayedAckTimer = keepAliveTimer = pacingTimer = NULL;
     cwndVector = ssthreshVector = rttVector = srttVector = rttvarVector = rtoVector = numRtosVector = NULL;
 }
 
@@ -108,6 +109,7 @@ TCPBaseAlg::~TCPBaseAlg()
     if (persistTimer)    delete cancelEvent(persistTimer);
     if (delayedAckTimer) delete cancelEvent(delayedAckTimer);
     if (keepAliveTimer)  delete cancelEvent(keepAliveTimer);
+    if (pacingTimer)     delete cancelEvent(pacingTimer);
 
     // delete statistics objects
     delete cwndVector;
@@ -123,15 +125,17 @@ void TCPBaseAlg::initialize()
 {
     TCPAlgorithm::initialize();
 
-    rexmitTimer = new cMessage("REXMIT");
-    persistTimer = new cMessage("PERSIST");
-    delayedAckTimer = new cMessage("DELAYEDACK");
-    keepAliveTimer = new cMessage("KEEPALIVE");
+    rexmitTimer = new TCPTimer("REXMIT");
+    persistTimer = new TCPTimer("PERSIST");
+    delayedAckTimer = new TCPTimer("DELAYEDACK");
+    keepAliveTimer = new TCPTimer("KEEPALIVE");
+    pacingTimer = new TCPTimer("PACING");
 
     rexmitTimer->setContextPointer(conn);
     persistTimer->setContextPointer(conn);
     delayedAckTimer->setContextPointer(conn);
     keepAliveTimer->setContextPointer(conn);
+    pacingTimer->setContextPointer(conn);
 
     if (conn->getTcpMain()->recordStatistics)
     {
@@ -208,6 +212,7 @@ void TCPBaseAlg::connectionClosed()
     cancelEvent(persistTimer);
     cancelEvent(delayedAckTimer);
     cancelEvent(keepAliveTimer);
+    cancelEvent(pacingTimer);
 }
 
 void TCPBaseAlg::processTimer(cMessage *timer, TCPEventCode& event)
@@ -220,6 +225,8 @@ void TCPBaseAlg::processTimer(cMessage *timer, TCPEventCode& event)
         processDelayedAckTimer(event);
     else if (timer == keepAliveTimer)
         processKeepAliveTimer(event);
+    else if (timer == pacingTimer)
+        processPacingTimer(event);
     else
         throw cRuntimeError(timer, "unrecognized timer");
 }
@@ -355,6 +362,11 @@ void TCPBaseAlg::processKeepAliveTimer(TCPEventCode& event)
     // packets."
 }
 
+void TCPBaseAlg::processPacingTimer(TCPEventCode& event)
+{
+    sendData(false);
+}
+
 void TCPBaseAlg::startRexmitTimer()
 {
     // start counting retransmissions for this seq number.
@@ -468,6 +480,10 @@ bool TCPBaseAlg::sendData(bool sendCommandInvoked)
         }
     }
 
+    double pacingRate = getPacingRate();
+    if (pacingRate > 0)
+        return sendPacedData(fullSegmentsOnly, pacingRate);
+
     //
     // Send window is effectively the minimum of the congestion window (cwnd)
     // and the advertised window (snd_wnd).
@@ -475,6 +491,35 @@ bool TCPBaseAlg::sendData(bool sendCommandInvoked)
     return conn->sendData(fullSegmentsOnly, state->snd_cwnd);
 }
 
+bool TCPBaseAlg::sendPacedData(bool fullSegmentsOnly, double pacingRate)
+{
+    if (conn->isTimerScheduled(pacingTimer))
+        return false;
+
+    if (simTime() < pacingNextSendTime)
+    {
+        if (!conn->isSendQueueEmpty())
+            conn->scheduleTimeout(pacingTimer, pacingNextSendTime - simTime());
+        return false;
+    }
+
+    // open the window by one segment beyond the data in flight, so that
+    // TCPConnection::sendData() sends a single segment
+    uint32 flight = (state->afterRto ? state->snd_nxt : state->snd_max) - state->snd_una;
+    uint32 window = std::min(state->snd_cwnd, flight + state->snd_mss);
+
+    if (!conn->sendData(fullSegmentsOnly, window))
+        return false;
+
+    pacingNextSendTime = simTime() + state->sentBytes / pacingRate;
+    tcpEV << "Pacing at " << pacingRate << " bytes/s, next segment may be sent at " << pacingNextSendTime << "\n";
+
+    if (!conn->isSendQueueEmpty())
+        conn->scheduleTimeout(pacingTimer, pacingNextSendTime - simTime());
+
+    return true;
+}
+
 void TCPBaseAlg::sendCommandInvoked()
 {
     // try sending
@@ -491,7 +536,7 @@ void TCPBaseAlg::receivedOutOfOrderSegment()
 void TCPBaseAlg::receiveSeqChanged()
 {
     // If we send a data segment already (with the updated seqNo) there is no need to send an additional ACK
-    if (state->full_sized_segment_counter == 0 && !state->ack_now && state->last_ack_sent == state->rcv_nxt && !delayedAckTimer->isScheduled()) // ackSent?
+    if (state->full_sized_segment_counter == 0 && !state->ack_now && state->last_ack_sent == state->rcv_nxt && !conn->isTimerScheduled(delayedAckTimer)) // ackSent?
     {
         // tcpEV << "ACK has already been sent (possibly piggybacked on data)\n";
     }
@@ -527,7 +572,7 @@ void TCPBaseAlg::receiveSeqChanged()
             else
             {
                 tcpEV << "rcv_nxt changed to " << state->rcv_nxt << ", (delayed ACK enabled and full_sized_segment_counter=" << state->full_sized_segment_counter << ") scheduling ACK\n";
-                if (!delayedAckTimer->isScheduled()) // schedule delayed ACK timer if not already running
+                if (!conn->isTimerScheduled(delayedAckTimer)) // schedule delayed ACK timer if not already running
                     conn->scheduleTimeout(delayedAckTimer, DELAYED_ACK_TIMEOUT);
             }
         }
@@ -559,7 +604,7 @@ void TCPBaseAlg::receivedDataAck(uint32 firstSeqAcked)
     //
     if (state->snd_una == state->snd_max)
     {
-        if (rexmitTimer->isScheduled())
+        if (conn->isTimerScheduled(rexmitTimer))
         {
             tcpEV << "ACK acks all outstanding segments, cancel REXMIT timer\n";
             cancelEvent(rexmitTimer);
@@ -587,9 +632,9 @@ void TCPBaseAlg::receivedDataAck(uint32 firstSeqAcked)
     //
     if (state->snd_wnd == 0) // received zero-sized window?
     {
-        if (rexmitTimer->isScheduled())
+        if (conn->isTimerScheduled(rexmitTimer))
         {
-            if (persistTimer->isScheduled())
+            if (conn->isTimerScheduled(persistTimer))
             {
                 tcpEV << "Received zero-sized window and REXMIT timer is running therefore PERSIST timer is canceled.\n";
                 cancelEvent(persistTimer);
@@ -600,7 +645,7 @@ void TCPBaseAlg::receivedDataAck(uint32 firstSeqAcked)
         }
         else
         {
-            if (!persistTimer->isScheduled())
+            if (!conn->isTimerScheduled(persistTimer))
             {
                 tcpEV << "Received zero-sized window therefore PERSIST timer is started.\n";
                 conn->scheduleTimeout(persistTimer, state->persist_timeout);
@@ -611,7 +656,7 @@ void TCPBaseAlg::receivedDataAck(uint32 firstSeqAcked)
     }
     else // received non zero-sized window?
     {
-        if (persistTimer->isScheduled())
+        if (conn->isTimerScheduled(persistTimer))
         {
             tcpEV << "Received non zero-sized window therefore PERSIST timer is canceled.\n";
             cancelEvent(persistTimer);
@@ -662,14 +707,14 @@ void TCPBaseAlg::ackSent()
     state->ack_now = false; // reset flag
     state->last_ack_sent = state->rcv_nxt; // update last_ack_sent, needed for TS option
     // if delayed ACK timer is running, cancel it
-    if (delayedAckTimer->isScheduled())
+    if (conn->isTimerScheduled(delayedAckTimer))
         cancelEvent(delayedAckTimer);
 }
 
 void TCPBaseAlg::dataSent(uint32 fromseq)
 {
     // if retransmission timer not running, schedule it
-    if (!rexmitTimer->isScheduled())
+    if (!conn->isTimerScheduled(rexmitTimer))
     {
         tcpEV << "Starting REXMIT timer\n";
         startRexmitTimer();
@@ -696,7 +741,7 @@ void TCPBaseAlg::segmentRetransmitted(uint32 fromseq, uint32 toseq)
 
 void TCPBaseAlg::restartRexmitTimer()
 {
-    if (rexmitTimer->isScheduled())
+    if (conn->isTimerScheduled(rexmitTimer))
         cancelEvent(rexmitTimer);
 
     startRexmitTimer();
@@ -87,6 +87,7 @@ class INET_API TCPBaseAlgStateVariables : public TCPStateVariables
  *   - Nagle's algorithm (RFC 896) to prevent silly window syndrome
  *   - Increased Initial Window (RFC 3390)
  *   - PERSIST timer
+ *   - pacing of new segments, for subclasses that supply a pacing rate
  *
  * To be done:
  *   - KEEP-ALIVE timer
@@ -109,6 +110,9 @@ class INET_API TCPBaseAlg : public TCPAlgorithm
     cMessage *persistTimer;
     cMessage *delayedAckTimer;
     cMessage *keepAliveTimer;
+    cMessage *pacingTimer;
+
+    simtime_t pacingNextSendTime; // earliest time the next paced segment may be sent
 
     cOutVector *cwndVector;  // will record changes to snd_cwnd
     cOutVector *ssthreshVector; // will record changes to ssthresh
@@ -119,12 +123,13 @@ class INET_API TCPBaseAlg : public TCPAlgorithm
     cOutVector *numRtosVector; // will record total number of RTOs
 
   protected:
-    /** @name Process REXMIT, PERSIST, DELAYED-ACK and KEEP-ALIVE timers */
+    /** @name Process REXMIT, PERSIST, DELAYED-ACK, KEEP-ALIVE and PACING timers */
     //@{
     virtual void processRexmitTimer(TCPEventCode& event);
     virtual void processPersistTimer(TCPEventCode& event);
     virtual void processDelayedAckTimer(TCPEventCode& event);
     virtual void processKeepAliveTimer(TCPEventCode& event);
+    virtual void processPacingTimer(TCPEventCode& event);
     //@}
 
     /**
@@ -150,8 +155,21 @@ class INET_API TCPBaseAlg : public TCPAlgorithm
      */
     virtual bool sendData(bool sendCommandInvoked);
 
+    /**
+     * Returns the rate (in bytes/s) at which new segments should be paced
+     * out, or zero if they may be sent in bursts as the windows allow.
+     * Returns zero here; model-based flavours like TCPBBR redefine it.
+     */
+    virtual double getPacingRate() {return 0;}
+
+    /**
+     * Sends at most one new segment, and schedules the PACING timer for
+     * the time the next one may follow at the given rate.
+     */
+    virtual bool sendPacedData(bool fullSegmentsOnly, double pacingRate);
+
     /** Utility function */
-    cMessage *cancelEvent(cMessage *msg) {return conn->getTcpMain()->cancelEvent(msg);}
+    cMessage *cancelEvent(cMessage *msg) {return conn->getTcpMain()->cancelTimer(msg);}
 
   public:
     /**
@@ -174,7 +192,7 @@ class INET_API TCPBaseAlg : public TCPAlgorithm
     virtual void connectionClosed();
 
     /**
-     * Process REXMIT, PERSIST, DELAYED-ACK and KEEP-ALIVE timers.
+     * Process REXMIT, PERSIST, DELAYED-ACK, KEEP-ALIVE and PACING timers.
      */
     virtual void processTimer(cMessage *timer, TCPEventCode& event);
 
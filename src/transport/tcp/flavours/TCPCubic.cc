@@ -0,0 +1,138 @@
+//
+// Copyright (C) 2014 OpenSim Ltd.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <math.h>
+#include <algorithm>   // min,max
+
+#include "TCPCubic.h"
+#include "TCP.h"
+
+
+Register_Class(TCPCubic);
+
+const double TCPCubic::C = 0.4;
+const double TCPCubic::BETA = 0.7;
+
+
+TCPCubicStateVariables::TCPCubicStateVariables()
+{
+    w_max = 0;
+    w_lastMax = 0;
+    w_est = 0;
+    k = 0;
+    originPoint = 0;
+    epochStart = 0;
+    cwndFraction = 0;
+}
+
+std::string TCPCubicStateVariables::info() const
+{
+    std::stringstream out;
+    out << TCPRenoStateVariables::info();
+    out << " w_max=" << w_max;
+    return out.str();
+}
+
+std::string TCPCubicStateVariables::detailedInfo() const
+{
+    std::stringstream out;
+    out << TCPRenoStateVariables::detailedInfo();
+    out << "w_max=" << w_max << "\n";
+    out << "w_est=" << w_est << "\n";
+    out << "K=" << k << "\n";
+    out << "epochStart=" << epochStart << "\n";
+    return out.str();
+}
+
+TCPCubic::TCPCubic() : TCPReno(),
+        state((TCPCubicStateVariables *&)TCPAlgorithm::state)
+{
+}
+
+void TCPCubic::recalculateSlowStartThreshold()
+{
+    // RFC 8312, section 4.5: "W_max = cwnd; ssthresh = cwnd * beta_cubic".
+    // Like TCPReno, the window is limited by the advertised window here.
+    uint32 flight_size = std::min(state->snd_cwnd, state->snd_wnd);
+    double cwnd = (double)flight_size / state->snd_mss;
+
+    // RFC 8312, section 4.6: fast convergence releases bandwidth to new flows
+    // if the window did not even reach the previous maximum
+    if (cwnd < state->w_lastMax)
+        state->w_max = cwnd * (1 + BETA) / 2;
+    else
+        state->w_max = cwnd;
+    state->w_lastMax = cwnd;
+
+    state->ssthresh = std::max((uint32)(flight_size * BETA), 2 * state->snd_mss);
+    state->epochStart = 0;
+
+    if (ssthreshVector)
+        ssthreshVector->record(state->ssthresh);
+
+    tcpEV << "CUBIC window reduction: w_max=" << state->w_max << " segments, ssthresh=" << state->ssthresh << "\n";
+}
+
+void TCPCubic::performCongestionAvoidance()
+{
+    simtime_t now = simTime();
+    double cwnd = (double)state->snd_cwnd / state->snd_mss;
+
+    if (state->epochStart == 0)
+    {
+        // first ACK in congestion avoidance since the last reduction
+        state->epochStart = now;
+        if (cwnd < state->w_max)
+        {
+            state->k = pow((state->w_max - cwnd) / C, 1.0 / 3);
+            state->originPoint = state->w_max;
+        }
+        else
+        {
+            state->k = 0;
+            state->originPoint = cwnd;
+        }
+        state->w_est = cwnd;
+        state->cwndFraction = 0;
+    }
+
+    // RFC 8312, section 4.1: aim for the window the cubic function reaches
+    // one RTT from now, but grow by at most half the window per RTT
+    double t = SIMTIME_DBL(now - state->epochStart + state->srtt) - state->k;
+    double target = state->originPoint + C * t * t * t;
+    target = std::min(target, 1.5 * cwnd);
+
+    // RFC 8312, section 4.2: W_est grows like a standard TCP with the same beta
+    // would, by 3 * (1 - beta) / (1 + beta) segments per RTT
+    state->w_est += 3 * (1 - BETA) / (1 + BETA) / cwnd;
+    target = std::max(target, state->w_est);
+
+    // increase cwnd by (target - cwnd) / cwnd segments per ACK
+    if (target > cwnd)
+    {
+        state->cwndFraction += (target - cwnd) / cwnd * state->snd_mss;
+        uint32 incr = (uint32)state->cwndFraction;
+        state->cwndFraction -= incr;
+        state->snd_cwnd += incr;
+
+        if (cwndVector)
+            cwndVector->record(state->snd_cwnd);
+    }
+
+    tcpEV << "cwnd > ssthresh: CUBIC Congestion Avoidance: target=" << target
+          << " segments, cwnd=" << state->snd_cwnd << "\n";
+}
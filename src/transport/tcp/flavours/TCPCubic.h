@@ -0,0 +1,84 @@
+//
+// Copyright (C) 2014 OpenSim Ltd.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __INET_TCPCUBIC_H
+#define __INET_TCPCUBIC_H
+
+#include "INETDefs.h"
+
+#include "TCPReno.h"
+
+
+/**
+ * State variables for TCPCubic.
+ */
+class INET_API TCPCubicStateVariables : public TCPRenoStateVariables
+{
+  public:
+    TCPCubicStateVariables();
+    virtual std::string info() const;
+    virtual std::string detailedInfo() const;
+
+    /// CUBIC window growth (RFC 8312), windows in segments
+    //@{
+    double w_max;             ///< window before the last reduction
+    double w_lastMax;         ///< w_max before the last reduction (fast convergence)
+    double w_est;             ///< window of a standard TCP in the same epoch (TCP-friendly region)
+    double k;                 ///< time it takes to grow back to w_max, in seconds
+    double originPoint;       ///< window the cubic function plateaus at
+    simtime_t epochStart;     ///< start of the current congestion avoidance epoch (0 if none)
+    double cwndFraction;      ///< fractional part of cwnd increments, in bytes
+    //@}
+};
+
+
+/**
+ * Implements CUBIC congestion control (RFC 8312), as used by default in
+ * Linux. In congestion avoidance the window follows a cubic function of the
+ * time elapsed since the last reduction, independently of the RTT, which
+ * lets it fill long fat pipes quickly; in the TCP-friendly region it grows at
+ * least as fast as Reno would. The window is reduced by the factor beta=0.7
+ * on loss.
+ *
+ * Slow start, fast retransmit/recovery and SACK based loss recovery are
+ * inherited from TCPReno.
+ */
+class INET_API TCPCubic : public TCPReno
+{
+  protected:
+    TCPCubicStateVariables *&state; // alias to TCPAlgorithm's 'state'
+
+    static const double C;
+    static const double BETA;
+
+    /** Create and return a TCPCubicStateVariables object. */
+    virtual TCPStateVariables *createStateVariables() {
+        return new TCPCubicStateVariables();
+    }
+
+    /** Reduces the window by BETA, and ends the current epoch */
+    virtual void recalculateSlowStartThreshold();
+
+    /** Grows cwnd towards the cubic (or TCP-friendly) target window */
+    virtual void performCongestionAvoidance();
+
+  public:
+    /** Ctor */
+    TCPCubic();
+};
+
+#endif
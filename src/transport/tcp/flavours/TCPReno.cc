@@ -131,28 +131,7 @@ void TCPReno::receivedDataAck(uint32 firstSeqAcked)
             tcpEV << "cwnd=" << state->snd_cwnd << "\n";
         }
         else
-        {
-            // perform Congestion Avoidance (RFC 2581)
-            uint32 incr = state->snd_mss * state->snd_mss / state->snd_cwnd;
-
-            if (incr == 0)
-                incr = 1;
-
-            state->snd_cwnd += incr;
-
-            if (cwndVector)
-                cwndVector->record(state->snd_cwnd);
-
-            //
-            // Note: some implementations use extra additive constant mss / 8 here
-            // which is known to be incorrect (RFC 2581 p5)
-            //
-            // Note 2: RFC 3465 (experimental) "Appropriate Byte Counting" (ABC)
-            // would require maintaining a bytes_acked variable here which we don't do
-            //
-
-            tcpEV << "cwnd > ssthresh: Congestion Avoidance: increasing cwnd linearly, to " << state->snd_cwnd << "\n";
-        }
+            performCongestionAvoidance();
     }
 
     if (state->sack_enabled && state->lossRecovery)
@@ -205,6 +184,30 @@ void TCPReno::receivedDataAck(uint32 firstSeqAcked)
     sendData(false);
 }
 
+void TCPReno::performCongestionAvoidance()
+{
+    // perform Congestion Avoidance (RFC 2581)
+    uint32 incr = state->snd_mss * state->snd_mss / state->snd_cwnd;
+
+    if (incr == 0)
+        incr = 1;
+
+    state->snd_cwnd += incr;
+
+    if (cwndVector)
+        cwndVector->record(state->snd_cwnd);
+
+    //
+    // Note: some implementations use extra additive constant mss / 8 here
+    // which is known to be incorrect (RFC 2581 p5)
+    //
+    // Note 2: RFC 3465 (experimental) "Appropriate Byte Counting" (ABC)
+    // would require maintaining a bytes_acked variable here which we don't do
+    //
+
+    tcpEV << "cwnd > ssthresh: Congestion Avoidance: increasing cwnd linearly, to " << state->snd_cwnd << "\n";
+}
+
 void TCPReno::receivedDuplicateAck()
 {
     TCPTahoeRenoFamily::receivedDuplicateAck();
@@ -48,6 +48,9 @@ class INET_API TCPReno : public TCPTahoeRenoFamily
     /** Redefine what should happen on retransmission */
     virtual void processRexmitTimer(TCPEventCode& event);
 
+    /** Increases cwnd on an ACK of new data when cwnd >= ssthresh (RFC 2581) */
+    virtual void performCongestionAvoidance();
+
   public:
     /** Ctor */
     TCPReno();
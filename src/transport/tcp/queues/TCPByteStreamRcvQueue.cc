@@ -28,63 +28,15 @@
 Register_Class(TCPByteStreamRcvQueue);
 
 
-bool TCPByteStreamRcvQueue::Region::merge(const TCPVirtualDataRcvQueue::Region* _other)
-{
-    const Region *other = dynamic_cast<const Region *>(_other);
-
-    if (!other)
-        throw cRuntimeError("merge(): cannot cast (TCPVirtualDataRcvQueue::Region *) to type 'TCPDataStreamRcvQueue::Region *'");
-
-    if (seqLess(end, other->begin) || seqLess(other->end, begin))
-        return false;
-
-    uint32 nbegin = seqMin(begin, other->begin);
-    uint32 nend = seqMax(end, other->end);
-
-    if (nbegin != begin || nend != end)
-    {
-        char *buff = new char[nend-nbegin];
-
-        if (nbegin != begin)
-            other->data.copyDataToBuffer(buff, begin - nbegin);
-
-        data.copyDataToBuffer(buff + begin - nbegin, end - begin);
-
-        if (nend != end)
-            other->data.copyDataToBuffer(buff + end - nbegin, nend - end);
-
-        begin = nbegin;
-        end = nend;
-        data.assignBuffer(buff, end - begin);
-    }
-
-    return true;
-}
-
-TCPByteStreamRcvQueue::Region* TCPByteStreamRcvQueue::Region::split(uint32 seq)
-{
-    ASSERT(seqGreater(seq, begin) && seqLess(seq, end));
-
-    Region *reg = new Region(begin, seq);
-    reg->data.setDataFromByteArray(data, 0, seq - begin);
-    data.truncateData(seq - begin);
-    begin = seq;
-    return reg;
-}
-
-void TCPByteStreamRcvQueue::Region::copyTo(cPacket* msg_) const
+TCPByteStreamRcvQueue::~TCPByteStreamRcvQueue()
 {
-    ASSERT(getLength() == data.getDataArraySize());
-
-    ByteArrayMessage *msg = check_and_cast<ByteArrayMessage *>(msg_);
-    TCPVirtualDataRcvQueue::Region::copyTo(msg);
-    msg->setByteArray(data);
 }
 
-////////////////////////////////////////////////////////////////////
-
-TCPByteStreamRcvQueue::~TCPByteStreamRcvQueue()
+void TCPByteStreamRcvQueue::init(uint32 startSeq)
 {
+    TCPVirtualDataRcvQueue::init(startSeq);
+    dataBuffer.clear();
+    dataBegin = startSeq;
 }
 
 std::string TCPByteStreamRcvQueue::info() const
@@ -103,14 +55,29 @@ std::string TCPByteStreamRcvQueue::info() const
     return os.str();
 }
 
+uint32 TCPByteStreamRcvQueue::insertBytesFromSegment(TCPSegment *tcpseg)
+{
+    // bytes already extracted cannot be stored again
+    if (seqLE(tcpseg->getSequenceNo() + tcpseg->getPayloadLength(), dataBegin))
+        return rcv_nxt;
+    return TCPVirtualDataRcvQueue::insertBytesFromSegment(tcpseg);
+}
+
 cPacket *TCPByteStreamRcvQueue::extractBytesUpTo(uint32 seq)
 {
-    cPacket *msg = NULL;
+    ByteArrayMessage *msg = NULL;
     TCPVirtualDataRcvQueue::Region *reg = extractTo(seq);
     if (reg)
     {
+        ASSERT(reg->getBegin() == dataBegin);
         msg = new ByteArrayMessage("data");
         reg->copyTo(msg);
+        unsigned long length = reg->getLength();
+        char *buffer = new char[length];
+        unsigned int bytes = dataBuffer.popBytesToBuffer(buffer, length);
+        ASSERT(bytes == length);
+        msg->getByteArray().assignBuffer(buffer, bytes);
+        dataBegin = reg->getEnd();
         delete reg;
     }
     return msg;
@@ -120,9 +87,16 @@ TCPVirtualDataRcvQueue::Region* TCPByteStreamRcvQueue::createRegionFromSegment(T
 {
     ASSERT(tcpseg->getPayloadLength() == tcpseg->getByteArray().getDataArraySize());
 
-    Region *region = new Region(tcpseg->getSequenceNo(),
-            tcpseg->getSequenceNo()+tcpseg->getPayloadLength(), tcpseg->getByteArray());
+    // skip the bytes that were already extracted
+    uint32 seq = tcpseg->getSequenceNo();
+    uint32 end = seq + tcpseg->getPayloadLength();
+    const char *data = tcpseg->getByteArray().getDataArrayPointer();
+    if (seqLess(seq, dataBegin))
+    {
+        data += dataBegin - seq;
+        seq = dataBegin;
+    }
+    dataBuffer.setBytesFromBuffer(seq - dataBegin, data, end - seq);
 
-    return region;
+    return new Region(seq, end);
 }
-
@@ -26,60 +26,47 @@
 
 #include "TCPSegment.h"
 #include "TCPVirtualDataRcvQueue.h"
-#include "ByteArray.h"
+#include "ByteArrayBuffer.h"
 
 /**
- * TCP send queue that stores actual bytes.
+ * TCP receive queue that stores actual bytes.
+ *
+ * The bytes are stored in a single buffer indexed by sequence number,
+ * starting at the first byte not yet extracted; out-of-order data is written
+ * in place, and the base class keeps track of the regions received.
  *
  * @see TCPSendQueue
  */
 class INET_API TCPByteStreamRcvQueue : public TCPVirtualDataRcvQueue
 {
   protected:
-    class Region : public TCPVirtualDataRcvQueue::Region
-    {
-      protected:
-        ByteArray data;
-
-      public:
-        Region(uint32 _begin, uint32 _end) : TCPVirtualDataRcvQueue::Region(_begin, _end) {};
-        Region(uint32 _begin, uint32 _end, ByteArray _data)
-                : TCPVirtualDataRcvQueue::Region(_begin, _end), data(_data) {};
-
-        virtual ~Region() {};
-
-        /// Merge other to self
-        virtual bool merge(const TCPVirtualDataRcvQueue::Region* other);
-
-        /// Copy self to msg
-        virtual void copyTo(cPacket* msg) const;
-
-        /**
-         * Returns an allocated new Region object with filled with begin..seq and set self to seq..end
-         */
-        virtual TCPByteStreamRcvQueue::Region* split(uint32 seq);
-    };
+    ByteArrayBuffer dataBuffer;
+    uint32 dataBegin;   // sequence number of the first byte in dataBuffer
 
   public:
     /**
      * Ctor.
      */
-    TCPByteStreamRcvQueue() : TCPVirtualDataRcvQueue() {};
+    TCPByteStreamRcvQueue() : TCPVirtualDataRcvQueue(), dataBegin(0) {};
 
     /**
      * Virtual dtor.
      */
     virtual ~TCPByteStreamRcvQueue();
 
+    virtual void init(uint32 startSeq);
+
     /**
      * Returns a string with region stored.
      */
     virtual std::string info() const;
 
+    virtual uint32 insertBytesFromSegment(TCPSegment *tcpseg);
+
     cPacket* extractBytesUpTo(uint32 seq);
 
     /**
-     * Create a new Region from tcpseg.
+     * Stores the bytes of tcpseg, and creates a new Region for them.
      * Called from insertBytesFromSegment()
      */
     virtual TCPVirtualDataRcvQueue::Region* createRegionFromSegment(TCPSegment *tcpseg);
@@ -0,0 +1,95 @@
+//
+// Copyright (C) 2014 OpenSim Ltd.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <algorithm>
+
+#include "TCPSegmentOffload.h"
+
+
+bool TCPSegmentOffload::used = false;
+
+TCPSegment *TCPSegmentOffload::findSuperSegment(cPacket *packet)
+{
+    if (!used)
+        return NULL;
+
+    for ( ; packet; packet = packet->getEncapsulatedPacket())
+    {
+        TCPSegment *tcpseg = dynamic_cast<TCPSegment *>(packet);
+        if (tcpseg)
+            return tcpseg->getSegmentCount() > 1 ? tcpseg : NULL;
+    }
+    return NULL;
+}
+
+int TCPSegmentOffload::getSegmentCount(cPacket *packet)
+{
+    TCPSegment *tcpseg = findSuperSegment(packet);
+    return tcpseg ? tcpseg->getSegmentCount() : 1;
+}
+
+void TCPSegmentOffload::split(cPacket *packet, std::vector<cPacket *>& pieces)
+{
+    TCPSegment *tcpseg = dynamic_cast<TCPSegment *>(packet);
+    if (tcpseg)
+    {
+        uint32 firstSeq = tcpseg->getSequenceNo();
+        uint32 payloadLength = tcpseg->getPayloadLength();
+        uint32 segmentSize = tcpseg->getSegmentSize();
+        ASSERT(segmentSize > 0);
+
+        for (uint32 offset = 0; offset < payloadLength; offset += segmentSize)
+        {
+            uint32 length = std::min(segmentSize, payloadLength - offset);
+            bool last = offset + length == payloadLength;
+
+            TCPSegment *piece = tcpseg->dup();
+            piece->truncateSegment(firstSeq + offset, firstSeq + offset + length);
+            piece->setSegmentCount(1);
+            piece->setSegmentSize(0);
+            if (!last)
+            {
+                piece->setFinBit(false);
+                piece->setPshBit(false);
+            }
+            piece->setByteLength(piece->getHeaderLength() + length);
+            if (tcpseg->getControlInfo())
+                piece->setControlInfo(tcpseg->getControlInfo()->dup());
+            pieces.push_back(piece);
+        }
+        delete tcpseg;
+        return;
+    }
+
+    // split the encapsulated packet, and wrap each piece into a copy of this header
+    cPacket *encapsulatedPacket = packet->decapsulate();
+    if (!encapsulatedPacket)
+        throw cRuntimeError("TCPSegmentOffload: packet (%s)%s does not carry a TCP segment", packet->getClassName(), packet->getName());
+
+    std::vector<cPacket *> encapsulatedPieces;
+    split(encapsulatedPacket, encapsulatedPieces);
+
+    for (unsigned int i = 0; i < encapsulatedPieces.size(); i++)
+    {
+        bool last = i == encapsulatedPieces.size() - 1;
+        cPacket *piece = last ? packet : packet->dup();
+        if (!last && packet->getControlInfo())
+            piece->setControlInfo(packet->getControlInfo()->dup());
+        piece->encapsulate(encapsulatedPieces[i]);
+        pieces.push_back(piece);
+    }
+}
@@ -0,0 +1,83 @@
+//
+// Copyright (C) 2014 OpenSim Ltd.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __INET_TCPSEGMENTOFFLOAD_H
+#define __INET_TCPSEGMENTOFFLOAD_H
+
+#include <vector>
+
+#include "INETDefs.h"
+
+#include "TCPSegment.h"
+
+/**
+ * Support for the super-segments of TCP segmentation offload (see the
+ * offloadSegments parameter of TCP). A super-segment is a TCPSegment that
+ * stands for several MSS sized segments sent back to back. The network
+ * layer and the links pass it on as a single packet, whose length includes
+ * a TCP header per segment; a queue that might drop or reorder some of its
+ * segments splits the packet carrying it (together with all encapsulating
+ * headers) into one packet per segment, so that from that queue on
+ * everything happens per segment.
+ *
+ * Receivers process super-segments as a whole, like GRO would.
+ */
+class INET_API TCPSegmentOffload
+{
+  protected:
+    static bool used;
+
+  public:
+    /**
+     * Called by TCP modules that send super-segments. Until then, the
+     * functions below return immediately for any packet.
+     */
+    static void setUsed() {used = true;}
+
+    /**
+     * Called by TCP modules in the first stage of initialization, before
+     * any of them calls setUsed(), so that the flag does not carry over
+     * from a previous run.
+     */
+    static void clearUsed() {used = false;}
+
+    /**
+     * Returns true if a TCP module sends super-segments.
+     */
+    static bool isUsed() {return used;}
+
+    /**
+     * Returns the TCP super-segment carried by the packet (at any level of
+     * encapsulation), or NULL if the packet does not carry one.
+     */
+    static TCPSegment *findSuperSegment(cPacket *packet);
+
+    /**
+     * Returns the number of segments the packet stands for: the segment
+     * count of the super-segment it carries, or 1.
+     */
+    static int getSegmentCount(cPacket *packet);
+
+    /**
+     * Splits a packet carrying a super-segment into packets carrying its
+     * segments, in sequence number order, and deletes the original. The
+     * encapsulating packets and their control info are duplicated.
+     */
+    static void split(cPacket *packet, std::vector<cPacket *>& pieces);
+};
+
+#endif
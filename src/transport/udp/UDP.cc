@@ -18,6 +18,7 @@
 
 
 #include <string.h>
+#include <algorithm>
 #include "UDP.h"
 #include "UDPPacket.h"
 #include "IInterfaceTable.h"
@@ -51,6 +52,8 @@
 #define EPHEMERAL_PORTRANGE_START 1024
 #define EPHEMERAL_PORTRANGE_END   5000
 
+#define SOCK_HASHTABLE_INITIAL_SIZE  16
+
 
 Define_Module(UDP);
 
@@ -100,6 +103,7 @@ UDP::SockDesc::SockDesc(int sockId_, int appGateIndex_) {
     multicastLoop = DEFAULT_MULTICAST_LOOP;
     ttl = -1;
     typeOfService = 0;
+    portListOrder = 0;
 }
 
 //--------
@@ -108,6 +112,9 @@ UDP::UDP()
     isOperational = false;
     icmp = NULL;
     icmpv6 = NULL;
+    lastPortListOrder = 0;
+    sockHashTable.assign(SOCK_HASHTABLE_INITIAL_SIZE, SockDescVector());
+    numHashedSockets = 0;
 }
 
 UDP::~UDP()
@@ -357,7 +364,8 @@ void UDP::processUDPPacket(UDPPacket *udpPacket)
     else
     {
         // multicast packet: find all matching sockets, and send up a copy to each
-        std::vector<SockDesc*> sds = findSocketsForMcastBcastPacket(destAddr, destPort, srcAddr, srcPort, isMulticast, isBroadcast);
+        std::vector<SockDesc*>& sds = matchingSockets;
+        findSocketsForMcastBcastPacket(destAddr, destPort, srcAddr, srcPort, isMulticast, isBroadcast, sds);
         if (sds.empty())
         {
             EV << "No socket registered on port " << destPort << "\n";
@@ -501,14 +509,18 @@ void UDP::bind(int sockId, int gateIndex, const IPvXAddress& localAddr, int loca
         if (sd->isBound)
             error("bind: socket is already bound (sockId=%d)", sockId);
 
+        removeFromSocketIndex(sd);
         sd->isBound = true;
         sd->localAddr = localAddr;
+        sd->onlyLocalPortIsSet = sd->localAddr.isUnspecified() && sd->remotePort == -1;
         if (localPort != -1 && sd->localPort != localPort)
         {
             socketsByPortMap[sd->localPort].remove(sd);
             sd->localPort = localPort;
             socketsByPortMap[sd->localPort].push_back(sd);
+            sd->portListOrder = ++lastPortListOrder;
         }
+        addToSocketIndex(sd);
     }
     else
     {
@@ -525,9 +537,11 @@ void UDP::connect(int sockId, int gateIndex, const IPvXAddress& remoteAddr, int
         error("connect: invalid remote port number %d", remotePort);
 
     SockDesc *sd = getOrCreateSocket(sockId, gateIndex);
+    removeFromSocketIndex(sd);
     sd->remoteAddr = remoteAddr;
     sd->remotePort = remotePort;
     sd->onlyLocalPortIsSet = false;
+    addToSocketIndex(sd);
 
     EV << "Socket connected: " << *sd << "\n";
 }
@@ -547,6 +561,9 @@ UDP::SockDesc *UDP::createSocket(int sockId, int gateIndex, const IPvXAddress& l
     // add to socketsByPortMap
     SockDescList& list = socketsByPortMap[sd->localPort]; // create if doesn't exist
     list.push_back(sd);
+    sd->portListOrder = ++lastPortListOrder;
+
+    addToSocketIndex(sd);
 
     EV << "Socket created: " << *sd << "\n";
     return sd;
@@ -563,6 +580,8 @@ void UDP::close(int sockId)
 
     EV << "Closing socket: " << *sd << "\n";
 
+    removeFromSocketIndex(sd);
+
     // remove from socketsByPortMap
     SockDescList& list = socketsByPortMap[sd->localPort];
     for (SockDescList::iterator it = list.begin(); it != list.end(); ++it)
@@ -582,6 +601,11 @@ void UDP::clearAllSockets()
         it->second.clear();
     }
     socketsByPortMap.clear();
+    sockHashTable.assign(SOCK_HASHTABLE_INITIAL_SIZE, SockDescVector());
+    numHashedSockets = 0;
+    socketsByGroupMap.clear();
+    broadcastSocketsByPortMap.clear();
+    matchingSockets.clear();
     for (SocketsByIdMap::iterator it = socketsByIdMap.begin(); it != socketsByIdMap.end(); ++it)
         delete it->second;
     socketsByIdMap.clear();
@@ -625,62 +649,168 @@ UDP::SockDesc *UDP::findFirstSocketByLocalAddress(const IPvXAddress& localAddr,
 
 UDP::SockDesc *UDP::findSocketForUnicastPacket(const IPvXAddress& localAddr, ushort localPort, const IPvXAddress& remoteAddr, ushort remotePort)
 {
-    SocketsByPortMap::iterator it = socketsByPortMap.find(localPort);
-    if (it == socketsByPortMap.end())
-        return NULL;
+    // the socket bound to localAddr that was added to the port last, or if
+    // there is none, the socket bound to ANY_ADDR that was added to the port first
+    // (the connected ones and the unconnected ones are in different entries)
+    if (!localAddr.isUnspecified())
+    {
+        SockDesc *connected = findIndexedSocket(localAddr, localPort, remoteAddr, remotePort, true);
+        SockDesc *unconnected = findIndexedSocket(localAddr, localPort, IPvXAddress(), -1, true);
+        if (connected || unconnected)
+            return !unconnected || (connected && connected->portListOrder > unconnected->portListOrder) ? connected : unconnected;
+    }
 
-    // select the socket bound to ANY_ADDR only if there is no socket bound to localAddr
-    SockDescList& list = it->second;
-    SockDesc *socketBoundToAnyAddress = NULL;
-    for (SockDescList::reverse_iterator it = list.rbegin(); it != list.rend(); ++it)
+    SockDesc *connected = findIndexedSocket(IPvXAddress(), localPort, remoteAddr, remotePort, false);
+    SockDesc *unconnected = findIndexedSocket(IPvXAddress(), localPort, IPvXAddress(), -1, false);
+    return !unconnected || (connected && connected->portListOrder < unconnected->portListOrder) ? connected : unconnected;
+}
+
+void UDP::findSocketsForMcastBcastPacket(const IPvXAddress& localAddr, ushort localPort, const IPvXAddress& remoteAddr, ushort remotePort, bool isMulticast, bool isBroadcast, std::vector<SockDesc*>& result)
+{
+    ASSERT(isMulticast || isBroadcast);
+    result.clear();
+
+    const SockDescVector *candidates = NULL;
+    if (isBroadcast)
+    {
+        BroadcastSocketsByPortMap::const_iterator it = broadcastSocketsByPortMap.find(localPort);
+        if (it != broadcastSocketsByPortMap.end())
+            candidates = &it->second;
+    }
+    else if (isMulticast)
+    {
+        SocketsByGroupMap::const_iterator it = socketsByGroupMap.find(std::make_pair(localAddr, (int)localPort));
+        if (it != socketsByGroupMap.end())
+            candidates = &it->second;
+    }
+    if (!candidates)
+        return;
+
+    // candidates are in the order of the port's SockDescList
+    for (SockDescVector::const_iterator it = candidates->begin(); it != candidates->end(); ++it)
     {
         SockDesc *sd = *it;
-        if (sd->onlyLocalPortIsSet || (
-                (sd->remotePort == -1 || sd->remotePort == remotePort) &&
-                (sd->localAddr.isUnspecified() || sd->localAddr == localAddr) &&
-                (sd->remoteAddr.isUnspecified() || sd->remoteAddr == remoteAddr) ))
+        if ((sd->remotePort == -1 || sd->remotePort == remotePort) &&
+            (sd->remoteAddr.isUnspecified() || sd->remoteAddr == remoteAddr))
+            result.push_back(sd);
+    }
+}
+
+static bool isSameIndexAddress(const IPvXAddress& a, const IPvXAddress& b)
+{
+    // all unspecified addresses (IPv4 and IPv6) stand for "any"
+    return a.isUnspecified() ? b.isUnspecified() : a == b;
+}
+
+unsigned int UDP::hashSocket(const IPvXAddress& localAddr, int localPort, const IPvXAddress& remoteAddr, int remotePort)
+{
+    // FNV-1a over the address words and the ports; unspecified addresses hash alike
+    uint32 hash = 2166136261u;
+    if (!localAddr.isUnspecified())
+    {
+        const uint32 *words = localAddr.words();
+        for (int i = 0; i < localAddr.wordCount(); i++)
+            hash = (hash ^ words[i]) * 16777619u;
+    }
+    hash = (hash ^ (uint32)localPort) * 16777619u;
+    if (!remoteAddr.isUnspecified())
+    {
+        const uint32 *words = remoteAddr.words();
+        for (int i = 0; i < remoteAddr.wordCount(); i++)
+            hash = (hash ^ words[i]) * 16777619u;
+    }
+    hash = (hash ^ (uint32)remotePort) * 16777619u;
+    return hash ^ (hash >> 16);
+}
+
+UDP::SockDesc *UDP::findIndexedSocket(const IPvXAddress& localAddr, int localPort, const IPvXAddress& remoteAddr, int remotePort, bool latest)
+{
+    const SockDescVector& bucket = sockHashTable[hashSocket(localAddr, localPort, remoteAddr, remotePort) & (sockHashTable.size() - 1)];
+    SockDesc *result = NULL;
+    for (SockDescVector::const_iterator it = bucket.begin(); it != bucket.end(); ++it)
+    {
+        SockDesc *sd = *it;
+        if (sd->localPort == localPort && sd->remotePort == remotePort &&
+                isSameIndexAddress(sd->localAddr, localAddr) && isSameIndexAddress(sd->remoteAddr, remoteAddr))
         {
-            if (sd->localAddr.isUnspecified())
-                socketBoundToAnyAddress = sd;
-            else
-                return sd;
+            if (!result || (latest ? sd->portListOrder > result->portListOrder : sd->portListOrder < result->portListOrder))
+                result = sd;
         }
     }
-    return socketBoundToAnyAddress;
+    return result;
 }
 
-std::vector<UDP::SockDesc*> UDP::findSocketsForMcastBcastPacket(const IPvXAddress& localAddr, ushort localPort, const IPvXAddress& remoteAddr, ushort remotePort, bool isMulticast, bool isBroadcast)
+void UDP::addToSocketIndex(SockDesc *sd)
 {
-    ASSERT(isMulticast || isBroadcast);
-    std::vector<SockDesc*> result;
-    SocketsByPortMap::iterator it = socketsByPortMap.find(localPort);
-    if (it == socketsByPortMap.end())
-        return result;
+    if (numHashedSockets >= (int)sockHashTable.size())
+        resizeSockHashTable(2 * sockHashTable.size());
+    sockHashTable[hashSocket(sd->localAddr, sd->localPort, sd->remoteAddr, sd->remotePort) & (sockHashTable.size() - 1)].push_back(sd);
+    numHashedSockets++;
+
+    for (std::map<IPvXAddress,int>::const_iterator it = sd->multicastAddrs.begin(); it != sd->multicastAddrs.end(); ++it)
+        insertInPortListOrder(socketsByGroupMap[std::make_pair(it->first, sd->localPort)], sd);
+    if (sd->isBroadcast)
+        insertInPortListOrder(broadcastSocketsByPortMap[sd->localPort], sd);
+}
 
-    SockDescList& list = it->second;
-    for (SockDescList::iterator it = list.begin(); it != list.end(); ++it)
+void UDP::removeFromSocketIndex(SockDesc *sd)
+{
+    SockDescVector& bucket = sockHashTable[hashSocket(sd->localAddr, sd->localPort, sd->remoteAddr, sd->remotePort) & (sockHashTable.size() - 1)];
+    SockDescVector::iterator pos = std::find(bucket.begin(), bucket.end(), sd);
+    if (pos != bucket.end())
     {
-        SockDesc *sd = *it;
-        if (isBroadcast)
+        // order within a bucket doesn't matter
+        *pos = bucket.back();
+        bucket.pop_back();
+        numHashedSockets--;
+    }
+
+    for (std::map<IPvXAddress,int>::const_iterator it = sd->multicastAddrs.begin(); it != sd->multicastAddrs.end(); ++it)
+    {
+        SocketsByGroupMap::iterator group = socketsByGroupMap.find(std::make_pair(it->first, sd->localPort));
+        if (group != socketsByGroupMap.end())
         {
-            if (sd->isBroadcast)
-            {
-                if ((sd->remotePort == -1 || sd->remotePort == remotePort) &&
-                    (sd->remoteAddr.isUnspecified() || sd->remoteAddr == remoteAddr))
-                    result.push_back(sd);
-            }
+            eraseFromVector(group->second, sd);
+            if (group->second.empty())
+                socketsByGroupMap.erase(group);
         }
-        else if (isMulticast)
+    }
+    if (sd->isBroadcast)
+    {
+        BroadcastSocketsByPortMap::iterator it = broadcastSocketsByPortMap.find(sd->localPort);
+        if (it != broadcastSocketsByPortMap.end())
         {
-            if (sd->multicastAddrs.find(localAddr) != sd->multicastAddrs.end())
-            {
-                if ((sd->remotePort == -1 || sd->remotePort == remotePort) &&
-                    (sd->remoteAddr.isUnspecified() || sd->remoteAddr == remoteAddr))
-                    result.push_back(sd);
-            }
+            eraseFromVector(it->second, sd);
+            if (it->second.empty())
+                broadcastSocketsByPortMap.erase(it);
         }
     }
-    return result;
+}
+
+void UDP::resizeSockHashTable(int numBuckets)
+{
+    std::vector<SockDescVector> oldTable(numBuckets);
+    oldTable.swap(sockHashTable);
+    for (unsigned int i = 0; i < oldTable.size(); i++)
+        for (SockDescVector::iterator it = oldTable[i].begin(); it != oldTable[i].end(); ++it)
+            sockHashTable[hashSocket((*it)->localAddr, (*it)->localPort, (*it)->remoteAddr, (*it)->remotePort) & (numBuckets - 1)].push_back(*it);
+}
+
+static bool isBeforeInPortList(const UDP::SockDesc *a, const UDP::SockDesc *b)
+{
+    return a->portListOrder < b->portListOrder;
+}
+
+void UDP::insertInPortListOrder(SockDescVector& sds, SockDesc *sd)
+{
+    sds.insert(std::upper_bound(sds.begin(), sds.end(), sd, isBeforeInPortList), sd);
+}
+
+void UDP::eraseFromVector(SockDescVector& sds, SockDesc *sd)
+{
+    SockDescVector::iterator pos = std::find(sds.begin(), sds.end(), sd);
+    if (pos != sds.end())
+        sds.erase(pos);
 }
 
 void UDP::sendUp(cPacket *payload, SockDesc *sd, const IPvXAddress& srcAddr, ushort srcPort, const IPvXAddress& destAddr, ushort destPort, int interfaceId, int ttl, unsigned char tos)
@@ -810,6 +940,21 @@ void UDP::setTypeOfService(SockDesc *sd, int typeOfService)
 
 void UDP::setBroadcast(SockDesc *sd, bool broadcast)
 {
+    if (sd->isBroadcast == broadcast)
+        return;
+
+    if (broadcast)
+        insertInPortListOrder(broadcastSocketsByPortMap[sd->localPort], sd);
+    else
+    {
+        BroadcastSocketsByPortMap::iterator it = broadcastSocketsByPortMap.find(sd->localPort);
+        if (it != broadcastSocketsByPortMap.end())
+        {
+            eraseFromVector(it->second, sd);
+            if (it->second.empty())
+                broadcastSocketsByPortMap.erase(it);
+        }
+    }
     sd->isBroadcast = broadcast;
 }
 
@@ -837,6 +982,8 @@ void UDP::joinMulticastGroups(SockDesc *sd, const std::vector<IPvXAddress>& mult
         const IPvXAddress &multicastAddr = multicastAddresses[k];
         int interfaceId = k < interfaceIdsLen ? interfaceIds[k] : -1;
         ASSERT(multicastAddr.isMulticast());
+        if (sd->multicastAddrs.find(multicastAddr) == sd->multicastAddrs.end())
+            insertInPortListOrder(socketsByGroupMap[std::make_pair(multicastAddr, sd->localPort)], sd);
         sd->multicastAddrs[multicastAddr] = interfaceId;
 
         // add the multicast address to the selected interface or all interfaces
@@ -876,7 +1023,18 @@ void UDP::addMulticastAddressToInterface(InterfaceEntry *ie, const IPvXAddress&
 void UDP::leaveMulticastGroups(SockDesc *sd, const std::vector<IPvXAddress>& multicastAddresses)
 {
     for (unsigned int i = 0; i < multicastAddresses.size(); i++)
-        sd->multicastAddrs.erase(multicastAddresses[i]);
+    {
+        if (sd->multicastAddrs.erase(multicastAddresses[i]))
+        {
+            SocketsByGroupMap::iterator group = socketsByGroupMap.find(std::make_pair(multicastAddresses[i], sd->localPort));
+            if (group != socketsByGroupMap.end())
+            {
+                eraseFromVector(group->second, sd);
+                if (group->second.empty())
+                    socketsByGroupMap.erase(group);
+            }
+        }
+    }
     // note: we cannot remove the address from the interface, because someone else may still use it
 }
 
@@ -22,6 +22,7 @@
 
 #include <map>
 #include <list>
+#include <vector>
 
 #include "ILifecycle.h"
 #include "UDPControlInfo.h"
@@ -63,16 +64,33 @@ class INET_API UDP : public cSimpleModule, public ILifecycle
         int ttl;
         unsigned char typeOfService;
         std::map<IPvXAddress,int> multicastAddrs; // key: multicast address; value: output interface Id or -1
+        uint64 portListOrder; // position in the SockDescList of localPort; later sockets have higher values
     };
 
     typedef std::list<SockDesc *> SockDescList;   // might contain duplicated local addresses if their reuseAddr flag is set
     typedef std::map<int,SockDesc *> SocketsByIdMap;
     typedef std::map<int,SockDescList> SocketsByPortMap;
 
+    // socket lookup index over the sockets in socketsByPortMap: all sockets are
+    // hashed on local address, local port, remote address and remote port (with
+    // unspecified address / -1 port for the unset ones); subscribers of multicast
+    // groups and broadcast-enabled sockets are kept per port, in portListOrder
+    typedef std::vector<SockDesc *> SockDescVector;
+    typedef std::map<std::pair<IPvXAddress,int>,SockDescVector> SocketsByGroupMap;  // key: (multicast address, local port)
+    typedef std::map<int,SockDescVector> BroadcastSocketsByPortMap;
+
   protected:
     // sockets
     SocketsByIdMap socketsByIdMap;
     SocketsByPortMap socketsByPortMap;
+    uint64 lastPortListOrder;
+
+    // socket lookup index
+    std::vector<SockDescVector> sockHashTable;  // size is a power of two
+    int numHashedSockets;
+    SocketsByGroupMap socketsByGroupMap;
+    BroadcastSocketsByPortMap broadcastSocketsByPortMap;
+    SockDescVector matchingSockets;  // reused by processUDPPacket() to avoid allocation per packet
 
     // other state vars
     ushort lastEphemeralPort;
@@ -115,11 +133,20 @@ class INET_API UDP : public cSimpleModule, public ILifecycle
     virtual void leaveMulticastGroups(SockDesc *sd, const std::vector<IPvXAddress>& multicastAddresses);
     virtual void addMulticastAddressToInterface(InterfaceEntry *ie, const IPvXAddress& multicastAddr);
 
+    // socket lookup index
+    static unsigned int hashSocket(const IPvXAddress& localAddr, int localPort, const IPvXAddress& remoteAddr, int remotePort);
+    virtual void addToSocketIndex(SockDesc *sd);
+    virtual void removeFromSocketIndex(SockDesc *sd);
+    virtual void resizeSockHashTable(int numBuckets);
+    virtual SockDesc *findIndexedSocket(const IPvXAddress& localAddr, int localPort, const IPvXAddress& remoteAddr, int remotePort, bool latest);
+    static void insertInPortListOrder(SockDescVector& sds, SockDesc *sd);
+    static void eraseFromVector(SockDescVector& sds, SockDesc *sd);
+
     // ephemeral port
     virtual ushort getEphemeralPort();
 
     virtual SockDesc *findSocketForUnicastPacket(const IPvXAddress& localAddr, ushort localPort, const IPvXAddress& remoteAddr, ushort remotePort);
-    virtual std::vector<SockDesc*> findSocketsForMcastBcastPacket(const IPvXAddress& localAddr, ushort localPort, const IPvXAddress& remoteAddr, ushort remotePort, bool isMulticast, bool isBroadcast);
+    virtual void findSocketsForMcastBcastPacket(const IPvXAddress& localAddr, ushort localPort, const IPvXAddress& remoteAddr, ushort remotePort, bool isMulticast, bool isBroadcast, std::vector<SockDesc*>& result);
     virtual SockDesc *findFirstSocketByLocalAddress(const IPvXAddress& localAddr, ushort localPort);
     virtual void sendUp(cPacket *payload, SockDesc *sd, const IPvXAddress& srcAddr, ushort srcPort, const IPvXAddress& destAddr, ushort destPort, int interfaceId, int ttl, unsigned char tos);
     virtual void sendDown(cPacket *appData, const IPvXAddress& srcAddr, ushort srcPort, const IPvXAddress& destAddr, ushort destPort, int interfaceId, bool multicastLoop, int ttl, unsigned char tos);
@@ -18,6 +18,8 @@
 //
 
 #include <sstream>
+#include <algorithm>
+#include <math.h>
 #include <map>
 #include <set>
 
@@ -36,9 +38,13 @@ void ObstacleControl::initialize(int stage)
     if (stage == 0)
     {
         obstacles.clear();
-        cacheEntries.clear();
+        clearCache();
+        numCacheHits = numCacheMisses = 0;
+        WATCH(numCacheHits);
+        WATCH(numCacheMisses);
 
         obstaclesXml = par("obstacles");
+        cacheSize = par("cacheSize");
     }
     else if (stage == 1)
     {
@@ -51,6 +57,9 @@ void ObstacleControl::initialize(int stage)
 }
 
 void ObstacleControl::finish() {
+    recordScalar("attenuation cache hits", numCacheHits);
+    recordScalar("attenuation cache misses", numCacheMisses);
+
     for (Obstacles::iterator i = obstacles.begin(); i != obstacles.end(); ++i) {
         for (ObstacleGridRow::iterator j = i->begin(); j != i->end(); ++j) {
             while (j->begin() != j->end()) erase(*j->begin());
@@ -130,7 +139,7 @@ void ObstacleControl::add(Obstacle obstacle) {
     // visualize using AnnotationManager
     if (annotations) o->visualRepresentation = annotations->drawPolygon(o->getShape(), "red", annotationGroup);
 
-    cacheEntries.clear();
+    clearCache();
 }
 
 void ObstacleControl::erase(const Obstacle* obstacle) {
@@ -150,7 +159,86 @@ void ObstacleControl::erase(const Obstacle* obstacle) {
     if (annotations && obstacle->visualRepresentation) annotations->erase(obstacle->visualRepresentation);
     delete obstacle;
 
+    clearCache();
+}
+
+void ObstacleControl::clearCache() {
     cacheEntries.clear();
+    cacheLRU.clear();
+}
+
+void ObstacleControl::addCellIfExists(long x, long y, std::vector<GridCellIndex>& cells) const {
+    // obstacles at negative coordinates are stored in the first row/column, see add()
+    size_t col = std::max(0L, y);
+    size_t row = std::max(0L, x);
+    if (col < obstacles.size() && row < obstacles[col].size())
+        cells.push_back(GridCellIndex(col, row));
+}
+
+void ObstacleControl::getCellsOnSegment(const Coord& p1, const Coord& p2, std::vector<GridCellIndex>& cells) const {
+    cells.clear();
+
+    // grid traversal (Amanatides & Woo): tMaxX/tMaxY is the fraction of the segment
+    // where it crosses the next vertical/horizontal cell boundary
+    long x = (long)floor(p1.x / GRIDCELL_SIZE);
+    long y = (long)floor(p1.y / GRIDCELL_SIZE);
+    long endX = (long)floor(p2.x / GRIDCELL_SIZE);
+    long endY = (long)floor(p2.y / GRIDCELL_SIZE);
+    double dx = p2.x - p1.x;
+    double dy = p2.y - p1.y;
+    int stepX = dx > 0 ? 1 : -1;
+    int stepY = dy > 0 ? 1 : -1;
+    double tDeltaX = dx != 0 ? GRIDCELL_SIZE / fabs(dx) : 0;
+    double tDeltaY = dy != 0 ? GRIDCELL_SIZE / fabs(dy) : 0;
+    double tMaxX = dx != 0 ? ((x + (stepX > 0 ? 1 : 0)) * (double)GRIDCELL_SIZE - p1.x) / dx : 0;
+    double tMaxY = dy != 0 ? ((y + (stepY > 0 ? 1 : 0)) * (double)GRIDCELL_SIZE - p1.y) / dy : 0;
+
+    addCellIfExists(x, y, cells);
+    while (x != endX || y != endY) {
+        // only step towards the end cell, so that rounding errors cannot make the loop run away
+        if (x != endX && y != endY && tMaxX == tMaxY) {
+            // crossing a grid corner: also take the cells on both sides
+            addCellIfExists(x + stepX, y, cells);
+            addCellIfExists(x, y + stepY, cells);
+            x += stepX;
+            tMaxX += tDeltaX;
+            y += stepY;
+            tMaxY += tDeltaY;
+        }
+        else if (y == endY || (x != endX && tMaxX < tMaxY)) {
+            x += stepX;
+            tMaxX += tDeltaX;
+        }
+        else {
+            y += stepY;
+            tMaxY += tDeltaY;
+        }
+        addCellIfExists(x, y, cells);
+    }
+}
+
+bool ObstacleControl::segmentIntersectsBox(const Coord& p1, const Coord& p2, const Coord& boxP1, const Coord& boxP2) {
+    // clip the segment's parameter range [0, 1] against both slabs of the box (Liang-Barsky)
+    double from[2] = { p1.x, p1.y };
+    double delta[2] = { p2.x - p1.x, p2.y - p1.y };
+    double low[2] = { boxP1.x, boxP1.y };
+    double high[2] = { boxP2.x, boxP2.y };
+    double t0 = 0;
+    double t1 = 1;
+    for (int i = 0; i < 2; i++) {
+        if (delta[i] == 0) {
+            if (from[i] < low[i] || from[i] > high[i]) return false;
+        }
+        else {
+            double ta = (low[i] - from[i]) / delta[i];
+            double tb = (high[i] - from[i]) / delta[i];
+            if (ta > tb) std::swap(ta, tb);
+            t0 = std::max(t0, ta);
+            t1 = std::min(t1, tb);
+            if (t0 > t1) return false;
+        }
+    }
+    return true;
 }
 
 double ObstacleControl::calculateReceivedPower(double pSend, double carrierFrequency, const Coord& senderPos, double senderAngle, const Coord& receiverPos, double receiverAngle) const {
@@ -158,54 +246,57 @@ double ObstacleControl::calculateReceivedPower(double pSend, double carrierFrequ
 
     // return cached result, if available
     CacheKey cacheKey(pSend, carrierFrequency, senderPos, senderAngle, receiverPos, receiverAngle);
-    CacheEntries::const_iterator cacheEntryIter = cacheEntries.find(cacheKey);
-    if (cacheEntryIter != cacheEntries.end()) return cacheEntryIter->second;
-
-    // calculate bounding box of transmission
-    Coord bboxP1 = Coord(std::min(senderPos.x, receiverPos.x), std::min(senderPos.y, receiverPos.y));
-    Coord bboxP2 = Coord(std::max(senderPos.x, receiverPos.x), std::max(senderPos.y, receiverPos.y));
+    if (cacheSize > 0) {
+        CacheEntries::iterator cacheEntryIter = cacheEntries.find(cacheKey);
+        if (cacheEntryIter != cacheEntries.end()) {
+            numCacheHits++;
+            CacheEntry& cacheEntry = cacheEntryIter->second;
+            cacheLRU.splice(cacheLRU.begin(), cacheLRU, cacheEntry.lruPosition);
+            return cacheEntry.receivedPower;
+        }
+        numCacheMisses++;
+    }
 
-    size_t fromRow = std::max(0, int(bboxP1.x / GRIDCELL_SIZE));
-    size_t toRow = std::max(0, int(bboxP2.x / GRIDCELL_SIZE));
-    size_t fromCol = std::max(0, int(bboxP1.y / GRIDCELL_SIZE));
-    size_t toCol = std::max(0, int(bboxP2.y / GRIDCELL_SIZE));
+    // visit the obstacles in the grid cells crossed by the transmission
+    getCellsOnSegment(senderPos, receiverPos, segmentCells);
 
     std::set<Obstacle*> processedObstacles;
-    for (size_t col = fromCol; col <= toCol; ++col) {
-        if (col >= obstacles.size()) break;
-        for (size_t row = fromRow; row <= toRow; ++row) {
-            if (row >= obstacles[col].size()) break;
-            const ObstacleGridCell& cell = (obstacles[col])[row];
-            for (ObstacleGridCell::const_iterator k = cell.begin(); k != cell.end(); ++k) {
+    for (std::vector<GridCellIndex>::const_iterator c = segmentCells.begin(); c != segmentCells.end(); ++c) {
+        const ObstacleGridCell& cell = (obstacles[c->first])[c->second];
+        for (ObstacleGridCell::const_iterator k = cell.begin(); k != cell.end(); ++k) {
 
-                Obstacle* o = *k;
+            Obstacle* o = *k;
 
-                if (processedObstacles.find(o) != processedObstacles.end()) continue;
-                processedObstacles.insert(o);
+            if (!processedObstacles.insert(o).second) continue;
 
-                // bail if bounding boxes cannot overlap
-                if (o->getBboxP2().x < bboxP1.x) continue;
-                if (o->getBboxP1().x > bboxP2.x) continue;
-                if (o->getBboxP2().y < bboxP1.y) continue;
-                if (o->getBboxP1().y > bboxP2.y) continue;
+            // bail if the transmission misses the bounding box
+            if (!segmentIntersectsBox(senderPos, receiverPos, o->getBboxP1(), o->getBboxP2())) continue;
 
-                double pSendOld = pSend;
+            double pSendOld = pSend;
 
-                pSend = o->calculateReceivedPower(pSend, carrierFrequency, senderPos, senderAngle, receiverPos, receiverAngle);
+            pSend = o->calculateReceivedPower(pSend, carrierFrequency, senderPos, senderAngle, receiverPos, receiverAngle);
 
-                // draw a "hit!" bubble
-                if (annotations && (pSend < pSendOld)) annotations->drawBubble(o->getBboxP1(), "hit");
+            // draw a "hit!" bubble
+            if (annotations && (pSend < pSendOld)) annotations->drawBubble(o->getBboxP1(), "hit");
 
-                // bail if attenuation is already extremely high
-                if (pSend < 1e-30) break;
+            // bail if attenuation is already extremely high
+            if (pSend < 1e-30) break;
 
-            }
         }
+        if (pSend < 1e-30) break;
     }
 
-    // cache result
-    if (cacheEntries.size() >= 1000) cacheEntries.clear();
-    cacheEntries[cacheKey] = pSend;
+    // cache result, evicting the least recently used one if full
+    if (cacheSize > 0) {
+        if ((int)cacheEntries.size() >= cacheSize) {
+            cacheEntries.erase(cacheLRU.back());
+            cacheLRU.pop_back();
+        }
+        cacheLRU.push_front(cacheKey);
+        CacheEntry& cacheEntry = cacheEntries.insert(std::make_pair(cacheKey, CacheEntry())).first->second;
+        cacheEntry.receivedPower = pSend;
+        cacheEntry.lruPosition = cacheLRU.begin();
+    }
 
     return pSend;
 }
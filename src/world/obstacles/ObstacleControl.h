@@ -22,6 +22,8 @@
 #define WORLD_OBSTACLE_OBSTACLECONTROL_H
 
 #include <list>
+#include <map>
+#include <vector>
 
 #include "INETDefs.h"
 
@@ -94,19 +96,47 @@ class INET_API ObstacleControl : public cSimpleModule
             }
         };
 
+        typedef std::list<CacheKey> CacheLRU; /**< most recently used first */
+
+        struct CacheEntry {
+            double receivedPower;
+            CacheLRU::iterator lruPosition;
+        };
+
+        typedef std::map<CacheKey, CacheEntry> CacheEntries;
+
         enum { GRIDCELL_SIZE = 1024 };
 
         typedef std::list<Obstacle*> ObstacleGridCell;
         typedef std::vector<ObstacleGridCell> ObstacleGridRow;
         typedef std::vector<ObstacleGridRow> Obstacles;
-        typedef std::map<CacheKey, double> CacheEntries;
+        typedef std::pair<size_t, size_t> GridCellIndex; /**< col, row */
 
         cXMLElement* obstaclesXml; /**< obstacles to add at startup */
+        int cacheSize; /**< max number of cached results, 0 disables the cache */
 
         Obstacles obstacles;
         AnnotationManager* annotations;
         AnnotationManager::Group* annotationGroup;
         mutable CacheEntries cacheEntries;
+        mutable CacheLRU cacheLRU;
+        mutable long numCacheHits;
+        mutable long numCacheMisses;
+        mutable std::vector<GridCellIndex> segmentCells; /**< scratch space for getCellsOnSegment() */
+
+    protected:
+        void clearCache();
+
+        /**
+         * collect the existing grid cells crossed by the line segment, in order from p1 to p2
+         */
+        void getCellsOnSegment(const Coord& p1, const Coord& p2, std::vector<GridCellIndex>& cells) const;
+        void addCellIfExists(long x, long y, std::vector<GridCellIndex>& cells) const;
+
+        /**
+         * true if the line segment touches the axis aligned box
+         */
+        static bool segmentIntersectsBox(const Coord& p1, const Coord& p2, const Coord& boxP1, const Coord& boxP2);
 };
 
 class ObstacleControlAccess
@@ -18,8 +18,10 @@
 #include "ChannelControl.h"
 #include "FWMath.h"
 #include <cassert>
+#include <algorithm>
 
 #include "AirFrame_m.h"
+#include "IReceptionModel.h"
 
 #define coreEV (ev.isDisabled()||!coreDebug) ? EV : EV << "ChannelControl: "
 
@@ -42,6 +44,8 @@ std::ostream& operator<<(std::ostream& os, const ChannelControl::TransmissionLis
 
 ChannelControl::ChannelControl()
 {
+    useGrid = false;
+    lazyNeighborUpdate = false;
 }
 
 ChannelControl::~ChannelControl()
@@ -64,11 +68,21 @@ void ChannelControl::initialize()
 
     numChannels = par("numChannels");
     transmissions.resize(numChannels);
+    trackSingleChannelTransmissions = par("trackSingleChannelTransmissions");
 
     lastOngoingTransmissionsUpdate = 0;
 
     maxInterferenceDistance = calcInterfDist();
 
+    const char *neighborIndex = par("neighborIndex").stringValue();
+    if (!strcmp(neighborIndex, "none"))
+        useGrid = false;
+    else if (!strcmp(neighborIndex, "grid"))
+        useGrid = true;
+    else
+        throw cRuntimeError("Unknown neighborIndex '%s'", neighborIndex);
+    lazyNeighborUpdate = par("lazyNeighborUpdate");
+
     WATCH(maxInterferenceDistance);
     WATCH_LIST(radios);
     WATCH_VECTOR(transmissions);
@@ -125,8 +139,16 @@ ChannelControl::RadioRef ChannelControl::registerRadio(cModule *radio, cGate *ra
     re.isNeighborListValid = false;
     re.channel = 0;  // for now
     re.isActive = true;
+    re.slack = 0;  // the first setRadioPosition() call always computes the neighbors
+    re.receptionModel = NULL;
     radios.push_back(re);
-    return &radios.back(); // last element
+    RadioRef h = &radios.back(); // last element
+    if (useGrid)
+    {
+        h->gridCell = getGridCell(h->pos);
+        addToGrid(h);
+    }
+    return h;
 }
 
 void ChannelControl::unregisterRadio(RadioRef r)
@@ -146,6 +168,9 @@ void ChannelControl::unregisterRadio(RadioRef r)
                 radioToRemove->isNeighborListValid = false;
             }
 
+            if (useGrid)
+                removeFromGrid(radioToRemove);
+
             // erase radio from registered radios
             radios.erase(it);
             return;
@@ -179,8 +204,16 @@ const ChannelControl::RadioRefVector& ChannelControl::getNeighbors(RadioRef h)
 
 void ChannelControl::updateConnections(RadioRef h)
 {
+    if (useGrid)
+    {
+        updateConnectionsWithGrid(h);
+        return;
+    }
+
     Coord& hpos = h->pos;
     double maxDistSquared = maxInterferenceDistance * maxInterferenceDistance;
+    if (lazyNeighborUpdate)
+        h->slack = DBL_MAX;
     for (RadioList::iterator it = radios.begin(); it != radios.end(); ++it)
     {
         RadioEntry *hi = &(*it);
@@ -189,7 +222,10 @@ void ChannelControl::updateConnections(RadioRef h)
 
         // get the distance between the two radios.
         // (omitting the square root (calling sqrdist() instead of distance()) saves about 5% CPU)
-        bool inRange = hpos.sqrdist(hi->pos) < maxDistSquared;
+        double distSquared = hpos.sqrdist(hi->pos);
+        bool inRange = distSquared < maxDistSquared;
+        if (lazyNeighborUpdate)
+            updateSlack(h, hi, distSquared);
 
         if (inRange)
         {
@@ -212,6 +248,105 @@ void ChannelControl::updateConnections(RadioRef h)
     }
 }
 
+void ChannelControl::updateConnectionsWithGrid(RadioRef h)
+{
+    Coord& hpos = h->pos;
+    double maxDistSquared = maxInterferenceDistance * maxInterferenceDistance;
+
+    // out of range: disconnect (radios outside the adjacent cells are never visited below)
+    for (std::set<RadioRef,RadioEntry::Compare>::iterator it = h->neighbors.begin(); it != h->neighbors.end(); )
+    {
+        RadioEntry *hi = *it;
+        if (hpos.sqrdist(hi->pos) < maxDistSquared)
+            ++it;
+        else
+        {
+            h->neighbors.erase(it++);
+            hi->neighbors.erase(h);
+            h->isNeighborListValid = hi->isNeighborListValid = false;
+        }
+    }
+
+    // radios outside the adjacent cells stay out of range as long as neither of them leaves its cell
+    const RadioGridCell& c = h->gridCell;
+    if (lazyNeighborUpdate)
+        h->slack = getGridCellMargin(hpos, c);
+
+    // nodes within communication range: connect
+    for (int dx = -1; dx <= 1; dx++)
+    {
+        for (int dy = -1; dy <= 1; dy++)
+        {
+            for (int dz = -1; dz <= 1; dz++)
+            {
+                RadioGrid::iterator cellIt = grid.find(RadioGridCell(c.x + dx, c.y + dy, c.z + dz));
+                if (cellIt == grid.end())
+                    continue;
+                RadioRefVector& cellRadios = cellIt->second;
+                for (RadioRefVector::iterator it = cellRadios.begin(); it != cellRadios.end(); ++it)
+                {
+                    RadioEntry *hi = *it;
+                    if (hi == h)
+                        continue;
+                    double distSquared = hpos.sqrdist(hi->pos);
+                    if (lazyNeighborUpdate)
+                        updateSlack(h, hi, distSquared);
+                    if (distSquared < maxDistSquared && h->neighbors.insert(hi).second == true)
+                    {
+                        hi->neighbors.insert(h);
+                        h->isNeighborListValid = hi->isNeighborListValid = false;
+                    }
+                }
+            }
+        }
+    }
+}
+
+RadioGridCell ChannelControl::getGridCell(const Coord& pos)
+{
+    // cells are centered on the origin, so that planar (z=0) scenarios lie in the middle of a cell layer
+    return RadioGridCell((int)floor(pos.x / maxInterferenceDistance + 0.5),
+                         (int)floor(pos.y / maxInterferenceDistance + 0.5),
+                         (int)floor(pos.z / maxInterferenceDistance + 0.5));
+}
+
+double ChannelControl::getGridCellMargin(const Coord& pos, const RadioGridCell& cell)
+{
+    double dx = fabs(pos.x / maxInterferenceDistance - cell.x);
+    double dy = fabs(pos.y / maxInterferenceDistance - cell.y);
+    double dz = fabs(pos.z / maxInterferenceDistance - cell.z);
+    return (0.5 - std::max(dx, std::max(dy, dz))) * maxInterferenceDistance;
+}
+
+void ChannelControl::updateSlack(RadioRef h, RadioRef hi, double distSquared)
+{
+    // the pair cannot get connected or disconnected until the two radios together
+    // travel more than their distance from the interference boundary; split it evenly
+    double halfGap = fabs(sqrt(distSquared) - maxInterferenceDistance) / 2;
+    if (halfGap < h->slack)
+        h->slack = halfGap;
+    if (halfGap < hi->slack)
+        hi->slack = halfGap;
+}
+
+void ChannelControl::addToGrid(RadioRef h)
+{
+    grid[h->gridCell].push_back(h);
+}
+
+void ChannelControl::removeFromGrid(RadioRef h)
+{
+    RadioGrid::iterator cellIt = grid.find(h->gridCell);
+    ASSERT(cellIt != grid.end());
+    RadioRefVector& cellRadios = cellIt->second;
+    RadioRefVector::iterator it = std::find(cellRadios.begin(), cellRadios.end(), h);
+    ASSERT(it != cellRadios.end());
+    *it = cellRadios.back();
+    cellRadios.pop_back();
+    if (cellRadios.empty())
+        grid.erase(cellIt);
+}
+
 void ChannelControl::checkChannel(int channel)
 {
     if (channel >= numChannels || channel < 0)
@@ -221,7 +356,27 @@ void ChannelControl::checkChannel(int channel)
 void ChannelControl::setRadioPosition(RadioRef r, const Coord& pos)
 {
     Enter_Method_Silent();
+    if (lazyNeighborUpdate)
+    {
+        // the neighbor set is still valid as long as the radio did not use up its slack
+        r->slack -= r->pos.distance(pos);
+        if (r->slack > 0)
+        {
+            r->pos = pos;
+            return;
+        }
+    }
     r->pos = pos;
+    if (useGrid)
+    {
+        RadioGridCell cell = getGridCell(pos);
+        if (cell != r->gridCell)
+        {
+            removeFromGrid(r);
+            r->gridCell = cell;
+            addToGrid(r);
+        }
+    }
     updateConnections(r);
 }
 
@@ -248,8 +403,8 @@ void ChannelControl::addOngoingTransmission(RadioRef h, AirFrame *frame)
 
     // we only keep track of ongoing transmissions so that we can support
     // NICs switching channels -- so there's no point doing it if there's only
-    // one channel
-    if (numChannels == 1)
+    // one channel, unless explicitly requested
+    if (numChannels == 1 && !trackSingleChannelTransmissions)
     {
         delete frame;
         return;
@@ -287,14 +442,68 @@ void ChannelControl::purgeOngoingTransmissions()
     }
 }
 
+void ChannelControl::calculateReceivedPowers(AirFrame *airFrame)
+{
+    int n = receivers.size();
+    const Coord& senderPos = airFrame->getSenderPos();
+    receiverDistances.resize(n);
+    receivedPowers.resize(n);
+    receivedPowerValid.assign(n, false);
+
+    // radios use their own carrier frequency for frames without one
+    double carrierFrequency = airFrame->getCarrierFrequency();
+    if (carrierFrequency <= 0)
+        return;
+
+    // same expression as in the receiving radio, which uses the precomputed
+    // power only if its distance from the sender is still the same
+    for (int i = 0; i < n; i++)
+        receiverDistances[i] = receivers[i]->pos.distance(senderPos);
+
+    for (int i = 0; i < n; i++)
+    {
+        IReceptionModel *model = receivers[i]->receptionModel;
+        if (receivedPowerValid[i] || !model || !model->isEquivalent(model))
+            continue;
+
+        batchIndices.clear();
+        batchDistances.clear();
+        for (int j = i; j < n; j++)
+        {
+            if (!receivedPowerValid[j] && receivers[j]->receptionModel && model->isEquivalent(receivers[j]->receptionModel))
+            {
+                batchIndices.push_back(j);
+                batchDistances.push_back(receiverDistances[j]);
+            }
+        }
+        int numDistances = batchIndices.size();
+        batchPowers.resize(numDistances);
+        model->calculateReceivedPowers(airFrame->getPSend(), carrierFrequency, numDistances, &batchDistances[0], &batchPowers[0]);
+        for (int k = 0; k < numDistances; k++)
+        {
+            receivedPowers[batchIndices[k]] = batchPowers[k];
+            receivedPowerValid[batchIndices[k]] = true;
+        }
+    }
+}
+
 void ChannelControl::sendToChannel(RadioRef srcRadio, AirFrame *airFrame)
 {
     // NOTE: no Enter_Method()! We pretend this method is part of ChannelAccess
 
+    // Every receiver gets its own AirFrame, but the copies share the encapsulated
+    // MAC frame (cPacket reference counting) until a receiver accesses it.
+    // The original frame is only needed for tracking ongoing transmissions if
+    // there are several channels (or single channel tracking is turned on);
+    // otherwise the last receiver gets it instead of a copy.
+    cSimpleModule *srcModule = check_and_cast<cSimpleModule*>(srcRadio->radioModule);
+    simtime_t duration = airFrame->getDuration();
+
     // loop through all radios in range
     const RadioRefVector& neighbors = getNeighbors(srcRadio);
     int n = neighbors.size();
     int channel = airFrame->getChannelNumber();
+    receivers.clear();
     for (int i=0; i<n; i++)
     {
         RadioRef r = neighbors[i];
@@ -304,17 +513,32 @@ void ChannelControl::sendToChannel(RadioRef srcRadio, AirFrame *airFrame)
             continue;
         }
         if (r->channel == channel)
-        {
-            coreEV << "sending message to radio listening on the same channel\n";
-            // account for propagation delay, based on distance in meters
-            // Over 300m, dt=1us=10 bit times @ 10Mbps
-            simtime_t delay = srcRadio->pos.distance(r->pos) / SPEED_OF_LIGHT;
-            check_and_cast<cSimpleModule*>(srcRadio->radioModule)->sendDirect(airFrame->dup(), delay, airFrame->getDuration(), r->radioInGate);
-        }
+            receivers.push_back(r);
         else
             coreEV << "skipping radio listening on a different channel\n";
     }
 
+    calculateReceivedPowers(airFrame);
+
+    bool keepOriginal = numChannels > 1 || trackSingleChannelTransmissions;
+    int numReceivers = receivers.size();
+    for (int i=0; i<numReceivers; i++)
+    {
+        RadioRef r = receivers[i];
+        coreEV << "sending message to radio listening on the same channel\n";
+        AirFrame *copy = !keepOriginal && i == numReceivers-1 ? airFrame : airFrame->dup();
+        if (receivedPowerValid[i])
+        {
+            copy->setPowRec(receivedPowers[i]);
+            copy->setPowRecDistance(receiverDistances[i]);
+        }
+        // account for propagation delay, based on distance in meters
+        // Over 300m, dt=1us=10 bit times @ 10Mbps
+        simtime_t delay = srcRadio->pos.distance(r->pos) / SPEED_OF_LIGHT;
+        srcModule->sendDirect(copy, delay, duration, r->radioInGate);
+    }
+
     // register transmission
-    addOngoingTransmission(srcRadio, airFrame);
+    if (keepOriginal || numReceivers == 0)
+        addOngoingTransmission(srcRadio, airFrame);
 }
@@ -20,6 +20,7 @@
 #include <vector>
 #include <list>
 #include <set>
+#include <map>
 
 #include "INETDefs.h"
 #include "Coord.h"
@@ -30,6 +31,24 @@ class AirFrame;
 
 #define TRANSMISSION_PURGE_INTERVAL 1.0
 
+/**
+ * Integer coordinates of a cell in ChannelControl's uniform grid index.
+ */
+struct RadioGridCell {
+    int x, y, z;
+
+    RadioGridCell() : x(0), y(0), z(0) {}
+    RadioGridCell(int x, int y, int z) : x(x), y(y), z(z) {}
+
+    bool operator==(const RadioGridCell& other) const { return x == other.x && y == other.y && z == other.z; }
+    bool operator!=(const RadioGridCell& other) const { return !(*this == other); }
+    bool operator<(const RadioGridCell& other) const {
+        if (x != other.x) return x < other.x;
+        if (y != other.y) return y < other.y;
+        return z < other.z;
+    }
+};
+
 /**
  * Keeps track of radios/NICs, their positions and channels;
  * also caches neighbor info (which other Radios are within
@@ -53,6 +72,9 @@ struct IChannelControl::RadioEntry {
     std::vector<RadioRef> neighborList;
     bool isNeighborListValid;
     bool isActive;
+    RadioGridCell gridCell; // grid cell the radio is stored in (only used with the grid index)
+    double slack; // distance the radio may still move before its neighbor set must be recomputed (only used with lazy neighbor update)
+    IReceptionModel *receptionModel; // the radio's reception model, or NULL (see setRadioReceptionModel())
 };
 
 /**
@@ -91,9 +113,54 @@ class INET_API ChannelControl : public cSimpleModule, public IChannelControl
     /** the number of controlled channels */
     int numChannels;
 
+    /** if true, ongoing transmissions are tracked even with a single channel */
+    bool trackSingleChannelTransmissions;
+
+    /**
+     * Optional uniform grid index over the radio positions. The cell size is
+     * maxInterferenceDistance, so all radios in range of a given radio are
+     * located in the same or in an adjacent cell.
+     */
+    typedef std::map<RadioGridCell, RadioRefVector> RadioGrid;
+    bool useGrid;
+    RadioGrid grid;
+
+    /**
+     * If true, a moving radio only recomputes its neighbor set when the
+     * distance it travelled since then exceeds its slack (see RadioEntry).
+     */
+    bool lazyNeighborUpdate;
+
+    /** reused buffers of sendToChannel() */
+    RadioRefVector receivers;
+    std::vector<double> receiverDistances;
+    std::vector<double> receivedPowers;
+    std::vector<bool> receivedPowerValid;
+    std::vector<int> batchIndices;
+    std::vector<double> batchDistances;
+    std::vector<double> batchPowers;
+
   protected:
     virtual void updateConnections(RadioRef h);
 
+    /** Updates the neighbor sets by scanning only the grid cells adjacent to the radio */
+    virtual void updateConnectionsWithGrid(RadioRef h);
+
+    /** Returns the grid cell that contains the given position */
+    virtual RadioGridCell getGridCell(const Coord& pos);
+
+    /** Returns the distance between the position and the nearest face of its grid cell */
+    virtual double getGridCellMargin(const Coord& pos, const RadioGridCell& cell);
+
+    /** Limits the slack of both radios according to their current distance from the interference boundary */
+    virtual void updateSlack(RadioRef h, RadioRef hi, double distSquared);
+
+    /** Adds the radio to the grid cell stored in its gridCell field */
+    virtual void addToGrid(RadioRef h);
+
+    /** Removes the radio from the grid cell stored in its gridCell field */
+    virtual void removeFromGrid(RadioRef h);
+
     /** Calculate interference distance*/
     virtual double calcInterfDist();
 
@@ -109,6 +176,12 @@ class INET_API ChannelControl : public cSimpleModule, public IChannelControl
     /** Get the list of modules in range of the given host */
     virtual const RadioRefVector& getNeighbors(RadioRef h);
 
+    /**
+     * Precomputes the received power at each of the given receivers, with one
+     * batch call per group of receivers with equivalent reception models.
+     */
+    virtual void calculateReceivedPowers(AirFrame *airFrame);
+
     /** Notifies the channel control with an ongoing transmission */
     virtual void addOngoingTransmission(RadioRef h, AirFrame *frame);
 
@@ -140,6 +213,9 @@ class INET_API ChannelControl : public cSimpleModule, public IChannelControl
     /** Called when host switches channel */
     virtual void setRadioChannel(RadioRef r, int channel);
 
+    /** Sets the reception model of the radio, used to compute received powers when sending to it; may be NULL */
+    virtual void setRadioReceptionModel(RadioRef r, IReceptionModel *receptionModel) { r->receptionModel = receptionModel; }
+
     /** Returns the number of radio channels (frequencies) simulated */
     virtual int getNumChannels() { return numChannels; }
 
@@ -25,6 +25,7 @@
 
 // Forward declarations
 class AirFrame;
+class IReceptionModel;
 
 /**
  * Interface to implement for a module that controls radio frequency channel access.
@@ -62,6 +63,9 @@ class INET_API IChannelControl
     /** Called when host switches channel */
     virtual void setRadioChannel(RadioRef r, int channel) = 0;
 
+    /** Sets the reception model of the radio, used to compute received powers when sending to it; may be NULL */
+    virtual void setRadioReceptionModel(RadioRef r, IReceptionModel *receptionModel) = 0;
+
     /** Returns the number of radio channels (frequencies) simulated */
     virtual int getNumChannels() = 0;
 
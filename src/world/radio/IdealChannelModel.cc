@@ -128,6 +128,13 @@ void IdealChannelModel::sendToChannel(RadioEntry *srcRadio, IdealAirFrame *airFr
 
     double sqrTransmissionRange = airFrame->getTransmissionRange()*airFrame->getTransmissionRange();
 
+    // the copies share the encapsulated frame (cPacket reference counting);
+    // the last receiver gets the original, so sending is deferred by one receiver
+    cSimpleModule *srcModule = check_and_cast<cSimpleModule*>(srcRadio->radioModule);
+    simtime_t duration = airFrame->getDuration();
+    RadioEntry *pendingRadio = NULL;
+    simtime_t pendingDelay;
+
     // loop through all radios
     for (RadioList::iterator it=radios.begin(); it !=radios.end(); ++it)
     {
@@ -141,12 +148,17 @@ void IdealChannelModel::sendToChannel(RadioEntry *srcRadio, IdealAirFrame *airFr
         double sqrdist = srcRadio->pos.sqrdist(r->pos);
         if (sqrdist <= sqrTransmissionRange)
         {
+            if (pendingRadio)
+                srcModule->sendDirect(airFrame->dup(), pendingDelay, duration, pendingRadio->radioInGate);
             // account for propagation delay, based on distance in meters
             // Over 300m, dt=1us=10 bit times @ 10Mbps
-            simtime_t delay = sqrt(sqrdist) / SPEED_OF_LIGHT;
-            check_and_cast<cSimpleModule*>(srcRadio->radioModule)->sendDirect(airFrame->dup(), delay, airFrame->getDuration(), r->radioInGate);
+            pendingRadio = r;
+            pendingDelay = sqrt(sqrdist) / SPEED_OF_LIGHT;
         }
     }
-    delete airFrame;
+    if (pendingRadio)
+        srcModule->sendDirect(airFrame, pendingDelay, duration, pendingRadio->radioInGate);
+    else
+        delete airFrame;
 }
 